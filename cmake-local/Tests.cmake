@@ -0,0 +1,46 @@
+# Option to build the native unit tests, which run under ctest
+option(BUILD_TESTS "Build native unit tests" OFF)
+
+if(BUILD_TESTS)
+    enable_testing()
+
+    juce_add_console_app(Tests PRODUCT_NAME "${PROJECT_NAME}Tests")
+
+    target_sources(Tests
+        PRIVATE
+        tests/Main.cpp
+        tests/TranscriptExporterTests.cpp
+        tests/TranscriptPatchTests.cpp
+    )
+
+    target_compile_definitions(Tests
+        PRIVATE
+        JUCE_USE_CURL=0
+        JUCE_WEB_BROWSER=0
+    )
+
+    target_link_libraries(Tests
+        PRIVATE
+        juce::juce_core
+        juce::juce_recommended_config_flags
+        juce::juce_recommended_warning_flags
+    )
+
+    add_test(NAME Tests COMMAND Tests)
+
+    # Synthetic ARA host that renders a generated document through the
+    # plugin's own factory. Like Pamplejuce's tests, it links the plugin's
+    # shared code, so it builds with the plugin's modules and definitions.
+    add_executable(RenderHarness
+        tests/Main.cpp
+        tests/RenderHarness.cpp
+    )
+
+    target_link_libraries(RenderHarness
+        PRIVATE
+        SharedCode
+        "${PROJECT_NAME}"
+    )
+
+    add_test(NAME RenderHarness COMMAND RenderHarness)
+endif()
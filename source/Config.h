@@ -26,9 +26,70 @@ struct Config
         return juce::URL ("https://huggingface.co/ggml-org/whisper-vad/resolve/main/ggml-" + vadModelName + ".bin");
     }
 
+    // File listings of the model repositories. Each model's entry carries the
+    // SHA-256 of its contents, which downloads are verified against.
+    static const juce::URL getModelCatalogURL()
+    {
+        return juce::URL ("https://huggingface.co/api/models/ggerganov/whisper.cpp/tree/main");
+    }
+
+    static const juce::URL getVadModelCatalogURL()
+    {
+        return juce::URL ("https://huggingface.co/api/models/ggml-org/whisper-vad/tree/main");
+    }
+
+    // Models are kept in the user's application data directory so they survive
+    // temp directory cleanups. On Windows that is the local one, since roaming
+    // profiles would copy gigabytes of models between machines.
     static const std::string getModelsDir()
+    {
+#if JUCE_WINDOWS
+        auto appDataDir = juce::File::getSpecialLocation (juce::File::SpecialLocationType::windowsLocalAppData);
+#else
+        auto appDataDir = juce::File::getSpecialLocation (juce::File::SpecialLocationType::userApplicationDataDirectory);
+#endif
+#if JUCE_MAC
+        appDataDir = appDataDir.getChildFile ("Application Support");
+#endif
+        return appDataDir.getChildFile (JucePlugin_Name).getChildFile ("models").getFullPathName().toStdString() + "/";
+    }
+
+    // Models directory used by earlier versions, migrated on first use
+    static const std::string getLegacyModelsDir()
     {
         const auto tempDir = juce::File::getSpecialLocation (juce::File::SpecialLocationType::tempDirectory);
         return tempDir.getFullPathName().toStdString() + "/models/";
     }
+
+    // Rate in Hz at which the playhead is checked; an event is sent to the UI
+    // only when it has moved or the transport has started or stopped
+    static constexpr int playHeadEventRate = 30;
+
+    // Marker creation runs in slices of this many milliseconds, one per timer
+    // interval, leaving the rest of the message thread's time to the host
+    static constexpr double markerCreationSliceMs = 8.0;
+    static constexpr int markerCreationIntervalMs = 15;
+
+    // Playback audio is read this far ahead of each read position, on the
+    // shared sample reading thread, in chunks of this many source samples
+    static constexpr double prefetchBufferSeconds = 2.0;
+    static constexpr int prefetchChunkSamples = 8192;
+
+    // Upcoming region starts and loop wraps are cued this long in advance
+    static constexpr double prefetchLookaheadSeconds = 1.0;
+
+    // Decoded audio shared by playback and transcription is kept in memory up
+    // to this size, then spilled to memory-mapped files up to the disk budget
+    static inline const size_t pcmCacheMemoryBudgetBytes = (size_t) 512 * 1024 * 1024;
+    static inline const juce::int64 pcmCacheDiskBudgetBytes = (juce::int64) 4 * 1024 * 1024 * 1024;
+
+    // Whisper states each engine keeps, each holding the log-mel spectrogram
+    // of different audio, so alternating between sources doesn't recompute
+    // it. Each is allocated only when needed and costs its KV caches and
+    // compute buffers, from tens of MB for small models to a few hundred MB
+    // for the large ones.
+    static constexpr int asrStateSlots = 2;
+
+    // Default disk quota for the model store; can be overridden in its manifest
+    static inline const juce::int64 modelStoreQuotaBytes = (juce::int64) 10 * 1024 * 1024 * 1024;
 };
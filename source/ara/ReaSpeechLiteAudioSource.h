@@ -1,38 +1,278 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <ARA_API/ARAInterface.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
+#include "../asr/ASRTranscript.h"
+#include "../asr/ASRTranscriptCodec.h"
+#include "../asr/ASRTranscriptPatch.h"
+#include "../utils/PCMCache.h"
+
 class ReaSpeechLiteAudioSource final : public juce::ARAAudioSource
 {
 public:
+    enum class TranscriptEncoding
+    {
+        binary,
+        legacyJSON
+    };
+
+    // Notified on the message thread when a patch is applied. Whole-transcript
+    // changes are reported through notifyContentChanged instead.
+    class TranscriptListener
+    {
+    public:
+        virtual ~TranscriptListener() = default;
+        virtual void transcriptPatched (ReaSpeechLiteAudioSource& audioSource,
+                                        juce::int64 baseVersion,
+                                        juce::int64 version,
+                                        const ASRTranscriptPatch& patch) = 0;
+    };
+
     ReaSpeechLiteAudioSource (juce::ARADocument* document, ARA::ARAAudioSourceHostRef hostRef)
         : ARAAudioSource (document, hostRef)
     {
-        transcript = new juce::DynamicObject();
+        addListener (&cacheInvalidator);
     }
 
-    const juce::var& getTranscript() const noexcept
+    ~ReaSpeechLiteAudioSource() override
+    {
+        removeListener (&cacheInvalidator);
+
+        // Waits for any background render of this source to stop
+        cacheInvalidator.cache->removeSource (static_cast<juce::ARAAudioSource*> (this));
+    }
+
+    void addTranscriptListener (TranscriptListener* listener) { transcriptListeners.add (listener); }
+    void removeTranscriptListener (TranscriptListener* listener) { transcriptListeners.remove (listener); }
+
+    // Increases every time the transcript changes
+    juce::int64 getTranscriptVersion() const
     {
+        const juce::ScopedLock lock (transcriptLock);
+        return transcriptVersion;
+    }
+
+    // Returns nullptr if the audio source has no transcript. A restored
+    // transcript is decoded on first access.
+    std::shared_ptr<const ASRTranscript> getTranscript() const
+    {
+        const juce::ScopedLock lock (transcriptLock);
+
+        if (transcript == nullptr && encodedTranscript != nullptr && ! decodeFailed)
+            decodeTranscript();
+
         return transcript;
     }
 
-    void setTranscript (const juce::var& newTranscript) noexcept
+    // Returns the transcript if it has been decoded. A transcript restored in
+    // binary form and not yet accessed is returned in encoded instead, so
+    // indexes can read it without the source keeping it decoded.
+    std::shared_ptr<const ASRTranscript> getTranscriptUnlessEncoded (std::shared_ptr<const juce::MemoryBlock>& encoded) const
     {
-        if (! newTranscript.isObject())
+        const juce::ScopedLock lock (transcriptLock);
+        encoded.reset();
+
+        if (transcript == nullptr && encodedTranscript != nullptr && ! decodeFailed)
         {
-            jassertfalse; // Transcript must be an object
-            return;
+            if (encodedTranscriptEncoding == TranscriptEncoding::binary)
+            {
+                encoded = encodedTranscript;
+                return nullptr;
+            }
+
+            decodeTranscript();
+        }
+
+        return transcript;
+    }
+
+    // Transcripts are immutable once set, so they can be shared with other threads
+    void setTranscript (std::shared_ptr<const ASRTranscript> newTranscript) noexcept
+    {
+        {
+            const juce::ScopedLock lock (transcriptLock);
+
+            const auto isEmpty = transcript == nullptr && encodedTranscript == nullptr;
+            if (newTranscript == nullptr ? isEmpty : newTranscript == transcript)
+                return;
+
+            transcript = std::move (newTranscript);
+            editableTranscript.reset();
+            encodedTranscript.reset();
+            alternateTranscripts.clear();
+            decodeFailed = false;
+            ++transcriptVersion;
         }
 
-        if (transcript != newTranscript)
+        notifyContentChanged (juce::ARAContentUpdateScopes::nothingIsAffected(), false);
+    }
+
+    // Keeps a stored transcript as raw bytes until it is first accessed
+    void setEncodedTranscript (juce::MemoryBlock data, TranscriptEncoding encoding) noexcept
+    {
         {
-            transcript = newTranscript;
-            notifyContentChanged (juce::ARAContentUpdateScopes::nothingIsAffected(), false);
+            const juce::ScopedLock lock (transcriptLock);
+
+            transcript.reset();
+            editableTranscript.reset();
+            alternateTranscripts.clear();
+            decodeFailed = false;
+            encodedTranscript = data.isEmpty() ? nullptr : std::make_shared<const juce::MemoryBlock> (std::move (data));
+            encodedTranscriptEncoding = encoding;
+            ++transcriptVersion;
         }
+
+        notifyContentChanged (juce::ARAContentUpdateScopes::nothingIsAffected(), false);
+    }
+
+    // Applies segment edits if the transcript is still at baseVersion. Returns
+    // the new version, or -1 with an error message if the patch was rejected.
+    juce::int64 patchTranscript (const ASRTranscriptPatch& patch, juce::int64 baseVersion, juce::String& error)
+    {
+        juce::int64 version;
+        {
+            const juce::ScopedLock lock (transcriptLock);
+
+            if (transcriptVersion != baseVersion)
+            {
+                error = "Transcript version conflict";
+                return -1;
+            }
+
+            if (transcript == nullptr && encodedTranscript != nullptr && ! decodeFailed)
+                decodeTranscript();
+
+            if (transcript == nullptr)
+            {
+                error = "Audio source has no transcript";
+                return -1;
+            }
+
+            // Edited in place unless another thread holds on to the transcript
+            if (! patch.applyToOwned (transcript, editableTranscript, error))
+                return -1;
+
+            encodedTranscript.reset();
+            version = ++transcriptVersion;
+        }
+
+        transcriptListeners.call ([&] (TranscriptListener& l) { l.transcriptPatched (*this, baseVersion, version, patch); });
+        return version;
+    }
+
+    // Further transcripts of the audio from the same job as the transcript,
+    // such as a translation. They are kept for this session only, and are
+    // dropped when the transcript is replaced.
+    void setAlternateTranscripts (std::vector<std::shared_ptr<const ASRTranscript>> newAlternates)
+    {
+        const juce::ScopedLock lock (transcriptLock);
+        alternateTranscripts = std::move (newAlternates);
+    }
+
+    // Returns nullptr if there is no alternate transcript at the index
+    std::shared_ptr<const ASRTranscript> getAlternateTranscript (int index) const
+    {
+        const juce::ScopedLock lock (transcriptLock);
+        return juce::isPositiveAndBelow (index, (int) alternateTranscripts.size()) ? alternateTranscripts[(size_t) index] : nullptr;
+    }
+
+    // True if the transcript has changed since it was last encoded
+    bool isTranscriptDirty() const
+    {
+        const juce::ScopedLock lock (transcriptLock);
+        return encodedTranscript == nullptr ? transcript != nullptr
+                                            : encodedTranscriptEncoding != TranscriptEncoding::binary;
+    }
+
+    // Returns the transcript in the current binary format, or nullptr if there
+    // is none. The encoded form is cached until the transcript is replaced, so
+    // unchanged transcripts (including restored ones) are never re-encoded.
+    std::shared_ptr<const juce::MemoryBlock> getEncodedTranscript() const
+    {
+        const juce::ScopedLock lock (transcriptLock);
+
+        if (encodedTranscript != nullptr && encodedTranscriptEncoding == TranscriptEncoding::binary)
+            return encodedTranscript;
+
+        if (transcript == nullptr && encodedTranscript != nullptr && ! decodeFailed)
+            decodeTranscript();
+
+        if (transcript == nullptr)
+            return nullptr;
+
+        auto encoded = std::make_shared<juce::MemoryBlock>();
+        ASRTranscriptCodec::encode (*transcript, *encoded);
+
+        encodedTranscript = encoded;
+        encodedTranscriptEncoding = TranscriptEncoding::binary;
+        return encodedTranscript;
     }
 
 private:
-    juce::var transcript;
+    // Drops decoded audio in the shared PCM cache when the host changes the
+    // source's samples or properties
+    struct CacheInvalidator final : juce::ARAAudioSource::Listener
+    {
+        void didUpdateAudioSourceProperties (juce::ARAAudioSource* audioSource) override
+        {
+            cache->invalidate (audioSource);
+        }
+
+        void didUpdateAudioSourceContent (juce::ARAAudioSource* audioSource, juce::ARAContentUpdateScopes scopeFlags) override
+        {
+            if (scopeFlags.affectSamples())
+                cache->invalidate (audioSource);
+        }
+
+        juce::SharedResourcePointer<PCMCache> cache;
+    };
+
+    void decodeTranscript() const
+    {
+        auto decoded = std::make_shared<ASRTranscript>();
+
+        if (encodedTranscriptEncoding == TranscriptEncoding::legacyJSON)
+        {
+            // Legacy data is converted once and never written back; an object
+            // without segments means there is no transcript
+            const auto json = juce::String::fromUTF8 (static_cast<const char*> (encodedTranscript->getData()), (int) encodedTranscript->getSize());
+            if (ASRTranscript::fromVar (juce::JSON::parse (json), *decoded))
+            {
+                editableTranscript = decoded;
+                transcript = std::move (decoded);
+            }
+
+            encodedTranscript.reset();
+            return;
+        }
+
+        if (! ASRTranscriptCodec::decode (encodedTranscript->getData(), encodedTranscript->getSize(), *decoded))
+        {
+            // Keep the bytes so they are stored back unchanged
+            DBG ("Failed to decode transcript for audio source ID: " + juce::String (getPersistentID()));
+            decodeFailed = true;
+            return;
+        }
+
+        // The binary data stays valid for storing until the transcript changes
+        editableTranscript = decoded;
+        transcript = std::move (decoded);
+    }
+
+    juce::CriticalSection transcriptLock;
+    mutable std::shared_ptr<const ASRTranscript> transcript;
+    mutable std::shared_ptr<ASRTranscript> editableTranscript; // The transcript, if owned by this source
+    mutable std::shared_ptr<const juce::MemoryBlock> encodedTranscript;
+    mutable TranscriptEncoding encodedTranscriptEncoding = TranscriptEncoding::binary;
+    mutable bool decodeFailed = false;
+    juce::int64 transcriptVersion = 0;
+    std::vector<std::shared_ptr<const ASRTranscript>> alternateTranscripts;
+
+    juce::ListenerList<TranscriptListener> transcriptListeners;
+    CacheInvalidator cacheInvalidator;
 };
@@ -1,15 +1,20 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
-#include "../types/ProcessingLockInterface.h"
+#include "../asr/TranscriptSearchIndex.h"
+#include "../utils/TraceRecorder.h"
 #include "ReaSpeechLiteAudioSource.h"
 #include "ReaSpeechLitePlaybackRenderer.h"
+#include "RegionSequenceModel.h"
+#include "TimelineIndex.h"
 
 class ReaSpeechLiteDocumentController final :
-    public juce::ARADocumentControllerSpecialisation,
-    private ProcessingLockInterface
+    public juce::ARADocumentControllerSpecialisation
 {
 public:
     using ARADocumentControllerSpecialisation::ARADocumentControllerSpecialisation;
@@ -29,15 +34,91 @@ public:
         return getDocumentController()->getHostPlaybackController();
     }
 
-protected:
-    void willBeginEditing (juce::ARADocument*) noexcept override
+    // Created on first use, and kept up to date from then on
+    RegionSequenceModel& getRegionSequenceModel()
+    {
+        if (regionSequenceModel == nullptr)
+            regionSequenceModel = std::make_unique<RegionSequenceModel> (*getDocument());
+
+        return *regionSequenceModel;
+    }
+
+    // Search index over all audio source transcripts, brought up to date on
+    // each search. Only sources whose transcript changed are reindexed, and
+    // restored transcripts are indexed without being kept decoded.
+    TranscriptSearchIndex& getUpdatedSearchIndex()
+    {
+        juce::StringArray sourceIDs;
+
+        for (auto* audioSource : getDocument()->getAudioSources<ReaSpeechLiteAudioSource>())
+        {
+            const juce::String sourceID (audioSource->getPersistentID());
+            const auto version = audioSource->getTranscriptVersion();
+
+            if (searchIndex.needsUpdate (sourceID, version))
+            {
+                std::shared_ptr<const juce::MemoryBlock> encoded;
+                auto transcript = audioSource->getTranscriptUnlessEncoded (encoded);
+
+                if (encoded != nullptr)
+                    searchIndex.update (sourceID, version, *encoded);
+                else
+                    searchIndex.update (sourceID, version, transcript.get());
+            }
+
+            sourceIDs.add (sourceID);
+        }
+
+        searchIndex.retainOnly (sourceIDs);
+        return searchIndex;
+    }
+
+    // Index from playback time to transcript segments and words, brought up
+    // to date on each lookup. Regions are reindexed when the region sequence
+    // model changes, and transcripts when their version changes and a lookup
+    // reaches them.
+    TimelineIndex& getUpdatedTimelineIndex()
     {
-        processBlockLock.enterWrite();
+        auto& model = getRegionSequenceModel();
+
+        if (timelineIndex.needsRegionUpdate (model.getVersion()))
+        {
+            std::vector<TimelineIndex::Region> regions;
+
+            model.forEachPlaybackRegion ([&regions] (const juce::ARAPlaybackRegion& playbackRegion, int id)
+            {
+                const auto* audioSource = playbackRegion.getAudioModification()->getAudioSource();
+                regions.push_back ({ id,
+                                     juce::String (audioSource->getPersistentID()),
+                                     playbackRegion.getStartInPlaybackTime(),
+                                     playbackRegion.getEndInPlaybackTime(),
+                                     playbackRegion.getStartInAudioModificationTime(),
+                                     playbackRegion.getEndInAudioModificationTime() });
+            });
+
+            timelineIndex.updateRegions (model.getVersion(), std::move (regions));
+        }
+
+        juce::StringArray sourceIDs;
+
+        for (auto* audioSource : getDocument()->getAudioSources<ReaSpeechLiteAudioSource>())
+        {
+            const juce::String sourceID (audioSource->getPersistentID());
+            timelineIndex.setTranscriptVersion (sourceID, audioSource->getTranscriptVersion());
+            sourceIDs.add (sourceID);
+        }
+
+        timelineIndex.retainOnly (sourceIDs);
+        return timelineIndex;
     }
 
+protected:
+    // Renderers keep playing their previous snapshot of the regions during an
+    // edit, and pick up the edited regions once it ends
     void didEndEditing (juce::ARADocument*) noexcept override
     {
-        processBlockLock.exitWrite();
+        for (auto* renderer : getDocumentController()->getPlaybackRenderers<ReaSpeechLitePlaybackRenderer>())
+            renderer->didEndDocumentEdit();
     }
 
     juce::ARAAudioSource* doCreateAudioSource (juce::ARADocument* document, ARA::ARAAudioSourceHostRef hostRef) noexcept override
@@ -47,38 +128,52 @@ protected:
 
     juce::ARAPlaybackRenderer* doCreatePlaybackRenderer() noexcept override
     {
-        return new ReaSpeechLitePlaybackRenderer (getDocumentController(), *this);
+        return new ReaSpeechLitePlaybackRenderer (getDocumentController());
     }
 
     bool doRestoreObjectsFromStream (juce::ARAInputStream& input, const juce::ARARestoreObjectsFilter* filter) noexcept override
     {
-        // Start reading data from the archive, starting with the number of audio sources in the archive
+        const ScopedTrace trace ("ReaSpeechLiteDocumentController::doRestoreObjectsFromStream", "ara");
+
+        // Legacy archives start with the number of audio sources, which is never negative
+        const auto header = input.readInt64();
+        if (header >= 0)
+            return restoreLegacyObjectsFromStream (input, filter, header);
+
+        if (header != archiveTag)
+        {
+            DBG ("Unrecognized archive tag: " + juce::String (header));
+            return false;
+        }
+
+        const auto version = input.readInt();
+        if (version > archiveVersion)
+        {
+            DBG ("Archive was saved by a newer version: " + juce::String (version));
+            return false;
+        }
+
         const auto numAudioSources = input.readInt64();
 
-        // Loop over stored audio source data
         for (juce::int64 i = 0; i < numAudioSources; ++i)
         {
             auto audioSourceID = input.readString();
-            auto transcriptJSON = input.readString();
+            const auto blobSize = input.readInt64();
+
+            if (input.failed() || blobSize < 0)
+                return false;
+
+            juce::MemoryBlock blob;
+            if (blobSize > 0 && input.readIntoMemoryBlock (blob, (ssize_t) blobSize) != (size_t) blobSize)
+                return false;
 
             auto audioSource = filter->getAudioSourceToRestoreStateWithID<ReaSpeechLiteAudioSource> (audioSourceID.getCharPointer());
 
             if (audioSource == nullptr)
                 continue;
 
-            // Parse JSON string back to juce::var
-            juce::var transcript;
-            auto result = juce::JSON::parse (transcriptJSON, transcript);
-
-            if (result.wasOk())
-            {
-                audioSource->setTranscript (transcript);
-            }
-            else
-            {
-                DBG ("Failed to parse transcript JSON for audio source ID: " + audioSourceID);
-                return false;
-            }
+            // Decoded on first access; an empty blob means there is no transcript
+            audioSource->setEncodedTranscript (std::move (blob), ReaSpeechLiteAudioSource::TranscriptEncoding::binary);
         }
 
         return ! input.failed();
@@ -86,37 +181,80 @@ protected:
 
     bool doStoreObjectsToStream (juce::ARAOutputStream& output, const juce::ARAStoreObjectsFilter* filter) noexcept override
     {
+        const ScopedTrace trace ("ReaSpeechLiteDocumentController::doStoreObjectsToStream", "ara");
+
         const auto& audioSourcesToPersist { filter->getAudioSourcesToStore<ReaSpeechLiteAudioSource>() };
 
-        // Write the number of audio sources we are persisting
+        // Write the archive header and the number of audio sources we are persisting
         const auto numAudioSources = audioSourcesToPersist.size();
 
-        if (! output.writeInt64 ((juce::int64) numAudioSources))
+        if (! output.writeInt64 (archiveTag)
+            || ! output.writeInt (archiveVersion)
+            || ! output.writeInt64 ((juce::int64) numAudioSources))
             return false;
 
-        // For each audio source to persist, persist its ID followed by its transcript
+        int numEncoded = 0;
+
+        // For each audio source to persist, persist its ID followed by its encoded transcript
         for (size_t i = 0; i < numAudioSources; ++i)
         {
-            // Write audio source ID and transcript as JSON
             if (! output.writeString (audioSourcesToPersist[i]->getPersistentID()))
                 return false;
 
-            // Convert juce::var to JSON string for storage
-            juce::String transcriptJSON = juce::JSON::toString (audioSourcesToPersist[i]->getTranscript());
-            if (! output.writeString (transcriptJSON))
+            // Only transcripts that changed since the last store are encoded
+            if (audioSourcesToPersist[i]->isTranscriptDirty())
+                ++numEncoded;
+
+            const auto blob = audioSourcesToPersist[i]->getEncodedTranscript();
+            const auto blobSize = blob != nullptr ? blob->getSize() : 0;
+
+            if (! output.writeInt64 ((juce::int64) blobSize)
+                || (blobSize > 0 && ! output.write (blob->getData(), blobSize)))
                 return false;
         }
 
+        DBG ("Stored " + juce::String ((int) numAudioSources) + " transcripts, encoded " + juce::String (numEncoded));
         return true;
     }
 
 private:
-    juce::ScopedTryReadLock getProcessingLock() override
+    // Marks the binary archive format; legacy archives start with a non-negative count
+    static constexpr juce::int64 archiveTag = -0x52534c41; // "RSLA"
+    static constexpr int archiveVersion = 1;
+
+    // Reads archives written before the binary format, which stored each
+    // transcript as a JSON string
+    bool restoreLegacyObjectsFromStream (juce::ARAInputStream& input, const juce::ARARestoreObjectsFilter* filter, juce::int64 numAudioSources)
     {
-        return juce::ScopedTryReadLock { processBlockLock };
+        for (juce::int64 i = 0; i < numAudioSources; ++i)
+        {
+            auto audioSourceID = input.readString();
+            auto transcriptJSON = input.readString();
+
+            auto audioSource = filter->getAudioSourceToRestoreStateWithID<ReaSpeechLiteAudioSource> (audioSourceID.getCharPointer());
+
+            if (audioSource == nullptr)
+                continue;
+
+            // Parsed on first access
+            const auto utf8 = transcriptJSON.toUTF8();
+            audioSource->setEncodedTranscript (juce::MemoryBlock (utf8.getAddress(), utf8.sizeInBytes() - 1),
+                                               ReaSpeechLiteAudioSource::TranscriptEncoding::legacyJSON);
+        }
+
+        return ! input.failed();
     }
 
-    juce::ReadWriteLock processBlockLock;
+    std::unique_ptr<RegionSequenceModel> regionSequenceModel;
+    TranscriptSearchIndex searchIndex;
+    TimelineIndex timelineIndex { [this] (const juce::String& sourceID) -> std::shared_ptr<const ASRTranscript>
+    {
+        for (auto* audioSource : getDocument()->getAudioSources<ReaSpeechLiteAudioSource>())
+            if (sourceID == audioSource->getPersistentID())
+                return audioSource->getTranscript();
+
+        return nullptr;
+    } };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReaSpeechLiteDocumentController)
 };
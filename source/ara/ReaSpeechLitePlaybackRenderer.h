@@ -1,30 +1,47 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
-#include "../types/ProcessingLockInterface.h"
+#include "../Config.h"
+#include "../utils/ComputeBudget.h"
+#include "../utils/EpochSnapshot.h"
+#include "../utils/IntervalIndex.h"
+#include "../utils/PCMCache.h"
+#include "../utils/PrefetchingReader.h"
+#include "../utils/RenderStats.h"
 #include "../utils/ResamplingDriver.h"
+#include "../utils/ResamplingExporter.h"
 #include "../utils/SharedTimeSliceThread.h"
+#include "../utils/TraceRecorder.h"
 
-class ReaSpeechLitePlaybackRenderer final : public juce::ARAPlaybackRenderer
+class ReaSpeechLitePlaybackRenderer final : public juce::ARAPlaybackRenderer,
+                                            private juce::ARAAudioSource::Listener
 {
 public:
     ReaSpeechLitePlaybackRenderer (
         ARA::PlugIn::DocumentController* documentControllerIn,
-        ProcessingLockInterface& lockInterfaceIn,
-        bool useBufferedAudioSourceReaderIn = false,
-        int readTimeoutIn = 100
+        bool usePrefetchingReaderIn = true
     ) : ARAPlaybackRenderer(documentControllerIn),
-        lockInterface (lockInterfaceIn),
-        useBufferedAudioSourceReader (useBufferedAudioSourceReaderIn),
-        readTimeout (readTimeoutIn)
+        usePrefetchingReader (usePrefetchingReaderIn)
     {
+        computeBudget->addRenderStats (&renderStats);
+    }
+
+    ~ReaSpeechLitePlaybackRenderer() override
+    {
+        stopObservingSources();
+        computeBudget->removeRenderStats (&renderStats);
     }
 
     void prepareToPlay (
@@ -41,27 +58,64 @@ public:
         tempBuffer.reset (new juce::AudioBuffer<float> (destNumChannels, maximumSamplesPerBlock));
 
         for (const auto playbackRegion : getPlaybackRegions())
-            buildReader (playbackRegion);
+        {
+            const auto audioSource = playbackRegion->getAudioModification()->getAudioSource();
+            if (resamplers.find (audioSource) == resamplers.end())
+                buildReader (audioSource);
+        }
+
+        isPrepared = true;
+        publishRegionGraph();
     }
 
     void releaseResources() override
     {
+        DBG ("Playback renderer stats: " + renderStats.getSnapshot().toString()
+             + ", prefetch underruns: " + juce::String (getNumPrefetchUnderruns()));
+        renderStats.reset();
+
+        // The host has stopped rendering, so every graph can be freed
+        isPrepared = false;
+        regionGraph.publish (nullptr);
+
+        stopObservingSources();
+        uncachedSources.clear();
+        sampleEditedSources.clear();
+        prefetchers.clear();
+        readSampleRates.clear();
         resamplers.clear();
         tempBuffer.reset();
     }
 
     bool processBlock (
         juce::AudioBuffer<float>& buffer,
-        juce::AudioProcessor::Realtime,
+        juce::AudioProcessor::Realtime realtime,
         const juce::AudioPlayHead::PositionInfo& positionInfo) noexcept override
     {
-        const auto lock = lockInterface.getProcessingLock();
+        const ScopedTrace trace ("ReaSpeechLitePlaybackRenderer::processBlock", "audio");
+        const RenderStats::ScopedBlockTimer blockTimer (renderStats, buffer.getNumSamples(), destSampleRate);
+        const EpochSnapshot<RegionGraph>::ReadScope graph (regionGraph);
 
-        if (! lock.isLocked())
+        if (! graph)
+        {
+            renderStats.recordSilencedBlock();
+            buffer.clear();
             return true;
+        }
+
+        // The prefetchers are only visited when the graph or the render mode
+        // changes; otherwise a block touches just the regions it intersects
+        const auto isRealtime = realtime == juce::AudioProcessor::Realtime::yes;
+        if (graph->serial != appliedGraphSerial || isRealtime != appliedRealtime)
+            applyGraph (*graph, isRealtime);
+
+        const auto timeInSamples = positionInfo.getTimeInSamples().orFallback (0);
 
         if (! positionInfo.getIsPlaying())
         {
+            // Have audio at the playhead ready for when playback starts
+            cueUpcoming (*graph, timeInSamples, positionInfo);
+
             buffer.clear();
             return true;
         }
@@ -70,178 +124,495 @@ public:
         jassert (numSamples <= maximumSamplesPerBlock);
         jassert (destNumChannels == buffer.getNumChannels());
 
-        const auto timeInSamples = positionInfo.getTimeInSamples().orFallback (0);
         const auto blockRange = juce::Range<juce::int64>::withStartAndLength (timeInSamples, numSamples);
 
-        return render (buffer, blockRange);
+        const auto success = render (buffer, *graph, blockRange);
+        cueUpcoming (*graph, blockRange.getEnd(), positionInfo);
+        return success;
     }
 
     using ARAPlaybackRenderer::processBlock;
 
+    // Called by the document controller on the message thread after each
+    // edit. Rendering carries on with the previous graph until this one is
+    // published.
+    void didEndDocumentEdit()
+    {
+        if (isPrepared)
+        {
+            // Sources played from the cache go back to the host until their
+            // edited samples are cached again
+            for (auto* audioSource : sampleEditedSources)
+            {
+                if (uncachedSources.count (audioSource) > 0)
+                    cacheInBackground (audioSource);
+                else if (resamplers.find (audioSource) != resamplers.end())
+                    buildReader (audioSource);
+            }
+
+            publishRegionGraph();
+        }
+
+        sampleEditedSources.clear();
+    }
+
+    // Block timing statistics since the last prepareToPlay
+    const RenderStats& getRenderStats() const noexcept
+    {
+        return renderStats;
+    }
+
+    // Realtime reads that found no prefetched audio since the last prepareToPlay
+    juce::int64 getNumPrefetchUnderruns() const noexcept
+    {
+        juce::int64 numUnderruns = 0;
+
+        for (const auto& [audioSource, prefetch] : prefetchers)
+            numUnderruns += prefetch->reader->getNumUnderruns();
+
+        return numUnderruns;
+    }
+
 private:
-    void buildReader (juce::ARAPlaybackRegion* playbackRegion)
+    // A prefetching reader and the sample edits of its source
+    struct Prefetch
+    {
+        PrefetchingReader* reader = nullptr; // Owned by the source's resampler
+        std::atomic<juce::uint32> sampleEdits { 0 };
+        juce::uint32 invalidatedSampleEdits = 0; // Audio thread only
+    };
+
+    void didUpdateAudioSourceContent (juce::ARAAudioSource* audioSource, juce::ARAContentUpdateScopes scopeFlags) override
     {
-        auto audioSource = playbackRegion->getAudioModification()->getAudioSource();
-        if (resamplers.find (audioSource) != resamplers.end())
+        if (! scopeFlags.affectSamples())
             return;
 
-        std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+        sampleEditedSources.insert (audioSource);
 
-        if (useBufferedAudioSourceReader)
+        const auto it = prefetchers.find (audioSource);
+        if (it != prefetchers.end())
+            it->second->sampleEdits.fetch_add (1, std::memory_order_release);
+    }
+
+    void willDestroyAudioSource (juce::ARAAudioSource* audioSource) override
+    {
+        audioSource->removeListener (this);
+        observedSources.erase (audioSource);
+        uncachedSources.erase (audioSource);
+        sampleEditedSources.erase (audioSource);
+    }
+
+    void stopObservingSources()
+    {
+        for (auto* audioSource : observedSources)
+            audioSource->removeListener (this);
+
+        observedSources.clear();
+    }
+
+    // Builds the source's reader, replacing any it had. A replaced reader
+    // stays alive until no published graph refers to it.
+    void buildReader (juce::ARAAudioSource* audioSource)
+    {
+        if (observedSources.insert (audioSource).second)
+            audioSource->addListener (this);
+
+        prefetchers.erase (audioSource);
+        uncachedSources.erase (audioSource);
+
+        // Audio already decoded at the session's rate is read without host
+        // reads or resampling. Spilled renditions are memory-mapped, so reading
+        // one can wait on the disk, and they are only played through a prefetcher.
+        const auto rendition = pcmCache->find (getCacheKey (audioSource));
+
+        if (rendition != nullptr && (usePrefetchingReader || ! rendition->isSpilled()))
         {
-            readerSource = std::make_unique<juce::AudioFormatReaderSource> (
-                buildBufferedReader(audioSource), true);
+            std::unique_ptr<juce::AudioFormatReader> cachedReader = std::make_unique<PCMCache::Reader> (rendition);
+
+            if (rendition->isSpilled())
+                cachedReader = makePrefetchingReader (audioSource, std::move (cachedReader),
+                                                      std::make_unique<PCMCache::Reader> (rendition));
+
+            readSampleRates[audioSource] = destSampleRate;
+            resamplers[audioSource] = std::make_shared<ResamplingDriver> (std::move (cachedReader), destNumChannels);
+            return;
         }
+
+        // Played from the host until it is decoded in the background
+        if (rendition == nullptr)
+        {
+            uncachedSources.insert (audioSource);
+            cacheInBackground (audioSource);
+        }
+
+        readSampleRates[audioSource] = audioSource->getSampleRate();
+
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        if (usePrefetchingReader)
+            reader = makePrefetchingReader (audioSource,
+                                            std::make_unique<juce::ARAAudioSourceReader> (audioSource),
+                                            std::make_unique<juce::ARAAudioSourceReader> (audioSource));
         else
+            reader = std::make_unique<juce::ARAAudioSourceReader> (audioSource);
+
+        // Sources at the session's rate are read without resampling
+        if (juce::exactlyEqual (audioSource->getSampleRate(), destSampleRate))
         {
-            readerSource = std::make_unique<juce::AudioFormatReaderSource> (
-                new juce::ARAAudioSourceReader (audioSource), true);
+            resamplers[audioSource] = std::make_shared<ResamplingDriver> (std::move (reader), destNumChannels);
+            return;
         }
 
+        auto readerSource = std::make_unique<juce::AudioFormatReaderSource> (reader.release(), true);
+
         auto resamplingSource = std::make_unique<juce::ResamplingAudioSource> (
             readerSource.get(), false, audioSource->getChannelCount());
 
         resamplingSource->setResamplingRatio (audioSource->getSampleRate() / destSampleRate);
 
-        resamplers.emplace (audioSource, std::make_unique<ResamplingDriver> (
+        resamplers[audioSource] = std::make_shared<ResamplingDriver> (
             std::move (readerSource),
-            std::move (resamplingSource)));
+            std::move (resamplingSource));
     }
 
-    juce::BufferingAudioReader* buildBufferedReader(juce::ARAAudioSource* audioSource)
+    PCMCache::Key getCacheKey (juce::ARAAudioSource* audioSource) const
     {
-        const auto readAheadSize =
-            juce::jmax (4 * maximumSamplesPerBlock, juce::roundToInt (2.0 * destSampleRate));
+        return { audioSource, destSampleRate, PCMCache::allChannels };
+    }
 
-        auto bufferingReader = new juce::BufferingAudioReader (
-            new juce::ARAAudioSourceReader (audioSource),
-            *sharedTimesliceThread,
-            readAheadSize);
+    // Decodes the source at the session's rate on the cache's thread, and
+    // switches it to the decoded audio once that is done
+    void cacheInBackground (juce::ARAAudioSource* audioSource)
+    {
+        pcmCache->renderInBackground (getCacheKey (audioSource),
+                                      [audioSource, rate = destSampleRate] (PCMCache::RenditionWriter& writer,
+                                                                            const std::function<bool()>& isAborted)
+                                      {
+                                          return ResamplingExporter::render (audioSource, rate, PCMCache::allChannels, writer, isAborted);
+                                      },
+                                      [weakThis = juce::WeakReference<ReaSpeechLitePlaybackRenderer> (this), audioSource]
+                                      {
+                                          juce::MessageManager::callAsync ([weakThis, audioSource]
+                                          {
+                                              if (weakThis != nullptr)
+                                                  weakThis->didCacheSource (audioSource);
+                                          });
+                                      });
+    }
 
-        bufferingReader->setReadTimeout (readTimeout);
+    // Message thread only
+    void didCacheSource (juce::ARAAudioSource* audioSource)
+    {
+        // Playback may have been released, or the source edited or destroyed, since
+        if (! isPrepared || uncachedSources.count (audioSource) == 0)
+            return;
 
-        return bufferingReader;
+        if (pcmCache->find (getCacheKey (audioSource)) == nullptr)
+            return;
+
+        buildReader (audioSource);
+        publishRegionGraph();
+    }
+
+    // The readers must read the same audio. The prefetcher is owned by the caller.
+    std::unique_ptr<PrefetchingReader> makePrefetchingReader (
+        juce::ARAAudioSource* audioSource,
+        std::unique_ptr<juce::AudioFormatReader> backgroundReader,
+        std::unique_ptr<juce::AudioFormatReader> directReader)
+    {
+        auto prefetcher = std::make_unique<PrefetchingReader> (
+            std::move (backgroundReader), std::move (directReader), *sharedTimesliceThread);
+
+        auto prefetch = std::make_shared<Prefetch>();
+        prefetch->reader = prefetcher.get();
+        prefetchers[audioSource] = std::move (prefetch);
+
+        return prefetcher;
     }
 
-    bool render (juce::AudioBuffer<float>& buffer, const juce::Range<juce::int64>& blockRange)
+    //==============================================================================
+    // A playback region's sample ranges and reader, resolved ahead of rendering
+    struct RegionEntry
     {
-        bool success = true;
-        bool didRenderAnyRegion = false;
+        juce::Range<juce::int64> renderRange; // Playback samples the region can render
+        juce::int64 modificationOffset = 0;   // Modification sample minus playback sample
+        ResamplingDriver* driver = nullptr;
+        PrefetchingReader* prefetcher = nullptr; // Null when reading synchronously
+        int sourceNumChannels = 1;
+        double sourceSamplesPerDestSample = 1.0;
+    };
+
+    // Immutable view of the regions for the audio thread, indexed by their
+    // render ranges, so a block only visits the regions that intersect it
+    struct RegionGraph
+    {
+        IntervalIndex<RegionEntry, juce::int64> regions;
+        int numRegionsWithoutReader = 0;
+
+        // Identifies the graph, since a freed graph's address can be reused
+        juce::uint64 serial = 0;
 
-        for (const auto& playbackRegion : getPlaybackRegions())
+        // Every prefetcher, with the sample edits it was last invalidated for.
+        // Sample edits happen within document edits, each of which ends in a
+        // new graph, so the prefetchers are checked once per graph.
+        std::vector<std::shared_ptr<Prefetch>> prefetches;
+
+        // Keeps the readers the regions refer to alive after they are
+        // replaced, until the graph is freed on the message thread
+        std::vector<std::shared_ptr<ResamplingDriver>> drivers;
+
+        // Calls fn (entry) for each region that intersects the range
+        template <typename Fn>
+        void forEachRegionIntersecting (const juce::Range<juce::int64>& range, Fn&& fn) const
         {
-            success = success &&
-                renderRegion (buffer, playbackRegion, blockRange, didRenderAnyRegion);
+            if (range.isEmpty())
+                return;
+
+            // The index holds closed intervals of the regions' first and last
+            // samples, so it's queried with the first and last of the range
+            regions.forEachOverlapping (range.getStart(), range.getEnd() - 1, [&fn] (const auto& interval)
+            {
+                fn (interval.value);
+                return true;
+            });
         }
+    };
+
+    // Resolves each region's sample ranges and reader on the message thread,
+    // and publishes them for the audio thread without blocking it
+    void publishRegionGraph()
+    {
+        const ScopedTrace trace ("ReaSpeechLitePlaybackRenderer::publishRegionGraph", "ara");
+
+        auto graph = std::make_unique<RegionGraph>();
+        graph->regions.reserve (getPlaybackRegions().size());
+        graph->serial = ++lastGraphSerial;
+        graph->prefetches.reserve (prefetchers.size());
+        graph->drivers.reserve (resamplers.size());
+
+        for (const auto& [audioSource, prefetch] : prefetchers)
+            graph->prefetches.push_back (prefetch);
+
+        for (const auto& [audioSource, driver] : resamplers)
+            graph->drivers.push_back (driver);
+
+        for (const auto playbackRegion : getPlaybackRegions())
+        {
+            // Get the audio source for the region and find the reader and resampling sources.
+            const auto audioSource = playbackRegion->getAudioModification()->getAudioSource();
+            const auto resamplerIt = resamplers.find (audioSource);
+
+            if (resamplerIt == resamplers.end())
+            {
+                ++graph->numRegionsWithoutReader;
+                continue;
+            }
+
+            auto sourceSampleRate = audioSource->getSampleRate();
+            auto destSamplesPerSourceSample = destSampleRate / sourceSampleRate;
+
+            // Evaluate region borders in song time, calculate sample range to render in song time.
+            // Note that this example does not use head- or tailtime, so the includeHeadAndTail
+            // parameter is set to false here - this might need to be adjusted in actual plug-ins.
+            const auto destPlaybackSampleRange =
+                playbackRegion->getSampleRange (destSampleRate, juce::ARAPlaybackRegion::IncludeHeadAndTail::no);
+
+            // Evaluate region borders in modification/source time and calculate offset between
+            // song and source samples, then clip song samples accordingly
+            // (if an actual plug-in supports time stretching, this must be taken into account here).
+            juce::Range<juce::int64> destModificationSampleRange {
+                juce::roundToInt (playbackRegion->getStartInAudioModificationSamples() * destSamplesPerSourceSample),
+                juce::roundToInt (playbackRegion->getEndInAudioModificationSamples() * destSamplesPerSourceSample)
+            };
+
+            const auto renderRange = destPlaybackSampleRange.getIntersectionWith (
+                destModificationSampleRange.movedToStartAt (
+                    destPlaybackSampleRange.getStart()));
+
+            if (renderRange.isEmpty())
+                continue;
+
+            const auto prefetcherIt = prefetchers.find (audioSource);
+            const auto readSampleRate = readSampleRates.at (audioSource);
+
+            graph->regions.add (renderRange.getStart(), renderRange.getEnd() - 1, {
+                renderRange,
+                destModificationSampleRange.getStart() - destPlaybackSampleRange.getStart(),
+                resamplerIt->second.get(),
+                prefetcherIt != prefetchers.end() ? prefetcherIt->second->reader : nullptr,
+                audioSource->getChannelCount(),
+                readSampleRate / destSampleRate
+            });
+        }
+
+        graph->regions.build();
+        regionGraph.publish (std::move (graph));
+    }
+
+    // Discards prefetched audio of sources whose samples changed, and sets
+    // the prefetchers' render mode. Audio thread only.
+    void applyGraph (const RegionGraph& graph, bool isRealtime) noexcept
+    {
+        for (const auto& prefetch : graph.prefetches)
+        {
+            const auto sampleEdits = prefetch->sampleEdits.load (std::memory_order_acquire);
+            if (sampleEdits != prefetch->invalidatedSampleEdits)
+            {
+                prefetch->reader->invalidate();
+                prefetch->invalidatedSampleEdits = sampleEdits;
+            }
+
+            prefetch->reader->setRealtime (isRealtime);
+        }
+
+        appliedGraphSerial = graph.serial;
+        appliedRealtime = isRealtime;
+    }
+
+    bool render (juce::AudioBuffer<float>& buffer, const RegionGraph& graph, const juce::Range<juce::int64>& blockRange)
+    {
+        // Whether the buffer has been taken over from the host's input
+        bool isBufferOwned = false;
+
+        graph.forEachRegionIntersecting (blockRange, [&] (const RegionEntry& region)
+        {
+            renderRegion (buffer, region, blockRange, isBufferOwned);
+        });
 
         // If no playback or no region did intersect, clear buffer now.
-        if (! didRenderAnyRegion)
+        if (! isBufferOwned)
             buffer.clear();
 
-        return success;
+        // A region whose source has no reader can't be rendered
+        return graph.numRegionsWithoutReader == 0;
     }
 
-    bool renderRegion (
-        juce::AudioBuffer<float>& buffer,
-        juce::ARAPlaybackRegion* playbackRegion,
-        const juce::Range<juce::int64>& blockRange,
-        bool& didRenderAnyRegion)
+    // Cues the prefetchers with audio needed within the lookahead: regions
+    // playing at or starting after the position, and if the loop wraps
+    // within the lookahead, regions playing from the loop start
+    void cueUpcoming (const RegionGraph& graph, juce::int64 position, const juce::AudioPlayHead::PositionInfo& positionInfo) noexcept
     {
-        // Get the audio source for the region and find the reader and resampling sources.
-        const auto audioSource = playbackRegion->getAudioModification()->getAudioSource();
-        const auto resamplerIt = resamplers.find (audioSource);
+        const auto lookahead = (juce::int64) (Config::prefetchLookaheadSeconds * destSampleRate);
+        const auto upcoming = juce::Range<juce::int64>::withStartAndLength (position, lookahead);
 
-        if (resamplerIt == resamplers.end())
-            return false;
+        cueRange (graph, upcoming);
 
-        auto& resampler = resamplerIt->second;
+        const auto loopRange = getLoopRange (positionInfo);
+        if (! loopRange.isEmpty() && upcoming.contains (loopRange.getEnd()))
+            cueRange (graph, juce::Range<juce::int64>::withStartAndLength (loopRange.getStart(), lookahead));
+    }
 
-        auto sourceSampleRate = audioSource->getSampleRate();
-        auto sourceNumChannels = audioSource->getChannelCount();
+    static void cueRange (const RegionGraph& graph, const juce::Range<juce::int64>& range) noexcept
+    {
+        graph.forEachRegionIntersecting (range, [&range] (const RegionEntry& region)
+        {
+            if (region.prefetcher == nullptr)
+                return;
 
-        auto destSamplesPerSourceSample = destSampleRate / sourceSampleRate;
-        auto sourceSamplesPerDestSample = sourceSampleRate / destSampleRate;
+            const auto destStart = juce::jmax (region.renderRange.getStart(), range.getStart());
+            region.prefetcher->cue (juce::roundToInt ((destStart + region.modificationOffset)
+                                                      * region.sourceSamplesPerDestSample));
+        });
+    }
 
-        // Evaluate region borders in song time, calculate sample range to render in song time.
-        // Note that this example does not use head- or tailtime, so the includeHeadAndTail
-        // parameter is set to false here - this might need to be adjusted in actual plug-ins.
-        const auto destPlaybackSampleRange =
-            playbackRegion->getSampleRange (destSampleRate, juce::ARAPlaybackRegion::IncludeHeadAndTail::no);
+    // The loop range in samples, converted at the current tempo, or an empty
+    // range if the host isn't looping or doesn't report enough to convert it
+    juce::Range<juce::int64> getLoopRange (const juce::AudioPlayHead::PositionInfo& positionInfo) const noexcept
+    {
+        const auto loopPoints = positionInfo.getLoopPoints();
+        const auto timeInSamples = positionInfo.getTimeInSamples();
+        const auto ppqPosition = positionInfo.getPpqPosition();
+        const auto bpm = positionInfo.getBpm();
 
-        auto destRenderRange = blockRange.getIntersectionWith (destPlaybackSampleRange);
-        if (destRenderRange.isEmpty())
-            return true;
+        if (! positionInfo.getIsLooping() || ! loopPoints || ! timeInSamples || ! ppqPosition || ! bpm || *bpm <= 0.0)
+            return {};
 
-        // Evaluate region borders in modification/source time and calculate offset between
-        // song and source samples, then clip song samples accordingly
-        // (if an actual plug-in supports time stretching, this must be taken into account here).
-        juce::Range<juce::int64> destModificationSampleRange {
-            juce::roundToInt (playbackRegion->getStartInAudioModificationSamples() * destSamplesPerSourceSample),
-            juce::roundToInt (playbackRegion->getEndInAudioModificationSamples() * destSamplesPerSourceSample)
+        const auto samplesPerQuarterNote = 60.0 / *bpm * destSampleRate;
+        const auto toSamples = [&] (double ppq)
+        {
+            return *timeInSamples + (juce::int64) std::llround ((ppq - *ppqPosition) * samplesPerQuarterNote);
         };
 
-        const auto destModificationSampleOffset =
-            destModificationSampleRange.getStart() - destPlaybackSampleRange.getStart();
-
-        destRenderRange = destRenderRange.getIntersectionWith (
-            destModificationSampleRange.movedToStartAt (
-                destPlaybackSampleRange.getStart()));
+        return { toSamples (loopPoints->ppqStart), toSamples (loopPoints->ppqEnd) };
+    }
 
+    // Adds a region's audio to the buffer. The first region rendered in a
+    // block clears it first, or reads straight into it if it covers it.
+    void renderRegion (
+        juce::AudioBuffer<float>& buffer,
+        const RegionEntry& region,
+        const juce::Range<juce::int64>& blockRange,
+        bool& isBufferOwned)
+    {
+        const auto destRenderRange = blockRange.getIntersectionWith (region.renderRange);
         if (destRenderRange.isEmpty())
-            return true;
+            return;
 
         // Calculate buffer offsets.
         const int destNumSamples = (int) (destRenderRange.getLength());
         const int destStartSample = (int) (destRenderRange.getStart() - blockRange.getStart());
         const int sourceStartSample = juce::roundToInt (
-            (destRenderRange.getStart() + destModificationSampleOffset)
-            * sourceSamplesPerDestSample);
+            (destRenderRange.getStart() + region.modificationOffset)
+            * region.sourceSamplesPerDestSample);
 
-        resampler->seek (sourceStartSample);
-        resampler->read (juce::AudioSourceChannelInfo (*tempBuffer));
+        region.driver->seek (sourceStartSample);
 
-        // Mix local buffer into the output buffer.
-        for (int destChannel = 0; destChannel < destNumChannels; ++destChannel)
+        if (! isBufferOwned)
         {
-            auto sourceChannel = juce::jmin (destChannel, sourceNumChannels - 1);
-            buffer.addFrom (
-                destChannel,
-                destStartSample,
-                *tempBuffer,
-                sourceChannel,
-                0,
-                destNumSamples);
-        }
+            isBufferOwned = true;
 
-        if (! didRenderAnyRegion)
-        {
-            // Clear any excess at start or end of the region.
-            if (destStartSample != 0)
-                buffer.clear (0, destStartSample);
+            if (region.driver->isDirect() && destRenderRange == blockRange)
+            {
+                region.driver->readDirect (buffer, 0, destNumSamples);
+                return;
+            }
 
-            const int destEndSample = destStartSample + destNumSamples;
-            const int destRemainingSamples = (int) blockRange.getLength() - destEndSample;
+            buffer.clear();
+        }
 
-            if (destRemainingSamples != 0)
-                buffer.clear (destEndSample, destRemainingSamples);
+        if (region.driver->isDirect())
+            region.driver->readDirect (*tempBuffer, 0, destNumSamples);
+        else
+            region.driver->read (juce::AudioSourceChannelInfo (*tempBuffer));
 
-            didRenderAnyRegion = true;
+        // Mix local buffer into the output buffer
+        for (int destChannel = 0; destChannel < destNumChannels; ++destChannel)
+        {
+            auto sourceChannel = juce::jmin (destChannel, region.sourceNumChannels - 1);
+            buffer.addFrom (destChannel, destStartSample, *tempBuffer, sourceChannel, 0, destNumSamples);
         }
-
-        return true;
     }
 
-    ProcessingLockInterface& lockInterface;
     juce::SharedResourcePointer<SharedTimeSliceThread> sharedTimesliceThread;
+    RenderStats renderStats;
+    juce::SharedResourcePointer<ComputeBudget> computeBudget;
+    juce::SharedResourcePointer<PCMCache> pcmCache;
 
     double destSampleRate = 48000.0;
     int destNumChannels = 2;
     int maximumSamplesPerBlock = 128;
-    bool useBufferedAudioSourceReader = false;
-    int readTimeout = 0;
-
-    std::map<juce::ARAAudioSource*, std::unique_ptr<ResamplingDriver>> resamplers;
+    bool usePrefetchingReader = true;
+
+    std::map<juce::ARAAudioSource*, std::shared_ptr<ResamplingDriver>> resamplers;
+    std::map<juce::ARAAudioSource*, std::shared_ptr<Prefetch>> prefetchers;
+    std::set<juce::ARAAudioSource*> observedSources;
+    // Played from the host while their audio is decoded in the background
+    std::set<juce::ARAAudioSource*> uncachedSources;
+    // Sources whose samples changed during the current document edit
+    std::set<juce::ARAAudioSource*> sampleEditedSources;
+    // Rate of the audio each resampler reads: the source's, or the session's if cached
+    std::map<juce::ARAAudioSource*, double> readSampleRates;
     std::unique_ptr<juce::AudioBuffer<float>> tempBuffer;
 
+    // Published on prepareToPlay and after document edits
+    EpochSnapshot<RegionGraph> regionGraph;
+    juce::uint64 lastGraphSerial = 0;
+    bool isPrepared = false;
+
+    // The graph and render mode the prefetchers were last set up for. Audio thread only.
+    juce::uint64 appliedGraphSerial = 0;
+    bool appliedRealtime = false;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (ReaSpeechLitePlaybackRenderer)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReaSpeechLitePlaybackRenderer)
 };
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_core/juce_core.h>
+
+#include "../utils/SafeUTF8.h"
+
+// Cached view of the document's playback regions, as sent to the UI.
+//
+// Each playback region is serialized once and kept until the host changes
+// it. Changes are collected from ARA model listeners during an editing cycle
+// and, when the cycle ends, reported to listeners as one versioned diff:
+// { baseVersion, version, added: [region], moved: [region], removed: [id] }.
+// Regions get an ID, unique for the lifetime of the model, so the UI can
+// apply a diff without a full traversal on either side.
+//
+// All methods and notifications are on the message thread.
+class RegionSequenceModel :
+    private juce::ARADocument::Listener,
+    private juce::ARARegionSequence::Listener,
+    private juce::ARAPlaybackRegion::Listener
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void playbackRegionsChanged (const juce::var& diff) = 0;
+    };
+
+    explicit RegionSequenceModel (juce::ARADocument& documentIn) : document (&documentIn)
+    {
+        document->addListener (this);
+
+        for (auto* regionSequence : document->getRegionSequences())
+            addRegionSequence (regionSequence, false);
+    }
+
+    ~RegionSequenceModel() override
+    {
+        detach();
+    }
+
+    void addListener (Listener* listener) { listeners.add (listener); }
+    void removeListener (Listener* listener) { listeners.remove (listener); }
+
+    juce::int64 getVersion() const noexcept { return version; }
+
+    // Returns { version, regions: [region] }, with regions in document order
+    juce::var getSnapshot() const
+    {
+        juce::Array<juce::var> regionsVar;
+        regionsVar.ensureStorageAllocated ((int) regions.size());
+
+        forEachEntry ([&regionsVar] (const juce::ARAPlaybackRegion&, const Entry& entry)
+        {
+            regionsVar.add (entry.data);
+        });
+
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty ("version", version);
+        obj->setProperty ("regions", regionsVar);
+        return juce::var (obj.get());
+    }
+
+    // Calls fn (playbackRegion, id) for each playback region in the model,
+    // in document order
+    template <typename Fn>
+    void forEachPlaybackRegion (Fn&& fn) const
+    {
+        forEachEntry ([&fn] (const juce::ARAPlaybackRegion& playbackRegion, const Entry& entry)
+        {
+            fn (playbackRegion, entry.id);
+        });
+    }
+
+    // Returns region sequences with their playback regions, in document
+    // order, built from the cached regions
+    juce::var getRegionSequences() const
+    {
+        juce::Array<juce::var> regionSequences;
+        if (document == nullptr)
+            return regionSequences;
+
+        for (const auto* rs : document->getRegionSequences())
+        {
+            juce::DynamicObject::Ptr regionSequence = new juce::DynamicObject();
+            regionSequence->setProperty ("name", SafeUTF8::encode (rs->getName()));
+            regionSequence->setProperty ("orderIndex", rs->getOrderIndex());
+
+            juce::Array<juce::var> playbackRegions;
+            for (auto* pr : rs->getPlaybackRegions())
+            {
+                const auto it = regions.find (pr);
+                if (it != regions.end())
+                    playbackRegions.add (it->second.data);
+            }
+            regionSequence->setProperty ("playbackRegions", playbackRegions);
+
+            regionSequences.add (regionSequence.get());
+        }
+
+        return regionSequences;
+    }
+
+private:
+    struct Entry
+    {
+        int id = 0;
+        juce::var data;
+    };
+
+    // Calls fn (playbackRegion, entry) for each cached region, in document
+    // order: region sequences in order, then their regions in order
+    template <typename Fn>
+    void forEachEntry (Fn&& fn) const
+    {
+        if (document == nullptr)
+            return;
+
+        for (const auto* regionSequence : document->getRegionSequences())
+        {
+            for (auto* playbackRegion : regionSequence->getPlaybackRegions())
+            {
+                const auto it = regions.find (playbackRegion);
+                if (it != regions.end())
+                    fn (*playbackRegion, it->second);
+            }
+        }
+    }
+
+    //==============================================================================
+    void didEndEditing (juce::ARADocument*) override
+    {
+        if (changedRegions.empty() && removedIDs.isEmpty())
+            return;
+
+        juce::Array<juce::var> added, moved;
+
+        for (auto* playbackRegion : changedRegions)
+        {
+            auto& entry = regions.at (playbackRegion);
+            entry.data = toVar (*playbackRegion, entry.id);
+
+            if (addedIDs.count (entry.id) > 0)
+                added.add (entry.data);
+            else
+                moved.add (entry.data);
+        }
+
+        juce::DynamicObject::Ptr diff = new juce::DynamicObject();
+        diff->setProperty ("baseVersion", version);
+        diff->setProperty ("version", ++version);
+        diff->setProperty ("added", added);
+        diff->setProperty ("moved", moved);
+        diff->setProperty ("removed", removedIDs);
+
+        changedRegions.clear();
+        addedIDs.clear();
+        removedIDs.clear();
+
+        const juce::var diffVar (diff.get());
+        listeners.call ([&] (Listener& l) { l.playbackRegionsChanged (diffVar); });
+    }
+
+    void didAddRegionSequenceToDocument (juce::ARADocument*, juce::ARARegionSequence* regionSequence) override
+    {
+        addRegionSequence (regionSequence, true);
+    }
+
+    void willRemoveRegionSequenceFromDocument (juce::ARADocument*, juce::ARARegionSequence* regionSequence) override
+    {
+        for (auto* playbackRegion : regionSequence->getPlaybackRegions())
+            removePlaybackRegion (playbackRegion);
+
+        regionSequence->removeListener (this);
+    }
+
+    void didReorderRegionSequencesInDocument (juce::ARADocument*) override
+    {
+        // Order indices are part of every region
+        for (const auto& [playbackRegion, entry] : regions)
+            changedRegions.insert (playbackRegion);
+    }
+
+    void willDestroyDocument (juce::ARADocument*) override
+    {
+        detach();
+    }
+
+    //==============================================================================
+    void didUpdateRegionSequenceProperties (juce::ARARegionSequence* regionSequence) override
+    {
+        for (auto* playbackRegion : regionSequence->getPlaybackRegions())
+            if (regions.count (playbackRegion) > 0)
+                changedRegions.insert (playbackRegion);
+    }
+
+    void didAddPlaybackRegionToRegionSequence (juce::ARARegionSequence*, juce::ARAPlaybackRegion* playbackRegion) override
+    {
+        addPlaybackRegion (playbackRegion, true);
+    }
+
+    void willRemovePlaybackRegionFromRegionSequence (juce::ARARegionSequence*, juce::ARAPlaybackRegion* playbackRegion) override
+    {
+        removePlaybackRegion (playbackRegion);
+    }
+
+    //==============================================================================
+    void didUpdatePlaybackRegionProperties (juce::ARAPlaybackRegion* playbackRegion) override
+    {
+        if (regions.count (playbackRegion) > 0)
+            changedRegions.insert (playbackRegion);
+    }
+
+    void willDestroyPlaybackRegion (juce::ARAPlaybackRegion* playbackRegion) override
+    {
+        removePlaybackRegion (playbackRegion);
+    }
+
+    //==============================================================================
+    void addRegionSequence (juce::ARARegionSequence* regionSequence, bool report)
+    {
+        regionSequence->addListener (this);
+
+        for (auto* playbackRegion : regionSequence->getPlaybackRegions())
+            addPlaybackRegion (playbackRegion, report);
+    }
+
+    void addPlaybackRegion (juce::ARAPlaybackRegion* playbackRegion, bool report)
+    {
+        if (regions.count (playbackRegion) > 0)
+            return;
+
+        playbackRegion->addListener (this);
+
+        const auto id = nextID++;
+        regions[playbackRegion] = { id, report ? juce::var() : toVar (*playbackRegion, id) };
+
+        if (report)
+        {
+            changedRegions.insert (playbackRegion);
+            addedIDs.insert (id);
+        }
+    }
+
+    void removePlaybackRegion (juce::ARAPlaybackRegion* playbackRegion)
+    {
+        const auto it = regions.find (playbackRegion);
+        if (it == regions.end())
+            return;
+
+        playbackRegion->removeListener (this);
+
+        // Regions added and removed in the same cycle are never reported
+        const auto id = it->second.id;
+        if (addedIDs.erase (id) == 0)
+            removedIDs.add (id);
+
+        changedRegions.erase (playbackRegion);
+        regions.erase (it);
+    }
+
+    void detach()
+    {
+        if (document == nullptr)
+            return;
+
+        for (auto* regionSequence : document->getRegionSequences())
+            regionSequence->removeListener (this);
+
+        for (const auto& [playbackRegion, entry] : regions)
+            playbackRegion->removeListener (this);
+
+        document->removeListener (this);
+        document = nullptr;
+
+        regions.clear();
+        changedRegions.clear();
+    }
+
+    static juce::var toVar (const juce::ARAPlaybackRegion& pr, int id)
+    {
+        const auto* regionSequence = pr.getRegionSequence();
+        const auto* audioSource = pr.getAudioModification()->getAudioSource();
+
+        juce::DynamicObject::Ptr playbackRegion = new juce::DynamicObject();
+        playbackRegion->setProperty ("id", id);
+        playbackRegion->setProperty ("name", SafeUTF8::encode (pr.getName()));
+        playbackRegion->setProperty ("regionSequenceName", SafeUTF8::encode (regionSequence->getName()));
+        playbackRegion->setProperty ("orderIndex", regionSequence->getOrderIndex());
+        playbackRegion->setProperty ("playbackStart", pr.getStartInPlaybackTime());
+        playbackRegion->setProperty ("playbackEnd", pr.getEndInPlaybackTime());
+        playbackRegion->setProperty ("modificationStart", pr.getStartInAudioModificationTime());
+        playbackRegion->setProperty ("modificationEnd", pr.getEndInAudioModificationTime());
+        playbackRegion->setProperty ("audioSourcePersistentID", juce::String (audioSource->getPersistentID()));
+        return juce::var (playbackRegion.get());
+    }
+
+    juce::ARADocument* document = nullptr;
+    juce::int64 version = 0;
+    int nextID = 1;
+
+    std::unordered_map<juce::ARAPlaybackRegion*, Entry> regions;
+    std::unordered_set<juce::ARAPlaybackRegion*> changedRegions;
+    std::unordered_set<int> addedIDs;
+    juce::Array<juce::var> removedIDs;
+
+    juce::ListenerList<Listener> listeners;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RegionSequenceModel)
+};
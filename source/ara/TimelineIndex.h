@@ -0,0 +1,199 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#include "../asr/ASRTranscript.h"
+#include "../utils/IntervalIndex.h"
+
+// Maps playback time to the transcript segment and word being played.
+//
+// Two indexes are composed: one over playback regions, mapping playback time
+// to audio source time, and one per audio source over transcript segments,
+// mapping source time to a segment. Words are then found by binary search
+// within the segment. Each part is rebuilt only when its version changes,
+// so a lookup is O(log n) however long the transcripts are. A source's
+// segments are only indexed once a lookup reaches it, so transcripts that
+// are never looked up are never loaded. Only a weak reference to each
+// transcript is kept, so the index doesn't stop its owner from editing it
+// in place. All methods must be called from the same thread.
+class TimelineIndex
+{
+public:
+    struct Region
+    {
+        int id = 0;
+        juce::String sourceID;
+        double playbackStart = 0.0;
+        double playbackEnd = 0.0;
+        double sourceStart = 0.0;
+        double sourceEnd = 0.0;
+
+        double toPlaybackTime (double sourceTime) const noexcept { return playbackStart + sourceTime - sourceStart; }
+        double toSourceTime (double playbackTime) const noexcept { return sourceStart + playbackTime - playbackStart; }
+    };
+
+    struct Hit
+    {
+        const Region* region = nullptr; // Null for a source time lookup outside any region
+        juce::String sourceID;
+        double sourceTime = 0.0;
+        std::shared_ptr<const ASRTranscript> transcript;
+        int segment = -1;
+        int word = -1;
+    };
+
+    // Returns a source's transcript when its segments need indexing
+    using TranscriptLoader = std::function<std::shared_ptr<const ASRTranscript> (const juce::String& sourceID)>;
+
+    explicit TimelineIndex (TranscriptLoader loaderIn) : loader (std::move (loaderIn))
+    {
+    }
+
+    bool needsRegionUpdate (juce::int64 version) const noexcept { return version != regionsVersion; }
+
+    void updateRegions (juce::int64 version, std::vector<Region> regionsIn)
+    {
+        regionsVersion = version;
+        regions = std::move (regionsIn);
+
+        regionsByPlaybackTime.clear();
+        regionsByPlaybackTime.reserve (regions.size());
+        regionsBySourceTime.clear();
+
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            const auto& region = regions[i];
+            regionsByPlaybackTime.add (region.playbackStart, region.playbackEnd, i);
+            regionsBySourceTime[region.sourceID].add (region.sourceStart, region.sourceEnd, i);
+        }
+
+        regionsByPlaybackTime.build();
+        for (auto& [sourceID, index] : regionsBySourceTime)
+            index.build();
+    }
+
+    const std::vector<Region>& getRegions() const noexcept { return regions; }
+
+    // Records a source's current transcript version. A changed transcript is
+    // reloaded on the next lookup that reaches it.
+    void setTranscriptVersion (const juce::String& sourceID, juce::int64 version)
+    {
+        sources[sourceID].latestVersion = version;
+    }
+
+    // Drops transcripts of sources that are not in the given set
+    void retainOnly (const juce::StringArray& sourceIDs)
+    {
+        for (auto it = sources.begin(); it != sources.end();)
+            it = sourceIDs.contains (it->first) ? std::next (it) : sources.erase (it);
+    }
+
+    // Returns a hit for each playback region playing at the given time, latest
+    // starting region first
+    std::vector<Hit> lookupPlaybackTime (double time)
+    {
+        std::vector<Hit> hits;
+
+        regionsByPlaybackTime.forEachContaining (time, [&] (const auto& interval)
+        {
+            const auto& region = regions[interval.value];
+            hits.push_back (makeHit (&region, region.sourceID, region.toSourceTime (time)));
+            return true;
+        });
+
+        return hits;
+    }
+
+    // Returns a hit for each playback region of the source that plays the
+    // given source time, or a single hit without a region if none does
+    std::vector<Hit> lookupSourceTime (const juce::String& sourceID, double time)
+    {
+        std::vector<Hit> hits;
+
+        if (const auto it = regionsBySourceTime.find (sourceID); it != regionsBySourceTime.end())
+        {
+            it->second.forEachContaining (time, [&] (const auto& interval)
+            {
+                hits.push_back (makeHit (&regions[interval.value], sourceID, time));
+                return true;
+            });
+        }
+
+        if (hits.empty())
+            hits.push_back (makeHit (nullptr, sourceID, time));
+
+        return hits;
+    }
+
+private:
+    struct SourceIndex
+    {
+        juce::int64 latestVersion = -1;
+        juce::int64 version = -1;
+        std::weak_ptr<const ASRTranscript> transcript;
+        bool hasTranscript = false;
+        IntervalIndex<int> segments;
+    };
+
+    // Returns the source's index, with its transcript in transcript, loading
+    // the transcript again if it changed or was let go. Returns nullptr if
+    // the source is unknown.
+    const SourceIndex* getSourceIndex (const juce::String& sourceID, std::shared_ptr<const ASRTranscript>& transcript)
+    {
+        const auto it = sources.find (sourceID);
+        if (it == sources.end())
+            return nullptr;
+
+        auto& source = it->second;
+        transcript = source.transcript.lock();
+
+        if (source.version == source.latestVersion && (transcript != nullptr) == source.hasTranscript)
+            return &source;
+
+        source.version = source.latestVersion;
+        transcript = loader (sourceID);
+        source.transcript = transcript;
+        source.hasTranscript = transcript != nullptr;
+        source.segments.clear();
+
+        if (transcript != nullptr)
+        {
+            source.segments.reserve ((size_t) transcript->getNumSegments());
+            for (int i = 0; i < transcript->getNumSegments(); ++i)
+                source.segments.add (transcript->getSegmentStart (i), transcript->getSegmentEnd (i), i);
+        }
+
+        source.segments.build();
+        return &source;
+    }
+
+    Hit makeHit (const Region* region, const juce::String& sourceID, double time)
+    {
+        Hit hit { region, sourceID, time, nullptr, -1, -1 };
+
+        const auto* source = getSourceIndex (sourceID, hit.transcript);
+        if (source == nullptr || hit.transcript == nullptr)
+            return hit;
+
+        if (const auto* segment = source->segments.findLatestContaining (time))
+        {
+            hit.segment = segment->value;
+            hit.word = hit.transcript->findWordAt (hit.segment, (float) time);
+        }
+
+        return hit;
+    }
+
+    juce::int64 regionsVersion = -1;
+    std::vector<Region> regions;
+    IntervalIndex<size_t> regionsByPlaybackTime;
+    std::map<juce::String, IntervalIndex<size_t>> regionsBySourceTime;
+
+    TranscriptLoader loader;
+    std::map<juce::String, SourceIndex> sources;
+};
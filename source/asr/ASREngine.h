@@ -1,48 +1,59 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <juce_core/juce_core.h>
 #include <whisper.h>
 
+#include "../utils/ComputeBudget.h"
 #include "../utils/SafeUTF8.h"
+#include "../utils/TraceRecorder.h"
 #include "ASROptions.h"
-#include "ASRSegment.h"
+#include "ASRTranscript.h"
+#include "ModelStore.h"
+#include "TokenTimestamps.h"
+#include "WhisperModelCache.h"
 
 class ASREngine
 {
 public:
-    ASREngine (const std::string& modelsDirIn) : modelsDir (modelsDirIn)
+    // Keeps up to the given number of whisper states, each holding the mel
+    // of different audio
+    explicit ASREngine (int numStateSlotsIn = Config::asrStateSlots)
+        : numStateSlots (juce::jmax (1, numStateSlotsIn))
     {
-        // Create models directory if it doesn't already exist
-        juce::File (modelsDir).createDirectory();
     }
 
     ~ASREngine()
     {
         DBG ("ASREngine destructor");
-        if (ctx != nullptr)
-        {
-            DBG ("Freeing whisper context");
-            whisper_free (ctx);
-            ctx = nullptr;
-        }
+        freeModel();
 
         downloadTask.reset();
+
+        for (const auto& fileName : acquiredFiles)
+            modelStore->release (fileName);
     }
 
     // Download the model if needed. Returns true if successful or already downloaded.
     bool downloadModel (const std::string& modelName, std::function<bool ()> isAborted)
     {
-        return downloadFile (getModelPath (modelName), Config::getModelURL (modelName), "model", isAborted);
+        return downloadFile (getModelFileName (modelName), Config::getModelURL (modelName), Config::getModelCatalogURL(), "model", isAborted);
     }
 
     // Download the VAD model if needed. Returns true if successful or already downloaded.
     bool downloadVadModel (std::function<bool ()> isAborted)
     {
-        return downloadFile (getVadModelPath(), Config::getVadModelURL(), "VAD model", isAborted);
+        return downloadFile (getVadModelFileName(), Config::getVadModelURL(), Config::getVadModelCatalogURL(), "VAD model", isAborted);
     }
 
     // Load the model by name. Returns true if successful.
@@ -56,11 +67,12 @@ public:
             return true;
         }
 
-        if (ctx != nullptr)
-        {
-            DBG ("Freeing whisper context");
-            whisper_free (ctx);
-        }
+        freeModel();
+
+        // The previous model may now be evicted
+        if (! lastModelName.empty())
+            releaseFile (getModelFileName (lastModelName));
+        lastModelName.clear();
 
         std::string modelPath = getModelPath (modelName);
         DBG ("Loading model from: " + modelPath);
@@ -79,20 +91,36 @@ public:
         params.flash_attn = false;
 #endif
 
-        ctx = whisper_init_from_file_with_params (modelPath.c_str(), params);
-        if (ctx == nullptr)
+        // Another engine may already have these weights loaded
+        model = modelCache->acquire (modelPath, params);
+        if (model == nullptr)
         {
             DBG ("Failed to load model");
+            releaseFile (getModelFileName (modelName));
+            modelStore->remove (getModelFileName (modelName));
+            DBG ("Deleted model file");
+            return false;
+        }
 
-            if (juce::File (modelPath).deleteFile())
-            {
-                DBG ("Deleted model file");
-            }
+        ctx = model.get();
 
+        // Further states are only allocated when other audio is transcribed
+        stateSlots.reserve ((size_t) numStateSlots);
+
+        if (auto* firstState = whisper_init_state (ctx))
+        {
+            stateSlots.push_back ({ firstState });
+        }
+        else
+        {
+            DBG ("Failed to allocate whisper state");
+            freeModel();
+            releaseFile (getModelFileName (modelName));
             return false;
         }
 
         DBG ("Model loaded successfully");
+        modelStore->markUsed (getModelFileName (modelName));
         lastModelName = modelName;
         return true;
     }
@@ -101,7 +129,7 @@ public:
     bool transcribe (
         const std::vector<float>& audioData,
         ASROptions& options,
-        std::vector<ASRSegment>& segments,
+        ASRTranscript& transcript,
         std::function<bool ()> isAborted)
     {
         DBG ("ASREngine::transcribe");
@@ -111,10 +139,12 @@ public:
             return false;
         }
 
-        TranscribeCallbackData callbackData { this, isAborted };
+        const ComputeBudget::Lease lease (*computeBudget);
+        TranscribeCallbackData callbackData { this, isAborted, &lease };
 
         whisper_full_params params = whisper_full_default_params (WHISPER_SAMPLING_GREEDY);
-        params.token_timestamps = true;
+        params.n_threads = lease.getNumThreads();
+        DBG ("Inference threads: " + juce::String (params.n_threads));
 
         // Storage for strings referenced by params via const char* pointers
         std::string paramsLanguage = options.language.toStdString();
@@ -123,8 +153,20 @@ public:
         params.language = paramsLanguage.c_str();
         params.translate = options.translate;
 
+        if (options.live)
+        {
+            // Each window is decoded independently as a single caption line
+            params.single_segment = true;
+            params.no_context = true;
+            params.print_progress = false;
+
+            // The encoder only attends to the window's own frames instead of
+            // a full 30 seconds, which is most of the cost of a short window
+            params.audio_ctx = getAudioContextSize (audioData.size());
+        }
+
         // VAD configuration
-        if (options.vad)
+        if (options.vad && ! options.live)
         {
             paramsVadModelPath = getVadModelPath();
             if (juce::File (paramsVadModelPath).exists())
@@ -132,6 +174,10 @@ public:
                 params.vad = true;
                 params.vad_model_path = paramsVadModelPath.c_str();
                 params.vad_params = whisper_vad_default_params();
+
+                // Times are mapped back from the filtered audio inside
+                // whisper_full, so it has to compute them itself
+                params.token_timestamps = true;
                 DBG ("VAD enabled with model: " + paramsVadModelPath);
             }
             else
@@ -147,65 +193,235 @@ public:
 
         params.encoder_begin_callback = [] (whisper_context*, whisper_state*, void* user_data)
         {
+            TraceRecorder::getInstance().instant ("whisper::encoderBegin", "whisper");
             auto* data = static_cast<TranscribeCallbackData*> (user_data);
+            data->lease->waitWhileOverloaded (data->isAborted);
             return ! data->isAborted();
         };
         params.encoder_begin_callback_user_data = &callbackData;
 
         params.progress_callback = [] (whisper_context*, whisper_state*, int progressIn, void* user_data)
         {
+            TraceRecorder::getInstance().instant ("whisper::progress", "whisper");
             auto* data = static_cast<TranscribeCallbackData*> (user_data);
             data->engine->progress.store (progressIn);
         };
         params.progress_callback_user_data = &callbackData;
         progress.store (0);
 
-        if (whisper_full (ctx, params, audioData.data(), static_cast<int> (audioData.size())) != 0)
-        {
-            DBG ("Transcription failed");
+        // VAD filters the samples inside whisper_full, so it needs them and
+        // leaves the filtered audio's mel behind. Other runs start from the
+        // mel already in a state, computing it only for new audio.
+        const auto key = getMelKey (audioData);
+        selectState (key);
+
+        if (! params.vad && ! prepareMel (audioData, key, params.n_threads))
             return false;
+
+        {
+            const ScopedTrace trace ("whisper_full", "whisper");
+
+            const auto result = params.vad ? whisper_full_with_state (ctx, state, params, audioData.data(), static_cast<int> (audioData.size()))
+                                           : whisper_full_with_state (ctx, state, params, nullptr, 0);
+
+            if (params.vad || result != 0)
+                currentSlot->mel.reset();
+
+            if (result != 0)
+            {
+                DBG ("Transcription failed");
+                return false;
+            }
         }
 
-        int nSegments = whisper_full_n_segments (ctx);
+        const int nSegments = whisper_full_n_segments_from_state (state);
         DBG ("Number of segments: " + juce::String (nSegments));
 
+        const auto eot = whisper_token_eot (ctx);
+        std::string segmentText;
+        std::string tokenText;
+
+        // Without samples whisper_full has no signal energy to time tokens
+        // with, so it is computed here from the samples still in hand
+        std::optional<TokenTimestamps> tokenTimestamps;
+        if (! options.live && ! params.token_timestamps)
+            tokenTimestamps.emplace (audioData.data(), static_cast<int> (audioData.size()), whisper_token_beg (ctx), eot,
+                                     params.thold_pt, params.thold_ptsum);
+
+        std::vector<TokenTimestamps::Token> tokens;
+
         for (int i = 0; i < nSegments; ++i)
         {
-            ASRSegment segment;
+            segmentText.clear();
+            SafeUTF8::appendTo (segmentText, whisper_full_get_segment_text_from_state (state, i));
+
+            const auto segmentT0 = whisper_full_get_segment_t0_from_state (state, i);
+            const auto segmentT1 = whisper_full_get_segment_t1_from_state (state, i);
 
-            segment.text = SafeUTF8::encode (whisper_full_get_segment_text (ctx, i)).trim();
-            segment.start = ((float) whisper_full_get_segment_t0 (ctx, i)) / 100.0f;
-            segment.end = ((float) whisper_full_get_segment_t1 (ctx, i)) / 100.0f;
+            transcript.addSegment (segmentText, ((float) segmentT0) / 100.0f, ((float) segmentT1) / 100.0f);
+
+            const int nTokens = whisper_full_n_tokens_from_state (state, i);
+            tokens.clear();
 
-            int nTokens = whisper_full_n_tokens (ctx, i);
             for (int j = 0; j < nTokens; ++j)
             {
-                if (whisper_full_get_token_id (ctx, i, j) >= whisper_token_eot (ctx))
+                const auto tokenData = whisper_full_get_token_data_from_state (state, i, j);
+                tokens.push_back ({ tokenData.id, tokenData.tid, tokenData.pt, tokenData.ptsum,
+                                    TokenTimestamps::getVoiceLength (whisper_token_to_str (ctx, tokenData.id)),
+                                    tokenData.t0, tokenData.t1 });
+            }
+
+            if (tokenTimestamps.has_value())
+                tokenTimestamps->computeSegment (tokens, segmentT0, segmentT1);
+
+            bool hasWords = false;
+            for (int j = 0; j < nTokens; ++j)
+            {
+                const auto& token = tokens[(size_t) j];
+                if (token.id >= eot)
                     continue;
 
-                ASRWord word;
+                tokenText.clear();
+                SafeUTF8::appendTo (tokenText, whisper_full_get_token_text_from_state (ctx, state, i, j));
+
+                // Token timestamps computed from the wrong audio fall outside
+                // their segment
+                jassert ((! params.token_timestamps && ! tokenTimestamps.has_value())
+                         || (token.t0 <= token.t1 && token.t0 >= segmentT0 - 1 && token.t1 <= segmentT1 + 1));
 
-                word.text = SafeUTF8::encode (whisper_full_get_token_text (ctx, i, j));
-                word.start = ((float) whisper_full_get_token_data (ctx, i, j).t0) / 100.0f;
-                word.end = ((float) whisper_full_get_token_data (ctx, i, j).t1) / 100.0f;
-                word.probability = whisper_full_get_token_p (ctx, i, j);
+                const auto start = ((float) token.t0) / 100.0f;
+                const auto end = ((float) token.t1) / 100.0f;
 
-                if (! segment.words.isEmpty() && ! word.text.isEmpty() && word.text[0] != ' ')
+                // Tokens that don't start with a space continue the previous word
+                if (hasWords && ! tokenText.empty() && tokenText[0] != ' ')
                 {
-                    auto& lastWord = segment.words.getReference (segment.words.size() - 1);
-                    lastWord.end = word.end;
-                    lastWord.text += word.text.trim();
+                    transcript.extendLastWord (tokenText, end);
                 }
                 else
                 {
-                    word.text = word.text.trim();
-                    segment.words.add (word);
+                    transcript.addWord (tokenText, start, end, whisper_full_get_token_p_from_state (state, i, j));
+                    hasWords = true;
+                }
+            }
+        }
+
+        transcript.shrinkToFit();
+        DBG ("Transcript memory usage: " + juce::String ((juce::int64) transcript.getMemoryUsage()) + " bytes");
+
+        progress.store (100);
+        return true;
+    }
+
+    // Decode the audio once for each of the decodes, into the transcript at
+    // the same index. Each 30 second window is encoded once and decoded for
+    // all of them, so transcribing and translating cost little more than one
+    // pass. Decoding is greedy with fixed windows and doesn't use VAD. Returns
+    // true if successful.
+    bool transcribeDecodes (
+        const std::vector<float>& audioData,
+        const std::vector<ASRDecodeOptions>& decodes,
+        std::vector<ASRTranscript>& transcripts,
+        std::function<bool ()> isAborted)
+    {
+        DBG ("ASREngine::transcribeDecodes: " + juce::String ((int) decodes.size()) + " decodes");
+        if (ctx == nullptr)
+        {
+            DBG ("No model loaded");
+            return false;
+        }
+
+        ComputeBudget::Lease lease (*computeBudget);
+        auto numThreads = lease.getNumThreads();
+        progress.store (0);
+
+        const auto key = getMelKey (audioData);
+        selectState (key);
+
+        if (! prepareMel (audioData, key, numThreads))
+            return false;
+
+        // Language detection encodes the first window, which is then reused
+        int encodedOffset = -1;
+        int detectedLanguageID = -1;
+
+        std::vector<std::vector<whisper_token>> prompts;
+
+        for (const auto& decode : decodes)
+        {
+            int languageID = -1;
+
+            if (! whisper_is_multilingual (ctx))
+            {
+                languageID = 0;
+            }
+            else if (decode.language.isEmpty() || decode.language == "auto")
+            {
+                if (detectedLanguageID < 0)
+                {
+                    const ScopedTrace trace ("whisper_lang_auto_detect", "whisper");
+                    detectedLanguageID = whisper_lang_auto_detect_with_state (ctx, state, 0, numThreads, nullptr);
+                    encodedOffset = 0;
+                }
+
+                languageID = detectedLanguageID;
+            }
+            else
+            {
+                languageID = whisper_lang_id (decode.language.toRawUTF8());
+            }
+
+            if (languageID < 0)
+            {
+                DBG ("Unknown or undetected language: " + decode.language);
+                return false;
+            }
+
+            prompts.push_back (makePrompt (languageID, decode.translate));
+        }
+
+        transcripts.assign (decodes.size(), ASRTranscript());
+
+        const auto numFrames = whisper_n_len_from_state (state);
+
+        for (int offset = 0; offset + minWindowFrames < numFrames; offset += windowFrames)
+        {
+            // Takes this job's current share, which changes as other jobs
+            // start and finish and the transport starts and stops
+            numThreads = lease.refresh();
+
+            if (offset != encodedOffset)
+            {
+                lease.waitWhileOverloaded (isAborted);
+                if (isAborted())
+                    return false;
+
+                const ScopedTrace trace ("whisper_encode", "whisper");
+
+                if (whisper_encode_with_state (ctx, state, offset, numThreads) != 0)
+                {
+                    DBG ("Encoding failed");
+                    return false;
                 }
+
+                encodedOffset = offset;
             }
 
-            segments.push_back (segment);
+            const auto windowEnd = juce::jmin (offset + windowFrames, numFrames);
+
+            for (size_t i = 0; i < decodes.size(); ++i)
+            {
+                const ScopedTrace trace ("whisper_decode", "whisper");
+
+                if (! decodeWindow (prompts[i], offset, windowEnd, numThreads, transcripts[i], isAborted))
+                    return false;
+            }
+
+            progress.store (static_cast<int> ((windowEnd * 100) / numFrames));
         }
 
+        for (auto& transcript : transcripts)
+            transcript.shrinkToFit();
+
         progress.store (100);
         return true;
     }
@@ -213,13 +429,13 @@ public:
     // Get the full path to a model file based on its name
     std::string getModelPath (const std::string& modelName) const
     {
-        return modelsDir + "ggml-" + modelName + ".bin";
+        return modelStore->getFile (getModelFileName (modelName)).getFullPathName().toStdString();
     }
 
     // Get the full path to the VAD model file
     std::string getVadModelPath() const
     {
-        return modelsDir + "ggml-" + Config::vadModelName + ".bin";
+        return modelStore->getFile (getVadModelFileName()).getFullPathName().toStdString();
     }
 
     // Get current progress (0-100) of download or transcription
@@ -229,26 +445,414 @@ public:
     }
 
 private:
+    // Identifies the audio whose log-mel spectrogram is in a state.
+    // Computing the mel is independent of the decoding options, so a
+    // re-run on the same audio with a different language or task can reuse it.
+    struct MelKey
+    {
+        juce::uint64 audioHash = 0;
+        size_t numSamples = 0;
+
+        bool operator== (const MelKey& other) const noexcept
+        {
+            return audioHash == other.audioHash && numSamples == other.numSamples;
+        }
+    };
+
+    static MelKey getMelKey (const std::vector<float>& audioData)
+    {
+        // FNV-1a over the sample bits
+        juce::uint64 hash = 14695981039346656037ull;
+
+        for (const auto sample : audioData)
+        {
+            juce::uint32 bits;
+            std::memcpy (&bits, &sample, sizeof (bits));
+            hash = (hash ^ bits) * 1099511628211ull;
+        }
+
+        return { hash, audioData.size() };
+    }
+
+    // A whisper state and the audio whose mel it holds
+    struct StateSlot
+    {
+        whisper_state* state = nullptr;
+        std::optional<MelKey> mel;
+        juce::uint64 lastUsed = 0;
+    };
+
+    // Frees this engine's states and lets go of the model, which is freed
+    // once no other engine uses it
+    void freeModel()
+    {
+        for (auto& slot : stateSlots)
+            whisper_free_state (slot.state);
+
+        stateSlots.clear();
+        currentSlot = nullptr;
+        state = nullptr;
+        ctx = nullptr;
+        model.reset();
+    }
+
+    // Encoder positions for the given audio. Each is 20 ms, so a 30 second
+    // window has the model's full 1500. A little is added to cover the last
+    // word, since a context cut close to the audio's end degrades decoding.
+    int getAudioContextSize (size_t numSamples) const
+    {
+        constexpr double positionsPerSecond = 50.0;
+        constexpr int marginPositions = 32;
+
+        const auto seconds = (double) numSamples / WHISPER_SAMPLE_RATE;
+        const auto positions = (int) std::ceil (seconds * positionsPerSecond) + marginPositions;
+        return juce::jmin (positions, whisper_model_n_audio_ctx (ctx));
+    }
+
+    // Makes current the state holding the audio's mel. Otherwise that is a
+    // new state while there are fewer than the slots allowed, or else the
+    // least recently used one, whose mel is then replaced.
+    void selectState (const MelKey& key)
+    {
+        jassert (! stateSlots.empty());
+
+        auto* slot = &stateSlots.front();
+
+        for (auto& s : stateSlots)
+        {
+            if (s.mel == key)
+            {
+                slot = &s;
+                break;
+            }
+
+            if (s.lastUsed < slot->lastUsed)
+                slot = &s;
+        }
+
+        if (slot->mel != key && (int) stateSlots.size() < numStateSlots)
+        {
+            if (auto* newState = whisper_init_state (ctx))
+            {
+                stateSlots.push_back ({ newState });
+                slot = &stateSlots.back();
+            }
+            else
+            {
+                DBG ("Failed to allocate another whisper state, reusing one");
+            }
+        }
+
+        slot->lastUsed = ++stateUseCount;
+        currentSlot = slot;
+        state = slot->state;
+    }
+
+    // Computes the mel into the current state, unless it is already there
+    bool prepareMel (const std::vector<float>& audioData, const MelKey& key, int numThreads)
+    {
+        if (currentSlot->mel == key)
+        {
+            DBG ("Reusing log-mel spectrogram");
+            return true;
+        }
+
+        currentSlot->mel.reset();
+
+        const ScopedTrace trace ("whisper_pcm_to_mel", "whisper");
+
+        if (whisper_pcm_to_mel_with_state (ctx, state, audioData.data(), static_cast<int> (audioData.size()), numThreads) != 0)
+        {
+            DBG ("Failed to compute log-mel spectrogram");
+            return false;
+        }
+
+        currentSlot->mel = key;
+        return true;
+    }
+
+    // Mel frames are 10 ms. The encoder sees 30 second windows, and like
+    // whisper_full a trailing window under a second is skipped.
+    static constexpr int windowFrames = 3000;
+    static constexpr int minWindowFrames = 100;
+
+    // Timestamp tokens are 20 ms apart
+    static constexpr int framesPerTimestamp = 2;
+
+    std::vector<whisper_token> makePrompt (int languageID, bool translate) const
+    {
+        std::vector<whisper_token> prompt { whisper_token_sot (ctx) };
+
+        if (whisper_is_multilingual (ctx))
+        {
+            prompt.push_back (whisper_token_lang (ctx, languageID));
+            prompt.push_back (translate ? whisper_token_translate (ctx) : whisper_token_transcribe (ctx));
+        }
+
+        return prompt;
+    }
+
+    // Greedily decodes the encoded window and adds its segments
+    bool decodeWindow (
+        const std::vector<whisper_token>& prompt,
+        int offset,
+        int windowEnd,
+        int numThreads,
+        ASRTranscript& transcript,
+        const std::function<bool ()>& isAborted)
+    {
+        const auto numVocab = static_cast<size_t> (whisper_n_vocab (ctx));
+        const auto maxTokens = prompt.size() + static_cast<size_t> (whisper_n_text_ctx (ctx) / 2);
+
+        decodeTokens.assign (prompt.begin(), prompt.end());
+        sampledProbabilities.clear();
+
+        // Starting from no past tokens discards the previous decode's cache
+        int numPast = 0;
+
+        while (decodeTokens.size() < maxTokens)
+        {
+            if (isAborted())
+                return false;
+
+            const auto numNew = static_cast<int> (decodeTokens.size()) - numPast;
+
+            if (whisper_decode_with_state (ctx, state, decodeTokens.data() + numPast, numNew, numPast, numThreads) != 0)
+            {
+                DBG ("Decoding failed");
+                return false;
+            }
+
+            numPast = static_cast<int> (decodeTokens.size());
+
+            // One row of logits per token passed in; the last one predicts the next token
+            const auto* logits = whisper_get_logits_from_state (state) + static_cast<size_t> (numNew - 1) * numVocab;
+            const auto [token, probability] = selectToken (logits, decodeTokens.data() + prompt.size(),
+                                                           static_cast<int> (decodeTokens.size() - prompt.size()));
+
+            if (token == whisper_token_eot (ctx))
+                break;
+
+            decodeTokens.push_back (token);
+            sampledProbabilities.push_back (probability);
+        }
+
+        addWindowSegments (decodeTokens.data() + prompt.size(), static_cast<int> (sampledProbabilities.size()),
+                           offset, windowEnd, transcript);
+        return true;
+    }
+
+    // Greedy choice following whisper's timestamp rules: a window starts with
+    // a timestamp, timestamps pair up around text and never go back, and the
+    // timestamps win when together they are likelier than any text token.
+    // Returns the token and its probability.
+    std::pair<whisper_token, float> selectToken (const float* logits, const whisper_token* sampled, int numSampled)
+    {
+        const auto numVocab = whisper_n_vocab (ctx);
+        const auto eot = whisper_token_eot (ctx);
+        const auto timestampBegin = whisper_token_beg (ctx);
+        constexpr auto never = -std::numeric_limits<float>::infinity();
+
+        adjustedLogits.assign (logits, logits + numVocab);
+        const auto text = adjustedLogits.begin();
+        const auto timestamps = adjustedLogits.begin() + timestampBegin;
+
+        // Special tokens other than end of text are never output
+        std::fill (text + eot + 1, timestamps, never);
+
+        if (numSampled == 0)
+        {
+            std::fill (text, timestamps, never);
+        }
+        else
+        {
+            const bool lastWasTimestamp = sampled[numSampled - 1] >= timestampBegin;
+            const bool penultimateWasTimestamp = numSampled < 2 || sampled[numSampled - 2] >= timestampBegin;
+
+            if (lastWasTimestamp && penultimateWasTimestamp)
+                std::fill (timestamps, adjustedLogits.end(), never);
+            else if (lastWasTimestamp)
+                std::fill (text, text + eot, never);
+
+            for (int i = numSampled; --i >= 0;)
+            {
+                if (sampled[i] >= timestampBegin)
+                {
+                    // A closing timestamp may repeat the opening one
+                    const auto earliest = lastWasTimestamp && ! penultimateWasTimestamp ? sampled[i] : sampled[i] + 1;
+                    std::fill (timestamps, text + juce::jmin (earliest, numVocab), never);
+                    break;
+                }
+            }
+        }
+
+        const auto logSumExp = [] (auto begin, auto end)
+        {
+            const auto maximum = *std::max_element (begin, end);
+            if (maximum == -std::numeric_limits<float>::infinity())
+                return maximum;
+
+            float sum = 0.0f;
+            for (auto it = begin; it != end; ++it)
+                sum += std::exp (*it - maximum);
+
+            return maximum + std::log (sum);
+        };
+
+        if (logSumExp (timestamps, adjustedLogits.end()) > *std::max_element (text, timestamps))
+            std::fill (text, timestamps, never);
+
+        const auto best = std::max_element (adjustedLogits.begin(), adjustedLogits.end());
+        const auto probability = std::exp (*best - logSumExp (adjustedLogits.begin(), adjustedLogits.end()));
+
+        return { static_cast<whisper_token> (best - adjustedLogits.begin()), probability };
+    }
+
+    // Splits the window's tokens into segments at timestamp tokens. Text
+    // still open at the end of the window runs to the end of the window.
+    void addWindowSegments (const whisper_token* sampled, int numSampled, int offset, int windowEnd, ASRTranscript& transcript)
+    {
+        const auto timestampBegin = whisper_token_beg (ctx);
+        auto segmentStart = offset;
+        int textBegin = -1;
+
+        for (int i = 0; i <= numSampled; ++i)
+        {
+            if (i < numSampled && sampled[i] < timestampBegin)
+            {
+                if (textBegin < 0)
+                    textBegin = i;
+
+                continue;
+            }
+
+            const auto time = i < numSampled
+                ? juce::jmin (offset + framesPerTimestamp * (sampled[i] - timestampBegin), windowEnd)
+                : windowEnd;
+
+            if (textBegin >= 0)
+            {
+                addDecodedSegment (sampled + textBegin, sampledProbabilities.data() + textBegin, i - textBegin,
+                                   segmentStart, juce::jmax (segmentStart, time), transcript);
+                textBegin = -1;
+            }
+
+            segmentStart = time;
+        }
+    }
+
+    // Without token-level timestamps, words share out the segment's time in
+    // proportion to their length
+    void addDecodedSegment (const whisper_token* tokens, const float* probabilities, int numTokens,
+                            int startFrame, int endFrame, ASRTranscript& transcript)
+    {
+        const auto start = (float) startFrame / 100.0f;
+        const auto end = (float) endFrame / 100.0f;
+
+        std::string rawText;
+        for (int i = 0; i < numTokens; ++i)
+            rawText += whisper_token_to_str (ctx, tokens[i]);
+
+        std::string segmentText;
+        SafeUTF8::appendTo (segmentText, rawText.c_str());
+        transcript.addSegment (segmentText, start, end);
+
+        const auto secondsPerByte = rawText.empty() ? 0.0f : (end - start) / (float) rawText.size();
+        auto tokenStart = start;
+        bool hasWords = false;
+        std::string tokenText;
+
+        for (int i = 0; i < numTokens; ++i)
+        {
+            const auto* rawTokenText = whisper_token_to_str (ctx, tokens[i]);
+            const auto tokenEnd = juce::jmin (end, tokenStart + secondsPerByte * (float) std::strlen (rawTokenText));
+
+            tokenText.clear();
+            SafeUTF8::appendTo (tokenText, rawTokenText);
+
+            // Tokens that don't start with a space continue the previous word
+            if (hasWords && ! tokenText.empty() && tokenText[0] != ' ')
+            {
+                transcript.extendLastWord (tokenText, tokenEnd);
+            }
+            else
+            {
+                transcript.addWord (tokenText, tokenStart, tokenEnd, probabilities[i]);
+                hasWords = true;
+            }
+
+            tokenStart = tokenEnd;
+        }
+    }
+
     struct TranscribeCallbackData
     {
         ASREngine* engine;
         std::function<bool()> isAborted;
+        const ComputeBudget::Lease* lease;
     };
 
-    // Helper to download a file with progress tracking and abort support
-    bool downloadFile (const std::string& filePath, juce::URL url, const std::string& description, std::function<bool ()> isAborted)
+    static std::string getModelFileName (const std::string& modelName)
     {
-        if (juce::File (filePath).exists())
+        return "ggml-" + modelName + ".bin";
+    }
+
+    static std::string getVadModelFileName()
+    {
+        return getModelFileName (Config::vadModelName);
+    }
+
+    // Keeps a file from being evicted while this engine may use it
+    void acquireFile (const std::string& fileName)
+    {
+        if (acquiredFiles.insert (fileName).second)
+            modelStore->acquire (fileName);
+    }
+
+    void releaseFile (const std::string& fileName)
+    {
+        if (acquiredFiles.erase (fileName) > 0)
+            modelStore->release (fileName);
+    }
+
+    // Helper to download a file with progress tracking and abort support.
+    // Downloads go to a partial file that is only moved into the model store
+    // once it is complete.
+    bool downloadFile (const std::string& fileName, juce::URL url, const juce::URL& catalogURL, const std::string& description, std::function<bool ()> isAborted)
+    {
+        // Acquired before anything is added to the store, so that adding this
+        // or another file can't evict it before it's loaded
+        acquireFile (fileName);
+
+        if (modelStore->isVerified (fileName))
         {
-            DBG (description + " already downloaded: " + filePath);
+            DBG (description + " already downloaded: " + fileName);
             progress.store (100);
             return true;
         }
 
+        const auto expected = ModelStore::lookUpCatalog (catalogURL, fileName);
+        if (! expected.has_value())
+        {
+            DBG ("No published checksum for " + description + ": " + fileName);
+            releaseFile (fileName);
+            return false;
+        }
+
+        if (modelStore->adoptLegacyFile (fileName, *expected))
+        {
+            DBG (description + " adopted from legacy directory: " + fileName);
+            progress.store (100);
+            return true;
+        }
+
+        // Present but not verified: truncated, corrupt or unknown to the manifest
+        modelStore->remove (fileName);
+
         progress.store (0);
 
         DBG ("Downloading " + description);
-        auto file = juce::File (filePath);
+        const auto file = modelStore->getPartialFile (fileName);
 
         downloadTask = url.downloadToFile (file, juce::URL::DownloadTaskOptions());
 
@@ -259,8 +863,9 @@ private:
                 DBG (description + " download aborted");
                 downloadTask.reset();
                 progress.store (0);
+                releaseFile (fileName);
 
-                if (juce::File (filePath).deleteFile())
+                if (file.deleteFile())
                 {
                     DBG ("Deleted " + description + " file");
                 }
@@ -283,8 +888,9 @@ private:
             DBG ("Failed to download " + description);
             downloadTask.reset();
             progress.store (0);
+            releaseFile (fileName);
 
-            if (juce::File (filePath).deleteFile())
+            if (file.deleteFile())
             {
                 DBG ("Deleted " + description + " file");
             }
@@ -293,13 +899,41 @@ private:
         }
 
         downloadTask.reset();
+
+        if (! modelStore->addFile (fileName, file, *expected))
+        {
+            DBG ("Failed to store " + description);
+            progress.store (0);
+            releaseFile (fileName);
+            return false;
+        }
+
         progress.store (100);
         return true;
     }
 
-    std::string modelsDir;
+    juce::SharedResourcePointer<ModelStore> modelStore;
+    juce::SharedResourcePointer<ComputeBudget> computeBudget;
     std::string lastModelName;
+    std::set<std::string> acquiredFiles;
+    juce::SharedResourcePointer<WhisperModelCache> modelCache;
+
+    // The model's weights may be shared with other engines; the states, which
+    // hold the mel, KV cache and results, are this engine's own. Room for
+    // all the slots is reserved on load, so currentSlot stays valid as they
+    // are added.
+    WhisperModelCache::Model model;
     whisper_context* ctx = nullptr;
+    const int numStateSlots;
+    std::vector<StateSlot> stateSlots;
+    StateSlot* currentSlot = nullptr;
+    whisper_state* state = nullptr;
+    juce::uint64 stateUseCount = 0;
+
+    // Reused between decodes
+    std::vector<whisper_token> decodeTokens;
+    std::vector<float> sampledProbabilities;
+    std::vector<float> adjustedLogits;
     std::unique_ptr<juce::URL::DownloadTask> downloadTask;
     std::atomic<int> progress;
 };
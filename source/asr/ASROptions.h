@@ -1,7 +1,16 @@
 #pragma once
 
+#include <vector>
+
 #include <juce_core/juce_core.h>
 
+// Language and task of one decode of the audio
+struct ASRDecodeOptions
+{
+    juce::String language;
+    bool translate = false;
+};
+
 struct ASROptions
 {
     juce::String modelName;
@@ -9,6 +18,27 @@ struct ASROptions
     bool translate;
     bool vad;
 
+    // Tuned for short streaming windows rather than whole files
+    bool live = false;
+
+    // Further decodes of the same audio, e.g. a translation alongside the
+    // transcription. They share one encoder pass per window.
+    std::vector<ASRDecodeOptions> alternates;
+
+    // Also decode the main transcript on the alternates' encoder passes, so a
+    // bilingual job costs little more than one pass. The trade-off is the
+    // simpler decoder: fixed 30 second windows, no temperature fallback, and
+    // word times estimated from text length.
+    bool shareEncoder = false;
+
+    // The main decode followed by the alternates
+    std::vector<ASRDecodeOptions> getDecodes() const
+    {
+        std::vector<ASRDecodeOptions> decodes { { language, translate } };
+        decodes.insert (decodes.end(), alternates.begin(), alternates.end());
+        return decodes;
+    }
+
     juce::String toJSON() const
     {
         juce::DynamicObject::Ptr obj = new juce::DynamicObject();
@@ -16,6 +46,18 @@ struct ASROptions
         obj->setProperty ("language", language);
         obj->setProperty ("translate", translate);
         obj->setProperty ("vad", vad);
+        obj->setProperty ("shareEncoder", shareEncoder);
+
+        juce::Array<juce::var> alternatesArray;
+        for (const auto& alternate : alternates)
+        {
+            juce::DynamicObject::Ptr alternateObj = new juce::DynamicObject();
+            alternateObj->setProperty ("language", alternate.language);
+            alternateObj->setProperty ("translate", alternate.translate);
+            alternatesArray.add (juce::var (alternateObj.get()));
+        }
+        obj->setProperty ("alternates", alternatesArray);
+
         return juce::JSON::toString (juce::var (obj.get()));
     }
 };
@@ -10,9 +10,10 @@
 #include <whisper.h>
 
 #include "../utils/ResamplingExporter.h"
+#include "../utils/TraceRecorder.h"
 #include "ASREngine.h"
 #include "ASROptions.h"
-#include "ASRSegment.h"
+#include "ASRTranscript.h"
 
 enum class ASRThreadPoolJobStatus
 {
@@ -30,8 +31,12 @@ enum class ASRThreadPoolJobStatus
 struct ASRThreadPoolJobResult
 {
     bool isError;
+    bool isAborted;
     std::string errorMessage;
-    std::vector<ASRSegment> segments;
+    std::shared_ptr<const ASRTranscript> transcript;
+
+    // One per alternate decode in the options, in the same order
+    std::vector<std::shared_ptr<const ASRTranscript>> alternateTranscripts;
 };
 
 class ASRThreadPoolJob final : public juce::ThreadPoolJob
@@ -55,6 +60,7 @@ public:
     ThreadPoolJob::JobStatus runJob() override
     {
         DBG ("ASRThreadPoolJob::runJob");
+        const ScopedTrace jobTrace ("ASRThreadPoolJob::runJob", "asr");
 
         auto isAborted = [this] { return shouldExit(); };
 
@@ -62,7 +68,11 @@ public:
         onStatusCallback (ASRThreadPoolJobStatus::exporting);
 
         std::vector<float> audioData;
-        ResamplingExporter::exportAudio (audioSource, WHISPER_SAMPLE_RATE, 0, audioData, isAborted);
+        {
+            const ScopedTrace trace ("ASRThreadPoolJob::export", "asr");
+            // Whisper takes 16 kHz mono, so every channel is heard
+            ResamplingExporter::exportAudio (audioSource, WHISPER_SAMPLE_RATE, PCMCache::mixedChannels, audioData, isAborted);
+        }
 
         if (aborting())
             return jobHasFinished;
@@ -72,10 +82,10 @@ public:
         DBG ("Downloading model");
         onStatusCallback (ASRThreadPoolJobStatus::downloadingModel);
 
-        if (! asrEngine.downloadModel (options->modelName.toStdString(), isAborted))
+        if (! traced ("ASRThreadPoolJob::downloadModel", [&] { return asrEngine.downloadModel (options->modelName.toStdString(), isAborted); }))
         {
             onStatusCallback (ASRThreadPoolJobStatus::failed);
-            onCompleteCallback ({ true, "Failed to download model", {} });
+            onCompleteCallback ({ true, false, "Failed to download model", {} });
             return jobHasFinished;
         }
 
@@ -87,10 +97,10 @@ public:
         {
             onStatusCallback (ASRThreadPoolJobStatus::downloadingVadModel);
 
-            if (! asrEngine.downloadVadModel (isAborted))
+            if (! traced ("ASRThreadPoolJob::downloadVadModel", [&] { return asrEngine.downloadVadModel (isAborted); }))
             {
                 onStatusCallback (ASRThreadPoolJobStatus::failed);
-                onCompleteCallback ({ true, "Failed to download VAD model", {} });
+                onCompleteCallback ({ true, false, "Failed to download VAD model", {} });
                 return jobHasFinished;
             }
 
@@ -101,10 +111,10 @@ public:
         DBG ("Loading model");
         onStatusCallback (ASRThreadPoolJobStatus::loadingModel);
 
-        if (! asrEngine.loadModel (options->modelName.toStdString()))
+        if (! traced ("ASRThreadPoolJob::loadModel", [&] { return asrEngine.loadModel (options->modelName.toStdString()); }))
         {
             onStatusCallback (ASRThreadPoolJobStatus::failed);
-            onCompleteCallback ({ true, "Failed to load model", {} });
+            onCompleteCallback ({ true, false, "Failed to load model", {} });
             return jobHasFinished;
         }
 
@@ -116,8 +126,9 @@ public:
 
         DBG ("ASR options: " + options->toJSON());
 
-        std::vector<ASRSegment> segments;
-        bool result = asrEngine.transcribe (audioData, *options, segments, isAborted);
+        auto transcript = std::make_shared<ASRTranscript>();
+        std::vector<std::shared_ptr<const ASRTranscript>> alternateTranscripts;
+        bool result = traced ("ASRThreadPoolJob::transcribe", [&] { return transcribe (audioData, *transcript, alternateTranscripts, isAborted); });
 
         if (aborting())
             return jobHasFinished;
@@ -126,13 +137,13 @@ public:
         {
             DBG ("Transcription successful");
             onStatusCallback (ASRThreadPoolJobStatus::finished);
-            onCompleteCallback ({ false, "", segments });
+            onCompleteCallback ({ false, false, "", std::move (transcript), std::move (alternateTranscripts) });
         }
         else
         {
             DBG ("Transcription failed");
             onStatusCallback (ASRThreadPoolJobStatus::failed);
-            onCompleteCallback ({ true, "Transcription failed", {} });
+            onCompleteCallback ({ true, false, "Transcription failed", {} });
         }
 
         return jobHasFinished;
@@ -144,13 +155,73 @@ public:
     }
 
 private:
+    // The main decode runs through whisper_full, unless the options trade its
+    // quality for sharing the encoder. The alternates share one encoder pass
+    // per window, reusing the mel the main decode computed. With VAD, which
+    // filters the audio inside whisper_full, each decode runs in turn.
+    bool transcribe (
+        const std::vector<float>& audioData,
+        ASRTranscript& transcript,
+        std::vector<std::shared_ptr<const ASRTranscript>>& alternateTranscripts,
+        const std::function<bool ()>& isAborted)
+    {
+        if (options->alternates.empty())
+            return asrEngine.transcribe (audioData, *options, transcript, isAborted);
+
+        if (! options->vad)
+        {
+            const auto decodes = options->shareEncoder ? options->getDecodes() : options->alternates;
+            const auto firstAlternate = options->shareEncoder ? (size_t) 1 : (size_t) 0;
+
+            if (! options->shareEncoder && ! asrEngine.transcribe (audioData, *options, transcript, isAborted))
+                return false;
+
+            std::vector<ASRTranscript> transcripts;
+            if (! asrEngine.transcribeDecodes (audioData, decodes, transcripts, isAborted))
+                return false;
+
+            if (options->shareEncoder)
+                transcript = std::move (transcripts[0]);
+
+            for (size_t i = firstAlternate; i < transcripts.size(); ++i)
+                alternateTranscripts.push_back (std::make_shared<const ASRTranscript> (std::move (transcripts[i])));
+
+            return true;
+        }
+
+        if (! asrEngine.transcribe (audioData, *options, transcript, isAborted))
+            return false;
+
+        for (const auto& alternate : options->alternates)
+        {
+            ASROptions alternateOptions = *options;
+            alternateOptions.language = alternate.language;
+            alternateOptions.translate = alternate.translate;
+
+            auto alternateTranscript = std::make_shared<ASRTranscript>();
+            if (! asrEngine.transcribe (audioData, alternateOptions, *alternateTranscript, isAborted))
+                return false;
+
+            alternateTranscripts.push_back (std::move (alternateTranscript));
+        }
+
+        return true;
+    }
+
+    template <typename Fn>
+    static bool traced (const char* name, Fn&& stage)
+    {
+        const ScopedTrace trace (name, "asr");
+        return stage();
+    }
+
     bool aborting() const
     {
         if (shouldExit())
         {
             DBG ("Transcription aborted");
             onStatusCallback (ASRThreadPoolJobStatus::aborted);
-            onCompleteCallback ({ false, "", {} });
+            onCompleteCallback ({ false, true, "", {} });
             return true;
         }
         return false;
@@ -0,0 +1,481 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+// Compact transcript storage.
+//
+// Segments and words are stored as parallel arrays (struct of arrays). All
+// text lives in one UTF-8 arena and is referenced by offset and length, so a
+// transcript costs a handful of allocations regardless of its size. Segments
+// own a contiguous range of words. Conversion to juce::var only happens at the
+// edges, when talking to the UI or reading legacy JSON.
+//
+// Each segment has an ID that is unique within the transcript and stays with
+// the segment through edits and when it is saved. IDs are assigned in
+// increasing order and never reused, so segments can be found by ID with a
+// binary search.
+class ASRTranscript
+{
+public:
+    struct TextRange
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    // Segments
+
+    int getNumSegments() const noexcept { return (int) segmentStart.size(); }
+    bool isEmpty() const noexcept { return segmentStart.empty(); }
+
+    uint32_t getSegmentID (int i) const noexcept { return segmentID[(size_t) i]; }
+    uint32_t getNextSegmentID() const noexcept { return nextSegmentID; }
+    float getSegmentStart (int i) const noexcept { return segmentStart[(size_t) i]; }
+    float getSegmentEnd (int i) const noexcept { return segmentEnd[(size_t) i]; }
+    float getSegmentScore (int i) const noexcept { return segmentScore[(size_t) i]; }
+    std::string_view getSegmentTextView (int i) const noexcept { return getTextView (segmentText[(size_t) i]); }
+    juce::String getSegmentText (int i) const { return toString (getSegmentTextView (i)); }
+
+    // Half-open range of word indices belonging to a segment
+    std::pair<int, int> getSegmentWordRange (int i) const noexcept
+    {
+        const auto begin = segmentWordBegin[(size_t) i];
+        const auto end = (size_t) i + 1 < segmentWordBegin.size() ? segmentWordBegin[(size_t) i + 1] : (uint32_t) wordStart.size();
+        return { (int) begin, (int) end };
+    }
+
+    // Returns the index of the segment with the given ID, or -1
+    int findSegment (uint32_t id) const noexcept
+    {
+        const auto it = std::lower_bound (segmentID.begin(), segmentID.end(), id);
+        return it != segmentID.end() && *it == id ? (int) (it - segmentID.begin()) : -1;
+    }
+
+    // Returns the index of the first segment that ends after the given time,
+    // or the number of segments if there is none. Ends aren't sorted when
+    // segments overlap, but their running maximum is, and first exceeds the
+    // time at the same segment.
+    int findFirstSegmentEndingAfter (float time) const noexcept
+    {
+        return (int) (std::upper_bound (segmentMaxEnd.begin(), segmentMaxEnd.end(), time) - segmentMaxEnd.begin());
+    }
+
+    // Returns the index of the segment's word that is playing at the given
+    // time, or -1 if it falls between words. Words are in start order.
+    int findWordAt (int segment, float time) const noexcept
+    {
+        const auto [begin, end] = getSegmentWordRange (segment);
+        const auto it = std::upper_bound (wordStart.begin() + begin, wordStart.begin() + end, time);
+
+        if (it == wordStart.begin() + begin)
+            return -1;
+
+        const auto index = (int) (it - wordStart.begin()) - 1;
+        return wordEnd[(size_t) index] >= time ? index : -1;
+    }
+
+    // Words
+
+    int getNumWords() const noexcept { return (int) wordStart.size(); }
+
+    float getWordStart (int i) const noexcept { return wordStart[(size_t) i]; }
+    float getWordEnd (int i) const noexcept { return wordEnd[(size_t) i]; }
+    float getWordProbability (int i) const noexcept { return wordProbability[(size_t) i]; }
+    std::string_view getWordTextView (int i) const noexcept { return getTextView (wordText[(size_t) i]); }
+    juce::String getWordText (int i) const { return toString (getWordTextView (i)); }
+
+    // Building
+
+    void reserve (int numSegments, int numWords, size_t textBytes)
+    {
+        segmentID.reserve ((size_t) numSegments);
+        segmentStart.reserve ((size_t) numSegments);
+        segmentEnd.reserve ((size_t) numSegments);
+        segmentMaxEnd.reserve ((size_t) numSegments);
+        segmentScore.reserve ((size_t) numSegments);
+        segmentText.reserve ((size_t) numSegments);
+        segmentWordBegin.reserve ((size_t) numSegments);
+
+        wordStart.reserve ((size_t) numWords);
+        wordEnd.reserve ((size_t) numWords);
+        wordProbability.reserve ((size_t) numWords);
+        wordText.reserve ((size_t) numWords);
+
+        text.reserve (textBytes);
+    }
+
+    // Adds a segment with surrounding whitespace trimmed. Its score is the
+    // mean probability of the words added to it, if any.
+    int addSegment (std::string_view segmentTextIn, float start, float end, float score = 0.0f)
+    {
+        return addSegmentWithID (nextSegmentID, segmentTextIn, start, end, score);
+    }
+
+    // As addSegment, but keeps an existing ID. IDs must be added in increasing order.
+    int addSegmentWithID (uint32_t id, std::string_view segmentTextIn, float start, float end, float score = 0.0f)
+    {
+        jassert (segmentID.empty() || id > segmentID.back());
+
+        segmentID.push_back (id);
+        nextSegmentID = id + 1;
+        segmentStart.push_back (start);
+        segmentEnd.push_back (end);
+        segmentMaxEnd.push_back (segmentMaxEnd.empty() ? end : std::max (segmentMaxEnd.back(), end));
+        segmentScore.push_back (score);
+        segmentText.push_back (appendText (trim (segmentTextIn)));
+        segmentWordBegin.push_back ((uint32_t) wordStart.size());
+        return getNumSegments() - 1;
+    }
+
+    // Adds a word, trimmed, to the last segment
+    void addWord (std::string_view wordTextIn, float start, float end, float probability)
+    {
+        jassert (! isEmpty());
+
+        wordStart.push_back (start);
+        wordEnd.push_back (end);
+        wordProbability.push_back (probability);
+        wordText.push_back (appendText (trim (wordTextIn)));
+
+        // Running mean of the segment's word probabilities
+        const auto numSegmentWords = (float) (wordStart.size() - segmentWordBegin.back());
+        auto& score = segmentScore.back();
+        score = numSegmentWords > 1.0f ? score + (probability - score) / numSegmentWords : probability;
+    }
+
+    // Appends text, trimmed, to the last word and extends its end time
+    void extendLastWord (std::string_view suffix, float end)
+    {
+        jassert (getNumWords() > 0);
+
+        auto& range = wordText.back();
+        jassert (range.offset + range.length == text.size()); // Must be the last text added
+
+        const auto trimmed = trim (suffix);
+        text.append (trimmed);
+        range.length += (uint32_t) trimmed.size();
+        wordEnd.back() = end;
+    }
+
+    void setSegmentScore (int i, float score) noexcept
+    {
+        segmentScore[(size_t) i] = score;
+    }
+
+    void setSegmentTimes (int i, float start, float end) noexcept
+    {
+        segmentStart[(size_t) i] = start;
+        segmentEnd[(size_t) i] = end;
+        updateMaxEnds (i);
+    }
+
+    // Keeps IDs of deleted segments from being reused, e.g. after decoding
+    void setNextSegmentID (uint32_t id) noexcept
+    {
+        jassert (segmentID.empty() || id > segmentID.back());
+        nextSegmentID = id;
+    }
+
+    // Editing in place
+
+    // Replaces a segment's text, trimmed, and drops its words, since they no
+    // longer match it
+    void setSegmentText (int i, std::string_view newText)
+    {
+        const auto [begin, end] = getSegmentWordRange (i);
+        removeWords (i, begin, end);
+
+        deadTextBytes += segmentText[(size_t) i].length;
+        segmentText[(size_t) i] = appendText (trim (newText));
+        compactTextIfSparse();
+    }
+
+    void removeSegment (int i)
+    {
+        const auto [begin, end] = getSegmentWordRange (i);
+        removeWords (i, begin, end);
+
+        const auto index = (std::ptrdiff_t) i;
+        deadTextBytes += segmentText[(size_t) i].length;
+        segmentID.erase (segmentID.begin() + index);
+        segmentStart.erase (segmentStart.begin() + index);
+        segmentEnd.erase (segmentEnd.begin() + index);
+        segmentMaxEnd.erase (segmentMaxEnd.begin() + index);
+        segmentScore.erase (segmentScore.begin() + index);
+        segmentText.erase (segmentText.begin() + index);
+        segmentWordBegin.erase (segmentWordBegin.begin() + index);
+        updateMaxEnds (i);
+        compactTextIfSparse();
+    }
+
+    // Appends a copy of another transcript's segment, with its ID and words
+    int addSegmentFrom (const ASRTranscript& other, int i)
+    {
+        const auto index = addSegmentWithID (other.getSegmentID (i),
+                                             other.getSegmentTextView (i),
+                                             other.getSegmentStart (i),
+                                             other.getSegmentEnd (i));
+
+        const auto [begin, end] = other.getSegmentWordRange (i);
+        for (int w = begin; w < end; ++w)
+            addWord (other.getWordTextView (w), other.getWordStart (w), other.getWordEnd (w), other.getWordProbability (w));
+
+        setSegmentScore (index, other.getSegmentScore (i));
+        return index;
+    }
+
+    void shrinkToFit()
+    {
+        segmentID.shrink_to_fit();
+        segmentStart.shrink_to_fit();
+        segmentEnd.shrink_to_fit();
+        segmentMaxEnd.shrink_to_fit();
+        segmentScore.shrink_to_fit();
+        segmentText.shrink_to_fit();
+        segmentWordBegin.shrink_to_fit();
+        wordStart.shrink_to_fit();
+        wordEnd.shrink_to_fit();
+        wordProbability.shrink_to_fit();
+        wordText.shrink_to_fit();
+        text.shrink_to_fit();
+    }
+
+    // Approximate heap usage in bytes
+    size_t getMemoryUsage() const noexcept
+    {
+        return segmentID.capacity() * sizeof (uint32_t)
+             + segmentStart.capacity() * sizeof (float) * 4
+             + segmentText.capacity() * sizeof (TextRange)
+             + segmentWordBegin.capacity() * sizeof (uint32_t)
+             + wordStart.capacity() * sizeof (float) * 3
+             + wordText.capacity() * sizeof (TextRange)
+             + text.capacity();
+    }
+
+    // Conversion at the edges
+
+    // Returns { segments: [{ id, text, start, end, score, words? }] }
+    juce::var toVar (bool withWords) const
+    {
+        juce::Array<juce::var> segments;
+        segments.ensureStorageAllocated (getNumSegments());
+
+        for (int i = 0; i < getNumSegments(); ++i)
+            segments.add (segmentToVar (i, withWords));
+
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty ("segments", segments);
+        return juce::var (obj.get());
+    }
+
+    juce::var segmentToVar (int i, bool withWords) const
+    {
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty ("id", (juce::int64) getSegmentID (i));
+        obj->setProperty ("text", getSegmentText (i));
+        obj->setProperty ("start", getSegmentStart (i));
+        obj->setProperty ("end", getSegmentEnd (i));
+        obj->setProperty ("score", getSegmentScore (i));
+
+        if (withWords)
+        {
+            const auto [begin, end] = getSegmentWordRange (i);
+            juce::Array<juce::var> words;
+            words.ensureStorageAllocated (end - begin);
+
+            for (int w = begin; w < end; ++w)
+            {
+                juce::DynamicObject::Ptr word = new juce::DynamicObject();
+                word->setProperty ("text", getWordText (w));
+                word->setProperty ("start", getWordStart (w));
+                word->setProperty ("end", getWordEnd (w));
+                word->setProperty ("probability", getWordProbability (w));
+                words.add (juce::var (word.get()));
+            }
+
+            obj->setProperty ("words", words);
+        }
+
+        return juce::var (obj.get());
+    }
+
+    // Reads the form produced by toVar. Returns false if there are no
+    // segments. Segments keep the ids they carry, as long as they increase;
+    // others get new ones, above any the previous transcript used. A segment
+    // sent without words, whose id and text match a segment of the previous
+    // transcript, keeps that segment's words, so the UI can write back
+    // segments it read without them.
+    static bool fromVar (const juce::var& transcriptVar, ASRTranscript& transcript, const ASRTranscript* previous = nullptr)
+    {
+        const auto* segments = transcriptVar["segments"].getArray();
+        if (segments == nullptr)
+            return false;
+
+        // New ids don't reuse those of segments deleted from the previous transcript
+        const auto skipPreviousIDs = [&transcript, previous]
+        {
+            if (previous != nullptr)
+                transcript.setNextSegmentID (std::max (transcript.getNextSegmentID(), previous->getNextSegmentID()));
+        };
+
+        for (const auto& segmentVar : *segments)
+        {
+            const auto segmentTextIn = segmentVar["text"].toString().toStdString();
+            const auto startTime = (float) segmentVar["start"];
+            const auto endTime = (float) segmentVar["end"];
+
+            const auto& idVar = segmentVar["id"];
+            const auto id = (idVar.isInt() || idVar.isInt64() || idVar.isDouble()) ? (juce::int64) idVar : (juce::int64) -1;
+            const auto keepsID = id >= 0 && id <= (juce::int64) std::numeric_limits<uint32_t>::max()
+                                 && (transcript.isEmpty() || (uint32_t) id > transcript.getSegmentID (transcript.getNumSegments() - 1));
+
+            if (! keepsID)
+                skipPreviousIDs();
+
+            // Added with its id, the next id is above it, and so above the largest
+            const auto segmentIndex = keepsID ? transcript.addSegmentWithID ((uint32_t) id, segmentTextIn, startTime, endTime)
+                                              : transcript.addSegment (segmentTextIn, startTime, endTime);
+
+            if (const auto* words = segmentVar["words"].getArray())
+            {
+                for (const auto& wordVar : *words)
+                    transcript.addWord (wordVar["text"].toString().toStdString(),
+                                        (float) wordVar["start"],
+                                        (float) wordVar["end"],
+                                        (float) wordVar["probability"]);
+            }
+            else if (previous != nullptr && segmentVar.hasProperty ("id"))
+            {
+                const auto previousIndex = previous->findSegment ((uint32_t) (juce::int64) segmentVar["id"]);
+                if (previousIndex >= 0 && previous->getSegmentTextView (previousIndex) == transcript.getSegmentTextView (segmentIndex))
+                {
+                    const auto [begin, end] = previous->getSegmentWordRange (previousIndex);
+                    for (int w = begin; w < end; ++w)
+                        transcript.addWord (previous->getWordTextView (w), previous->getWordStart (w), previous->getWordEnd (w), previous->getWordProbability (w));
+                }
+            }
+
+            if (segmentVar.hasProperty ("score"))
+                transcript.setSegmentScore (segmentIndex, (float) segmentVar["score"]);
+        }
+
+        skipPreviousIDs();
+        transcript.shrinkToFit();
+        return true;
+    }
+
+private:
+    static std::string_view trim (std::string_view s) noexcept
+    {
+        const auto isSpace = [] (char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+
+        while (! s.empty() && isSpace (s.front()))
+            s.remove_prefix (1);
+
+        while (! s.empty() && isSpace (s.back()))
+            s.remove_suffix (1);
+
+        return s;
+    }
+
+    static juce::String toString (std::string_view s)
+    {
+        return juce::String::fromUTF8 (s.data(), (int) s.size());
+    }
+
+    TextRange appendText (std::string_view s)
+    {
+        const TextRange range { (uint32_t) text.size(), (uint32_t) s.size() };
+        text.append (s);
+        return range;
+    }
+
+    std::string_view getTextView (TextRange range) const noexcept
+    {
+        return std::string_view (text).substr (range.offset, range.length);
+    }
+
+    // Recomputes the running maximum of ends from a segment on, stopping once
+    // it matches what was there, as everything after then stays the same
+    void updateMaxEnds (int from) noexcept
+    {
+        for (auto i = (size_t) from; i < segmentEnd.size(); ++i)
+        {
+            const auto maxEnd = i > 0 ? std::max (segmentMaxEnd[i - 1], segmentEnd[i]) : segmentEnd[i];
+            if (i > (size_t) from && maxEnd == segmentMaxEnd[i])
+                break;
+
+            segmentMaxEnd[i] = maxEnd;
+        }
+    }
+
+    // Removes the words [begin, end) of segment i
+    void removeWords (int i, int begin, int end)
+    {
+        if (begin == end)
+            return;
+
+        for (auto w = begin; w < end; ++w)
+            deadTextBytes += wordText[(size_t) w].length;
+
+        wordStart.erase (wordStart.begin() + begin, wordStart.begin() + end);
+        wordEnd.erase (wordEnd.begin() + begin, wordEnd.begin() + end);
+        wordProbability.erase (wordProbability.begin() + begin, wordProbability.begin() + end);
+        wordText.erase (wordText.begin() + begin, wordText.begin() + end);
+
+        for (auto j = (size_t) i + 1; j < segmentWordBegin.size(); ++j)
+            segmentWordBegin[j] -= (uint32_t) (end - begin);
+    }
+
+    // Edits leave replaced text behind in the arena. Once that is most of it,
+    // the live text is copied into a fresh arena.
+    void compactTextIfSparse()
+    {
+        if (deadTextBytes * 2 <= text.size())
+            return;
+
+        std::string compacted;
+        compacted.reserve (text.size() - deadTextBytes);
+
+        const auto move = [&] (TextRange& range)
+        {
+            const auto offset = (uint32_t) compacted.size();
+            compacted.append (getTextView (range));
+            range.offset = offset;
+        };
+
+        for (auto& range : segmentText)
+            move (range);
+        for (auto& range : wordText)
+            move (range);
+
+        text = std::move (compacted);
+        deadTextBytes = 0;
+    }
+
+    std::vector<uint32_t> segmentID;
+    std::vector<float> segmentStart;
+    std::vector<float> segmentEnd;
+    std::vector<float> segmentMaxEnd; // Running maximum of segmentEnd
+    std::vector<float> segmentScore;
+    std::vector<TextRange> segmentText;
+    std::vector<uint32_t> segmentWordBegin;
+
+    std::vector<float> wordStart;
+    std::vector<float> wordEnd;
+    std::vector<float> wordProbability;
+    std::vector<TextRange> wordText;
+
+    std::string text;
+    size_t deadTextBytes = 0;
+
+    uint32_t nextSegmentID = 0;
+};
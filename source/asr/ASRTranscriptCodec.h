@@ -0,0 +1,322 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#include "ASRTranscript.h"
+
+// Versioned binary encoding of an ASRTranscript for project persistence.
+//
+// Layout: "RSLT" magic, version byte, flags byte, then the payload, which is
+// gzip-compressed if the compressed flag is set. The payload holds a
+// deduplicated string table followed by segments and words. Times are whole
+// milliseconds, stored as zigzag varint deltas from the previous start plus
+// a duration. Probabilities and scores are quantized to one byte. Segment IDs
+// are stored as gaps from the previous ID, and the next ID to assign after
+// the segment count, so edits addressed by ID survive a reload (version 2;
+// version 1 data is given sequential IDs).
+struct ASRTranscriptCodec
+{
+    static constexpr uint8_t version = 2;
+    static constexpr uint8_t compressedFlag = 1;
+
+    // Payloads smaller than this aren't worth compressing
+    static constexpr size_t compressionThreshold = 1024;
+
+    static void encode (const ASRTranscript& transcript, juce::MemoryBlock& destData, bool allowCompression = true)
+    {
+        juce::MemoryOutputStream payload;
+        writePayload (transcript, payload);
+
+        juce::MemoryOutputStream out (destData, false);
+        out.write (magic, sizeof (magic));
+
+        if (allowCompression && payload.getDataSize() >= compressionThreshold)
+        {
+            juce::MemoryOutputStream compressed;
+            {
+                juce::GZIPCompressorOutputStream gzip (compressed, 6);
+                gzip.write (payload.getData(), payload.getDataSize());
+            }
+
+            if (compressed.getDataSize() < payload.getDataSize())
+            {
+                out.writeByte ((char) version);
+                out.writeByte ((char) compressedFlag);
+                out.write (compressed.getData(), compressed.getDataSize());
+                return;
+            }
+        }
+
+        out.writeByte ((char) version);
+        out.writeByte (0);
+        out.write (payload.getData(), payload.getDataSize());
+    }
+
+    // Returns false if the data is not a transcript this version can read
+    static bool decode (const void* data, size_t size, ASRTranscript& transcript)
+    {
+        constexpr size_t headerSize = sizeof (magic) + 2;
+
+        if (size < headerSize || std::memcmp (data, magic, sizeof (magic)) != 0)
+            return false;
+
+        const auto* bytes = static_cast<const uint8_t*> (data);
+        const auto dataVersion = bytes[sizeof (magic)];
+        const auto flags = bytes[sizeof (magic) + 1];
+
+        if (dataVersion > version)
+        {
+            DBG ("Transcript was saved by a newer version: " + juce::String (dataVersion));
+            return false;
+        }
+
+        juce::MemoryInputStream raw (bytes + headerSize, size - headerSize, false);
+
+        if ((flags & compressedFlag) != 0)
+        {
+            juce::GZIPDecompressorInputStream gzip (raw);
+            juce::MemoryBlock payload;
+            gzip.readIntoMemoryBlock (payload);
+
+            juce::MemoryInputStream in (payload, false);
+            return readPayload (in, dataVersion, transcript);
+        }
+
+        return readPayload (raw, dataVersion, transcript);
+    }
+
+private:
+    static constexpr char magic[4] = { 'R', 'S', 'L', 'T' };
+
+    //==============================================================================
+    static void writeVarint (juce::OutputStream& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.writeByte ((char) ((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.writeByte ((char) value);
+    }
+
+    static void writeSignedVarint (juce::OutputStream& out, int64_t value)
+    {
+        // Zigzag encoding keeps small negative deltas small
+        writeVarint (out, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+    }
+
+    static bool readVarint (juce::InputStream& in, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (in.isExhausted())
+                return false;
+
+            const auto byte = (uint8_t) in.readByte();
+            value |= (uint64_t) (byte & 0x7f) << shift;
+
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static bool readSignedVarint (juce::InputStream& in, int64_t& value)
+    {
+        uint64_t zigzag;
+        if (! readVarint (in, zigzag))
+            return false;
+
+        value = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+        return true;
+    }
+
+    static int64_t toMillis (float seconds) noexcept
+    {
+        return (int64_t) std::llround ((double) seconds * 1000.0);
+    }
+
+    static float fromMillis (int64_t millis) noexcept
+    {
+        return (float) ((double) millis / 1000.0);
+    }
+
+    static uint8_t quantize (float value) noexcept
+    {
+        return (uint8_t) juce::roundToInt (juce::jlimit (0.0f, 1.0f, value) * 255.0f);
+    }
+
+    static float dequantize (uint8_t value) noexcept
+    {
+        return (float) value / 255.0f;
+    }
+
+    //==============================================================================
+    static void writePayload (const ASRTranscript& transcript, juce::OutputStream& out)
+    {
+        // Build the string table; words repeat heavily in speech
+        std::unordered_map<std::string_view, uint32_t> stringIndex;
+        std::vector<std::string_view> strings;
+        std::vector<uint32_t> segmentTextIndex ((size_t) transcript.getNumSegments());
+        std::vector<uint32_t> wordTextIndex ((size_t) transcript.getNumWords());
+
+        const auto intern = [&] (std::string_view s)
+        {
+            const auto [it, inserted] = stringIndex.try_emplace (s, (uint32_t) strings.size());
+            if (inserted)
+                strings.push_back (s);
+            return it->second;
+        };
+
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+            segmentTextIndex[(size_t) i] = intern (transcript.getSegmentTextView (i));
+
+        for (int i = 0; i < transcript.getNumWords(); ++i)
+            wordTextIndex[(size_t) i] = intern (transcript.getWordTextView (i));
+
+        writeVarint (out, strings.size());
+        for (const auto& s : strings)
+        {
+            writeVarint (out, s.size());
+            out.write (s.data(), s.size());
+        }
+
+        writeVarint (out, (uint64_t) transcript.getNumSegments());
+        writeVarint (out, (uint64_t) transcript.getNumWords());
+        writeVarint (out, transcript.getNextSegmentID());
+
+        int64_t previousSegmentID = -1;
+        int64_t previousSegmentStart = 0;
+        int64_t previousWordStart = 0;
+
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+        {
+            const auto start = toMillis (transcript.getSegmentStart (i));
+            const auto [wordBegin, wordEnd] = transcript.getSegmentWordRange (i);
+
+            const auto id = (int64_t) transcript.getSegmentID (i);
+
+            writeVarint (out, (uint64_t) (id - previousSegmentID - 1));
+            writeVarint (out, segmentTextIndex[(size_t) i]);
+            writeSignedVarint (out, start - previousSegmentStart);
+            writeSignedVarint (out, toMillis (transcript.getSegmentEnd (i)) - start);
+            out.writeByte ((char) quantize (transcript.getSegmentScore (i)));
+            writeVarint (out, (uint64_t) (wordEnd - wordBegin));
+            previousSegmentStart = start;
+            previousSegmentID = id;
+
+            for (int w = wordBegin; w < wordEnd; ++w)
+            {
+                const auto wordStart = toMillis (transcript.getWordStart (w));
+
+                writeVarint (out, wordTextIndex[(size_t) w]);
+                writeSignedVarint (out, wordStart - previousWordStart);
+                writeSignedVarint (out, toMillis (transcript.getWordEnd (w)) - wordStart);
+                out.writeByte ((char) quantize (transcript.getWordProbability (w)));
+                previousWordStart = wordStart;
+            }
+        }
+    }
+
+    static bool readPayload (juce::InputStream& in, uint8_t dataVersion, ASRTranscript& transcript)
+    {
+        uint64_t numStrings;
+        if (! readVarint (in, numStrings) || numStrings > (uint64_t) in.getNumBytesRemaining())
+            return false;
+
+        std::string arena;
+        std::vector<std::pair<size_t, size_t>> strings ((size_t) numStrings);
+
+        for (auto& range : strings)
+        {
+            uint64_t length;
+            if (! readVarint (in, length) || length > (uint64_t) in.getNumBytesRemaining())
+                return false;
+
+            range = { arena.size(), (size_t) length };
+            arena.resize (arena.size() + (size_t) length);
+            if (length > 0 && in.read (arena.data() + range.first, (size_t) length) != (int) length)
+                return false;
+        }
+
+        const auto getString = [&] (uint64_t index, std::string_view& s)
+        {
+            if (index >= strings.size())
+                return false;
+            s = std::string_view (arena).substr (strings[(size_t) index].first, strings[(size_t) index].second);
+            return true;
+        };
+
+        uint64_t numSegments, numWords;
+        if (! readVarint (in, numSegments) || ! readVarint (in, numWords)
+            || numSegments > (uint64_t) in.getNumBytesRemaining() || numWords > (uint64_t) in.getNumBytesRemaining())
+            return false;
+
+        const auto hasIDs = dataVersion >= 2;
+
+        uint64_t nextSegmentID = numSegments;
+        if (hasIDs && (! readVarint (in, nextSegmentID) || nextSegmentID > std::numeric_limits<uint32_t>::max()))
+            return false;
+
+        transcript.reserve ((int) numSegments, (int) numWords, arena.size());
+
+        uint64_t segmentID = 0;
+        int64_t segmentStart = 0;
+        int64_t wordStart = 0;
+
+        for (uint64_t i = 0; i < numSegments; ++i)
+        {
+            uint64_t textIndex, segmentNumWords;
+            int64_t startDelta, duration;
+            std::string_view text;
+
+            uint64_t idGap = 0;
+            if (hasIDs && (! readVarint (in, idGap) || idGap >= nextSegmentID))
+                return false;
+
+            segmentID = i == 0 ? idGap : segmentID + idGap + 1;
+            if (segmentID >= nextSegmentID)
+                return false;
+
+            if (! readVarint (in, textIndex) || ! readSignedVarint (in, startDelta) || ! readSignedVarint (in, duration)
+                || in.isExhausted() || ! getString (textIndex, text))
+                return false;
+
+            const auto score = dequantize ((uint8_t) in.readByte());
+
+            if (! readVarint (in, segmentNumWords))
+                return false;
+
+            segmentStart += startDelta;
+            const auto segmentIndex = transcript.addSegmentWithID ((uint32_t) segmentID, text, fromMillis (segmentStart), fromMillis (segmentStart + duration));
+
+            for (uint64_t w = 0; w < segmentNumWords; ++w)
+            {
+                int64_t wordStartDelta, wordDuration;
+
+                if (! readVarint (in, textIndex) || ! readSignedVarint (in, wordStartDelta) || ! readSignedVarint (in, wordDuration)
+                    || in.isExhausted() || ! getString (textIndex, text))
+                    return false;
+
+                wordStart += wordStartDelta;
+                transcript.addWord (text, fromMillis (wordStart), fromMillis (wordStart + wordDuration), dequantize ((uint8_t) in.readByte()));
+            }
+
+            transcript.setSegmentScore (segmentIndex, score);
+        }
+
+        transcript.setNextSegmentID ((uint32_t) nextSegmentID);
+        transcript.shrinkToFit();
+        return true;
+    }
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#include "ASRTranscript.h"
+
+// A batch of segment edits, addressed by segment ID.
+//
+// The UI sends edits as [{ op: "replace", id, text?, start?, end? } or
+// { op: "delete", id }], and the same form is broadcast to other views, so
+// an edit costs bridge traffic proportional to its size rather than to the
+// transcript's. A patch edits the segments it addresses in place; the owner
+// decides whether that is done on its transcript or on a copy.
+struct ASRTranscriptPatch
+{
+    struct Operation
+    {
+        uint32_t id = 0;
+        bool remove = false;
+        std::optional<std::string> text;
+        std::optional<float> start;
+        std::optional<float> end;
+    };
+
+    std::vector<Operation> operations;
+
+    // Returns false, with an error message, if any operation is malformed
+    static bool fromVar (const juce::var& operationsVar, ASRTranscriptPatch& patch, juce::String& error)
+    {
+        const auto* operations = operationsVar.getArray();
+        if (operations == nullptr)
+        {
+            error = "Operations must be an array";
+            return false;
+        }
+
+        patch.operations.reserve ((size_t) operations->size());
+
+        for (const auto& operationVar : *operations)
+        {
+            const auto op = operationVar["op"].toString();
+            const auto& idVar = operationVar["id"];
+
+            if (! (idVar.isInt() || idVar.isInt64() || idVar.isDouble()) || (juce::int64) idVar < 0)
+            {
+                error = "Invalid segment ID";
+                return false;
+            }
+
+            Operation operation;
+            operation.id = (uint32_t) (juce::int64) idVar;
+
+            if (op == "delete")
+            {
+                operation.remove = true;
+            }
+            else if (op == "replace")
+            {
+                if (operationVar.hasProperty ("text"))
+                    operation.text = operationVar["text"].toString().toStdString();
+                if (operationVar.hasProperty ("start"))
+                    operation.start = (float) operationVar["start"];
+                if (operationVar.hasProperty ("end"))
+                    operation.end = (float) operationVar["end"];
+            }
+            else
+            {
+                error = "Unknown operation: " + op;
+                return false;
+            }
+
+            patch.operations.push_back (std::move (operation));
+        }
+
+        return true;
+    }
+
+    juce::var toVar() const
+    {
+        juce::Array<juce::var> operationsVar;
+        operationsVar.ensureStorageAllocated ((int) operations.size());
+
+        for (const auto& operation : operations)
+        {
+            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+            obj->setProperty ("op", operation.remove ? "delete" : "replace");
+            obj->setProperty ("id", (juce::int64) operation.id);
+
+            if (operation.text)
+                obj->setProperty ("text", juce::String::fromUTF8 (operation.text->data(), (int) operation.text->size()));
+            if (operation.start)
+                obj->setProperty ("start", *operation.start);
+            if (operation.end)
+                obj->setProperty ("end", *operation.end);
+
+            operationsVar.add (juce::var (obj.get()));
+        }
+
+        return operationsVar;
+    }
+
+    // Applies the operations to the transcript. Returns false, with an error
+    // message and the transcript unchanged, if an operation refers to a
+    // segment that doesn't exist or would move a start out of order. Later
+    // operations on the same segment win. Words are dropped from segments
+    // whose text changes, since they no longer match it.
+    bool applyTo (ASRTranscript& transcript, juce::String& error) const
+    {
+        std::map<uint32_t, const Operation*> lastOperations;
+
+        for (const auto& operation : operations)
+        {
+            if (transcript.findSegment (operation.id) < 0)
+            {
+                error = "Segment not found: " + juce::String ((juce::int64) operation.id);
+                return false;
+            }
+
+            lastOperations[operation.id] = &operation;
+        }
+
+        // Segments are kept in start order, which lookups rely on
+        for (const auto& [id, operation] : lastOperations)
+        {
+            if (operation->start && ! isInStartOrder (transcript, transcript.findSegment (id), *operation->start, lastOperations))
+            {
+                error = "Segment start out of order: " + juce::String ((juce::int64) id);
+                return false;
+            }
+        }
+
+        for (const auto& [id, operation] : lastOperations)
+        {
+            const auto index = transcript.findSegment (id);
+
+            if (operation->remove)
+            {
+                transcript.removeSegment (index);
+                continue;
+            }
+
+            if (operation->text && *operation->text != transcript.getSegmentTextView (index))
+                transcript.setSegmentText (index, *operation->text);
+
+            if (operation->start || operation->end)
+            {
+                transcript.setSegmentTimes (index,
+                                            operation->start.value_or (transcript.getSegmentStart (index)),
+                                            operation->end.value_or (transcript.getSegmentEnd (index)));
+            }
+        }
+
+        return true;
+    }
+
+    // Applies the operations to the owner's transcript, in place if only the
+    // owner holds it: current and editable are then the same transcript and
+    // nothing else refers to it. Otherwise they are applied to a copy, so a
+    // transcript shared with another thread never changes under it. On
+    // success, current and editable both point to the patched transcript.
+    bool applyToOwned (std::shared_ptr<const ASRTranscript>& current,
+                       std::shared_ptr<ASRTranscript>& editable,
+                       juce::String& error) const
+    {
+        jassert (current != nullptr);
+
+        const auto isShared = current != editable || editable.use_count() > 2;
+        auto patched = isShared ? std::make_shared<ASRTranscript> (*current) : editable;
+
+        if (! applyTo (*patched, error))
+            return false;
+
+        editable = patched;
+        current = std::move (patched);
+        return true;
+    }
+
+private:
+    using OperationMap = std::map<uint32_t, const Operation*>;
+
+    // The segment's start once the operations are applied, or nothing if
+    // they remove it
+    static std::optional<float> getPatchedStart (const ASRTranscript& transcript, int index, const OperationMap& lastOperations)
+    {
+        const auto it = lastOperations.find (transcript.getSegmentID (index));
+        if (it == lastOperations.end())
+            return transcript.getSegmentStart (index);
+
+        if (it->second->remove)
+            return std::nullopt;
+
+        return it->second->start.value_or (transcript.getSegmentStart (index));
+    }
+
+    // Whether a segment can start at the given time without passing the
+    // nearest segments either side that the operations keep. Only removed
+    // segments are skipped, so this costs no more than the patch's size.
+    static bool isInStartOrder (const ASRTranscript& transcript, int index, float start, const OperationMap& lastOperations)
+    {
+        for (int i = index - 1; i >= 0; --i)
+        {
+            if (const auto previousStart = getPatchedStart (transcript, i, lastOperations))
+            {
+                if (*previousStart > start)
+                    return false;
+
+                break;
+            }
+        }
+
+        for (int i = index + 1; i < transcript.getNumSegments(); ++i)
+        {
+            if (const auto nextStart = getPatchedStart (transcript, i, lastOperations))
+                return start <= *nextStart;
+        }
+
+        return true;
+    }
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+#include <whisper.h>
+
+#include "../utils/LiveInputBuffer.h"
+#include "../utils/TraceRecorder.h"
+#include "ASREngine.h"
+#include "ASROptions.h"
+
+// Streams the plugin's input through whisper for live captions.
+//
+// Audio is resampled to 16 kHz into a sliding window. Every step, the window
+// is decoded and reported as a partial hypothesis; once it reaches its full
+// length, the last result is reported as final and the window restarts with
+// a short overlap. The encoder only runs over the window's own length, not a
+// padded 30 seconds. Uses its own engine, and so its own whisper state, so it
+// can run alongside file jobs; a model they have loaded is shared, not
+// loaded again.
+class LiveTranscriber : private juce::Thread
+{
+public:
+    using EventCallback = std::function<void (const juce::var&)>;
+
+    // Tuned for roughly one second of caption latency with the smaller models
+    static constexpr double stepSeconds = 0.5;
+    static constexpr double minWindowSeconds = 1.0;
+    static constexpr double windowSeconds = 5.0;
+    static constexpr double overlapSeconds = 0.2;
+    static constexpr double maxBacklogSeconds = 25.0;
+    static constexpr float silenceThreshold = 0.003f;
+    static constexpr int stopTimeout = 5000;
+
+    LiveTranscriber (LiveInputBuffer& inputIn, EventCallback onEventIn)
+        : juce::Thread ("Live Transcriber"),
+          input (inputIn),
+          onEvent (std::move (onEventIn))
+    {
+    }
+
+    ~LiveTranscriber() override
+    {
+        stop();
+    }
+
+    void start (const ASROptions& optionsIn)
+    {
+        stop();
+        options = optionsIn;
+        options.live = true;
+        startThread();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread (stopTimeout);
+        input.setActive (false);
+    }
+
+    bool isRunning() const
+    {
+        return isThreadRunning();
+    }
+
+private:
+    static constexpr int sampleRate = WHISPER_SAMPLE_RATE;
+    static constexpr int readBlockSize = 8192;
+
+    void run() override
+    {
+        const auto modelName = options.modelName.toStdString();
+        const auto isAborted = [this] { return threadShouldExit(); };
+
+        emitStatus ("Loading Model");
+        if (! engine.downloadModel (modelName, isAborted) || ! engine.loadModel (modelName))
+        {
+            if (! threadShouldExit())
+                emitError ("Failed to load model");
+            return;
+        }
+
+        input.setActive (true);
+        emitStatus ("Listening");
+
+        std::vector<float> readBuffer ((size_t) readBlockSize);
+        std::vector<float> pending;
+        juce::LagrangeInterpolator interpolator;
+
+        window.clear();
+        windowStart = 0.0;
+        size_t samplesAtLastDecode = 0;
+
+        while (! threadShouldExit())
+        {
+            int numRead;
+            while ((numRead = input.read (readBuffer.data(), readBlockSize)) > 0)
+                pending.insert (pending.end(), readBuffer.begin(), readBuffer.begin() + numRead);
+
+            resample (pending, interpolator);
+
+            if (window.size() < secondsToSamples (minWindowSeconds)
+                || window.size() - samplesAtLastDecode < secondsToSamples (stepSeconds))
+            {
+                wait (juce::roundToInt (stepSeconds * 250.0));
+                continue;
+            }
+
+            // Drop audio we can no longer keep up with rather than fall further behind
+            if (window.size() > secondsToSamples (maxBacklogSeconds))
+                advanceWindow (window.size() - secondsToSamples (windowSeconds));
+
+            const auto isFinal = window.size() >= secondsToSamples (windowSeconds);
+
+            const auto decoded = ! isSilent() && decode (isAborted);
+
+            if (isFinal)
+            {
+                if (currentText.isNotEmpty())
+                    emitHypothesis (true);
+
+                currentText.clear();
+                advanceWindow (window.size() - secondsToSamples (overlapSeconds));
+            }
+            else if (decoded && currentText.isNotEmpty())
+            {
+                emitHypothesis (false);
+            }
+
+            samplesAtLastDecode = window.size();
+        }
+    }
+
+    // Converts pending input at the host rate into 16 kHz window samples,
+    // leaving behind whatever the interpolator can't consume yet
+    void resample (std::vector<float>& pending, juce::LagrangeInterpolator& interpolator)
+    {
+        const auto inputRate = input.getSampleRate();
+        if (inputRate <= 0.0 || pending.size() < 2)
+            return;
+
+        const auto ratio = inputRate / sampleRate;
+        const auto numOut = (int) std::floor ((double) (pending.size() - 1) / ratio) - 1;
+        if (numOut <= 0)
+            return;
+
+        const auto offset = window.size();
+        window.resize (offset + (size_t) numOut);
+
+        const auto numUsed = interpolator.process (ratio, pending.data(), window.data() + offset, numOut, (int) pending.size(), 0);
+        pending.erase (pending.begin(), pending.begin() + juce::jmin (numUsed, (int) pending.size()));
+    }
+
+    bool decode (const std::function<bool ()>& isAborted)
+    {
+        const ScopedTrace trace ("LiveTranscriber::decode", "asr");
+
+        ASRTranscript transcript;
+        if (! engine.transcribe (window, options, transcript, isAborted))
+            return false;
+
+        juce::StringArray lines;
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+            lines.add (transcript.getSegmentText (i));
+
+        currentText = lines.joinIntoString (" ").trim();
+        return true;
+    }
+
+    bool isSilent() const
+    {
+        if (window.empty())
+            return true;
+
+        double sumOfSquares = 0.0;
+        for (const auto sample : window)
+            sumOfSquares += (double) sample * sample;
+
+        return std::sqrt (sumOfSquares / (double) window.size()) < silenceThreshold;
+    }
+
+    void advanceWindow (size_t numSamples)
+    {
+        numSamples = juce::jmin (numSamples, window.size());
+        window.erase (window.begin(), window.begin() + (std::ptrdiff_t) numSamples);
+        windowStart += (double) numSamples / sampleRate;
+    }
+
+    static size_t secondsToSamples (double seconds)
+    {
+        return (size_t) (seconds * sampleRate);
+    }
+
+    void emitHypothesis (bool isFinal)
+    {
+        juce::DynamicObject::Ptr event = new juce::DynamicObject();
+        event->setProperty ("type", isFinal ? "final" : "partial");
+        event->setProperty ("text", currentText);
+        event->setProperty ("start", windowStart);
+        event->setProperty ("end", windowStart + (double) window.size() / sampleRate);
+        onEvent (juce::var (event.get()));
+    }
+
+    void emitStatus (const juce::String& status)
+    {
+        juce::DynamicObject::Ptr event = new juce::DynamicObject();
+        event->setProperty ("type", "status");
+        event->setProperty ("status", status);
+        onEvent (juce::var (event.get()));
+    }
+
+    void emitError (const juce::String& message)
+    {
+        juce::DynamicObject::Ptr event = new juce::DynamicObject();
+        event->setProperty ("type", "error");
+        event->setProperty ("error", message);
+        onEvent (juce::var (event.get()));
+    }
+
+    LiveInputBuffer& input;
+    EventCallback onEvent;
+
+    // Every window is new audio, so there is no mel worth keeping
+    ASREngine engine { 1 };
+    ASROptions options;
+
+    std::vector<float> window;
+    double windowStart = 0.0;
+    juce::String currentText;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveTranscriber)
+};
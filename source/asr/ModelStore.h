@@ -0,0 +1,337 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_cryptography/juce_cryptography.h>
+
+#include "../Config.h"
+
+// Persistent store for downloaded model files, shared by all plugin instances.
+//
+// A manifest next to the models records each file's size and SHA-256 hash.
+// Files are only added if their hash matches the digest published in the
+// model catalog; after that a file is trusted as long as its size and
+// modification time match what was last verified. Least recently used models
+// are evicted when the store exceeds its quota, except those in use.
+class ModelStore
+{
+public:
+    ModelStore() : ModelStore (juce::File (Config::getModelsDir()), Config::modelStoreQuotaBytes)
+    {
+    }
+
+    ModelStore (const juce::File& directoryIn, juce::int64 defaultQuotaBytes)
+        : directory (directoryIn),
+          quotaBytes (defaultQuotaBytes)
+    {
+        directory.createDirectory();
+        loadManifest();
+    }
+
+    // Digest and size of a file as published in a model catalog
+    struct CatalogEntry
+    {
+        juce::String sha256;
+        juce::int64 size = -1;
+    };
+
+    // Looks a file up in a model repository's file listing. Returns nothing if
+    // the listing can't be fetched or doesn't publish a digest for the file.
+    static std::optional<CatalogEntry> lookUpCatalog (const juce::URL& catalogURL, const std::string& fileName)
+    {
+        const auto listing = juce::JSON::parse (catalogURL.readEntireTextStream());
+        const auto* files = listing.getArray();
+        if (files == nullptr)
+            return std::nullopt;
+
+        for (const auto& file : *files)
+        {
+            if (file["path"].toString() != juce::String (fileName))
+                continue;
+
+            // Large files are stored in LFS, whose object ID is the SHA-256
+            const auto& lfs = file["lfs"];
+            const auto sha256 = lfs["oid"].toString().toLowerCase();
+            if (sha256.length() != 64)
+                return std::nullopt;
+
+            return CatalogEntry { sha256, lfs.hasProperty ("size") ? (juce::int64) lfs["size"] : (juce::int64) -1 };
+        }
+
+        return std::nullopt;
+    }
+
+    juce::File getFile (const std::string& fileName) const
+    {
+        return directory.getChildFile (fileName);
+    }
+
+    // A unique path to download a file to before it is added, so concurrent
+    // downloads by different instances never write to the same file
+    juce::File getPartialFile (const std::string& fileName) const
+    {
+        return directory.getChildFile (fileName + "." + juce::Uuid().toString().toStdString() + ".part");
+    }
+
+    // Marks a file as in use so it is never evicted, e.g. while a model is
+    // loaded or between downloading and loading it. Uses are counted.
+    void acquire (const std::string& fileName)
+    {
+        const juce::ScopedLock lock (manifestLock);
+        ++useCounts[fileName];
+    }
+
+    void release (const std::string& fileName)
+    {
+        const juce::ScopedLock lock (manifestLock);
+
+        const auto it = useCounts.find (fileName);
+        jassert (it != useCounts.end());
+        if (it != useCounts.end() && --it->second == 0)
+            useCounts.erase (it);
+    }
+
+    // Returns true if the file exists and matches its manifest entry. Only
+    // re-hashes the file if it was modified since it was last verified.
+    bool isVerified (const std::string& fileName)
+    {
+        const auto file = getFile (fileName);
+        Entry entry;
+
+        {
+            const juce::ScopedLock lock (manifestLock);
+
+            const auto it = entries.find (fileName);
+            if (it == entries.end() || ! file.existsAsFile())
+                return false;
+
+            entry = it->second;
+        }
+
+        if (file.getSize() != entry.size)
+        {
+            DBG ("Model store: size mismatch for " + fileName);
+            return false;
+        }
+
+        const auto modified = file.getLastModificationTime().toMilliseconds();
+        if (modified == entry.verifiedModified)
+            return true;
+
+        // Hashing a model takes seconds, so it's done without holding the lock
+        DBG ("Model store: re-verifying modified file " + fileName);
+        if (hashFile (file) != entry.sha256)
+        {
+            DBG ("Model store: hash mismatch for " + fileName);
+            return false;
+        }
+
+        const juce::ScopedLock lock (manifestLock);
+
+        const auto it = entries.find (fileName);
+        if (it == entries.end() || it->second.sha256 != entry.sha256)
+            return false;
+
+        it->second.verifiedModified = modified;
+        saveManifest();
+        return true;
+    }
+
+    // Moves a complete file into the store under fileName if its contents
+    // match the catalog entry, evicting unused models if the quota is
+    // exceeded. A file that doesn't match is deleted.
+    bool addFile (const std::string& fileName, const juce::File& sourceFile, const CatalogEntry& expected)
+    {
+        const auto size = sourceFile.getSize();
+
+        if (! sourceFile.existsAsFile() || (expected.size >= 0 && size != expected.size))
+        {
+            DBG ("Model store: rejecting incomplete file " + fileName);
+            sourceFile.deleteFile();
+            return false;
+        }
+
+        const auto sha256 = hashFile (sourceFile);
+        if (sha256 != expected.sha256)
+        {
+            DBG ("Model store: rejecting " + fileName + ", hash " + sha256 + " doesn't match " + expected.sha256);
+            sourceFile.deleteFile();
+            return false;
+        }
+
+        const juce::ScopedLock lock (manifestLock);
+
+        const auto file = getFile (fileName);
+        if (sourceFile != file && ! sourceFile.moveFileTo (file))
+        {
+            DBG ("Model store: failed to move " + fileName + " into the store");
+            sourceFile.deleteFile();
+            return false;
+        }
+
+        Entry entry;
+        entry.size = size;
+        entry.sha256 = sha256;
+        entry.verifiedModified = file.getLastModificationTime().toMilliseconds();
+        entry.lastUsed = juce::Time::currentTimeMillis();
+
+        entries[fileName] = entry;
+        evictToQuota (fileName);
+        saveManifest();
+        return true;
+    }
+
+    // Moves a file left by an older version in the legacy models directory
+    // into the store if it matches the catalog. Returns true if the file was
+    // adopted. A file that doesn't match stays where it is.
+    bool adoptLegacyFile (const std::string& fileName, const CatalogEntry& expected)
+    {
+        const auto legacyFile = juce::File (Config::getLegacyModelsDir()).getChildFile (fileName);
+
+        if (! legacyFile.existsAsFile() || getFile (fileName).exists())
+            return false;
+
+        if (expected.size >= 0 && legacyFile.getSize() != expected.size)
+            return false;
+
+        const auto partialFile = getPartialFile (fileName);
+        if (! legacyFile.copyFileTo (partialFile))
+            return false;
+
+        DBG ("Model store: adopting legacy file " + legacyFile.getFullPathName());
+        if (! addFile (fileName, partialFile, expected))
+            return false;
+
+        legacyFile.deleteFile();
+        return true;
+    }
+
+    void markUsed (const std::string& fileName)
+    {
+        const juce::ScopedLock lock (manifestLock);
+
+        const auto it = entries.find (fileName);
+        if (it != entries.end())
+        {
+            it->second.lastUsed = juce::Time::currentTimeMillis();
+            saveManifest();
+        }
+    }
+
+    // Forgets a file and deletes it, e.g. after it failed to load. A file
+    // still in use elsewhere is only forgotten, so it gets downloaded again.
+    void remove (const std::string& fileName)
+    {
+        const juce::ScopedLock lock (manifestLock);
+
+        entries.erase (fileName);
+        if (useCounts.count (fileName) == 0)
+            getFile (fileName).deleteFile();
+        saveManifest();
+    }
+
+private:
+    struct Entry
+    {
+        juce::int64 size = 0;
+        juce::String sha256;
+        juce::int64 verifiedModified = 0;
+        juce::int64 lastUsed = 0;
+    };
+
+    static juce::String hashFile (const juce::File& file)
+    {
+        return juce::SHA256 (file).toHexString();
+    }
+
+    juce::File getManifestFile() const
+    {
+        return directory.getChildFile ("manifest.json");
+    }
+
+    void loadManifest()
+    {
+        const auto manifest = juce::JSON::parse (getManifestFile());
+
+        // The quota can be overridden by editing the manifest
+        if (manifest.hasProperty ("quotaBytes"))
+            quotaBytes = (juce::int64) manifest["quotaBytes"];
+
+        if (const auto* files = manifest["files"].getDynamicObject())
+        {
+            for (const auto& property : files->getProperties())
+            {
+                Entry entry;
+                entry.size = (juce::int64) property.value["size"];
+                entry.sha256 = property.value["sha256"].toString();
+                entry.verifiedModified = (juce::int64) property.value["verifiedModified"];
+                entry.lastUsed = (juce::int64) property.value["lastUsed"];
+                entries[property.name.toString().toStdString()] = entry;
+            }
+        }
+    }
+
+    void saveManifest() const
+    {
+        juce::DynamicObject::Ptr files = new juce::DynamicObject();
+        for (const auto& [fileName, entry] : entries)
+        {
+            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+            obj->setProperty ("size", entry.size);
+            obj->setProperty ("sha256", entry.sha256);
+            obj->setProperty ("verifiedModified", entry.verifiedModified);
+            obj->setProperty ("lastUsed", entry.lastUsed);
+            files->setProperty (juce::Identifier (fileName), juce::var (obj.get()));
+        }
+
+        juce::DynamicObject::Ptr manifest = new juce::DynamicObject();
+        manifest->setProperty ("quotaBytes", quotaBytes);
+        manifest->setProperty ("files", juce::var (files.get()));
+
+        // Write via a temporary file so a crash never leaves a truncated manifest
+        juce::TemporaryFile tempFile (getManifestFile());
+        if (tempFile.getFile().replaceWithText (juce::JSON::toString (juce::var (manifest.get()))))
+            tempFile.overwriteTargetFileWithTemporary();
+    }
+
+    void evictToQuota (const std::string& keepFileName)
+    {
+        juce::int64 totalSize = 0;
+        std::vector<std::pair<juce::int64, std::string>> candidates;
+
+        for (const auto& [fileName, entry] : entries)
+        {
+            totalSize += entry.size;
+            if (fileName != keepFileName && useCounts.count (fileName) == 0)
+                candidates.emplace_back (entry.lastUsed, fileName);
+        }
+
+        std::sort (candidates.begin(), candidates.end());
+
+        for (const auto& candidate : candidates)
+        {
+            if (totalSize <= quotaBytes)
+                break;
+
+            const auto& fileName = candidate.second;
+            DBG ("Model store: evicting " + fileName);
+            totalSize -= entries[fileName].size;
+            entries.erase (fileName);
+            getFile (fileName).deleteFile();
+        }
+    }
+
+    const juce::File directory;
+    juce::int64 quotaBytes;
+
+    juce::CriticalSection manifestLock;
+    std::map<std::string, Entry> entries;
+    std::map<std::string, int> useCounts;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModelStore)
+};
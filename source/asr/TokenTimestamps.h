@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <whisper.h>
+
+// Token-level timestamps, computed the way whisper.cpp does with
+// token_timestamps on, but from samples the caller still has.
+//
+// whisper keeps the signal energy this needs in its state and only computes
+// it from samples passed to whisper_full. Computing it here lets a re-run
+// start from the log-mel spectrogram already in the state, with no samples,
+// and still get word timings. The energy is evaluated only around each
+// token, so nothing proportional to the audio's length is allocated.
+// Times are in whisper's 10 ms units.
+class TokenTimestamps
+{
+public:
+    struct Token
+    {
+        whisper_token id = 0;
+        whisper_token tid = 0;  // Most likely timestamp token at this point
+        float pt = 0.0f;        // Probability of that timestamp token
+        float ptsum = 0.0f;     // Sum of all timestamp token probabilities
+        float vlen = 0.0f;      // Voice length of the token's text
+        int64_t t0 = -1;
+        int64_t t1 = -1;
+    };
+
+    TokenTimestamps (const float* samplesIn, int numSamplesIn, whisper_token beginIn, whisper_token eotIn,
+                     float thresholdPtIn, float thresholdPtSumIn)
+        : samples (samplesIn),
+          numSamples (numSamplesIn),
+          begin (beginIn),
+          eot (eotIn),
+          thresholdPt (thresholdPtIn),
+          thresholdPtSum (thresholdPtSumIn)
+    {
+    }
+
+    // Rough length of text when spoken, used to split time between tokens
+    static float getVoiceLength (std::string_view text) noexcept
+    {
+        float length = 0.0f;
+
+        for (const auto c : text)
+        {
+            if (c == ' ')
+                length += 0.01f;
+            else if (c == ',')
+                length += 2.0f;
+            else if (c == '.' || c == '!' || c == '?' || (c >= '0' && c <= '9'))
+                length += 3.0f;
+            else
+                length += 1.0f;
+        }
+
+        return length;
+    }
+
+    // Sets the times of a segment's tokens, including special ones. Segments
+    // must be passed in order, since timestamps carry over between them.
+    void computeSegment (std::vector<Token>& tokens, int64_t segmentT0, int64_t segmentT1)
+    {
+        const auto n = (int) tokens.size();
+
+        if (n == 0 || numSamples == 0)
+            return;
+
+        if (n == 1)
+        {
+            tokens[0].t0 = segmentT0;
+            tokens[0].t1 = segmentT1;
+            return;
+        }
+
+        placeOnTimestampTokens (tokens, segmentT0, segmentT1);
+        splitUnknownIntervals (tokens);
+
+        for (int j = 0; j < n - 1; ++j)
+        {
+            if (tokens[(size_t) j].t1 < 0)
+                tokens[(size_t) j + 1].t0 = tokens[(size_t) j].t1;
+
+            if (j > 0 && tokens[(size_t) j - 1].t1 > tokens[(size_t) j].t0)
+            {
+                tokens[(size_t) j].t0 = tokens[(size_t) j - 1].t1;
+                tokens[(size_t) j].t1 = std::max (tokens[(size_t) j].t0, tokens[(size_t) j].t1);
+            }
+        }
+
+        fitToVoiceActivity (tokens);
+    }
+
+private:
+    static constexpr int energyHalfWindow = 32;
+    static constexpr int activityHalfWindow = WHISPER_SAMPLE_RATE / 8;
+
+    // Pins tokens to the timestamp tokens the decoder was confident about
+    void placeOnTimestampTokens (std::vector<Token>& tokens, int64_t segmentT0, int64_t segmentT1)
+    {
+        const auto n = (int) tokens.size();
+
+        for (int j = 0; j < n; ++j)
+        {
+            auto& token = tokens[(size_t) j];
+
+            if (j == 0)
+            {
+                if (token.id == begin)
+                {
+                    token.t0 = segmentT0;
+                    token.t1 = segmentT0;
+                    tokens[1].t0 = segmentT0;
+
+                    beginTime = segmentT0;
+                    lastTime = segmentT0;
+                    lastTimestampToken = begin;
+                }
+                else
+                {
+                    token.t0 = lastTime;
+                }
+            }
+
+            const auto time = beginTime + 2 * (int64_t) (token.tid - begin);
+
+            if (token.pt > thresholdPt && token.ptsum > thresholdPtSum && token.tid > lastTimestampToken && time <= segmentT1)
+            {
+                if (j > 0)
+                    tokens[(size_t) j - 1].t1 = time;
+
+                token.t0 = time;
+                lastTimestampToken = token.tid;
+            }
+        }
+
+        tokens[(size_t) n - 2].t1 = segmentT1;
+        tokens[(size_t) n - 1].t0 = segmentT1;
+        tokens[(size_t) n - 1].t1 = segmentT1;
+
+        lastTime = segmentT1;
+    }
+
+    // Splits runs of tokens without times in proportion to their voice length
+    static void splitUnknownIntervals (std::vector<Token>& tokens)
+    {
+        const auto n = (int) tokens.size();
+        int p0 = 0;
+        int p1 = 0;
+
+        while (true)
+        {
+            while (p1 < n && tokens[(size_t) p1].t1 < 0)
+                ++p1;
+
+            if (p1 >= n)
+                --p1;
+
+            if (p1 > p0)
+            {
+                double voiceLength = 0.0;
+                for (int j = p0; j <= p1; ++j)
+                    voiceLength += tokens[(size_t) j].vlen;
+
+                const auto duration = (double) (tokens[(size_t) p1].t1 - tokens[(size_t) p0].t0);
+
+                for (int j = p0 + 1; j <= p1; ++j)
+                {
+                    const auto time = (int64_t) ((double) tokens[(size_t) j - 1].t0 + duration * tokens[(size_t) j - 1].vlen / voiceLength);
+                    tokens[(size_t) j - 1].t1 = time;
+                    tokens[(size_t) j].t0 = time;
+                }
+            }
+
+            ++p1;
+            p0 = p1;
+
+            if (p1 >= n)
+                break;
+        }
+    }
+
+    // Moves each token's edges to where the signal energy crosses half its
+    // average around the token
+    void fitToVoiceActivity (std::vector<Token>& tokens) const
+    {
+        const auto n = (int) tokens.size();
+
+        for (int j = 0; j < n; ++j)
+        {
+            auto& token = tokens[(size_t) j];
+            if (token.id >= eot)
+                continue;
+
+            auto s0 = toSample (token.t0);
+            auto s1 = toSample (token.t1);
+
+            const auto from = std::max (s0 - activityHalfWindow, 0);
+            const auto to = std::min (s1 + activityHalfWindow, numSamples);
+            const auto threshold = (float) (0.5 * getEnergySum (from, to) / (to - from));
+
+            {
+                auto k = s0;
+                if (getEnergy (k) > threshold && j > 0)
+                {
+                    while (k > 0 && getEnergy (k) > threshold)
+                        --k;
+
+                    token.t0 = toTime (k);
+                    if (token.t0 < tokens[(size_t) j - 1].t1)
+                        token.t0 = tokens[(size_t) j - 1].t1;
+                    else
+                        s0 = k;
+                }
+                else
+                {
+                    while (getEnergy (k) < threshold && k < s1)
+                        ++k;
+
+                    s0 = k;
+                    token.t0 = toTime (k);
+                }
+            }
+
+            {
+                auto k = s1;
+                if (getEnergy (k) > threshold)
+                {
+                    while (k < numSamples - 1 && getEnergy (k) > threshold)
+                        ++k;
+
+                    token.t1 = toTime (k);
+
+                    // As in whisper.cpp, which compares against the window size here
+                    if (j < to - from - 1 && j + 1 < n && token.t1 > tokens[(size_t) j + 1].t0)
+                        token.t1 = tokens[(size_t) j + 1].t0;
+                }
+                else
+                {
+                    while (getEnergy (k) < threshold && k > s0)
+                        --k;
+
+                    token.t1 = toTime (k);
+                }
+            }
+        }
+    }
+
+    // Mean absolute amplitude of the samples around a sample
+    float getEnergy (int sample) const noexcept
+    {
+        const auto first = std::max (sample - energyHalfWindow, 0);
+        const auto last = std::min (sample + energyHalfWindow, numSamples - 1);
+
+        float sum = 0.0f;
+        for (int i = first; i <= last; ++i)
+            sum += std::abs (samples[i]);
+
+        return sum / (2 * energyHalfWindow + 1);
+    }
+
+    // Sum of getEnergy over [from, to), with a sliding window
+    double getEnergySum (int from, int to) const noexcept
+    {
+        double window = 0.0;
+        for (int i = std::max (from - energyHalfWindow, 0); i <= std::min (from + energyHalfWindow, numSamples - 1); ++i)
+            window += std::abs (samples[i]);
+
+        double sum = 0.0;
+        for (int k = from; k < to; ++k)
+        {
+            sum += window;
+
+            if (k + energyHalfWindow + 1 < numSamples)
+                window += std::abs (samples[k + energyHalfWindow + 1]);
+            if (k - energyHalfWindow >= 0)
+                window -= std::abs (samples[k - energyHalfWindow]);
+        }
+
+        return sum / (2 * energyHalfWindow + 1);
+    }
+
+    int toSample (int64_t time) const noexcept
+    {
+        return std::max (0, std::min (numSamples - 1, (int) ((time * WHISPER_SAMPLE_RATE) / 100)));
+    }
+
+    static int64_t toTime (int sample) noexcept
+    {
+        return (100ll * sample) / WHISPER_SAMPLE_RATE;
+    }
+
+    const float* samples;
+    const int numSamples;
+    const whisper_token begin;
+    const whisper_token eot;
+    const float thresholdPt;
+    const float thresholdPtSum;
+
+    // Carried over between the segments of one run
+    int64_t beginTime = 0;
+    int64_t lastTime = 0;
+    whisper_token lastTimestampToken = 0;
+};
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#include "ASRTranscript.h"
+
+// Writes transcripts to a stream as subtitles, tables or JSON.
+//
+// Segments are formatted one at a time straight from the stored transcripts,
+// so exporting never builds the whole file in memory. Several sources can be
+// written to one stream, and the table formats have a Source column.
+// Subtitle cues get one entry per playback region that plays their segment,
+// and are written in timeline order across all sources by writeFooter; until
+// then only their times and segment indices are kept.
+class TranscriptExporter
+{
+public:
+    enum class Format
+    {
+        srt,
+        vtt,
+        csv,
+        json,
+        words // One CSV row per word
+    };
+
+    static std::optional<Format> formatFromString (const juce::String& name)
+    {
+        if (name == "srt") return Format::srt;
+        if (name == "vtt") return Format::vtt;
+        if (name == "csv") return Format::csv;
+        if (name == "json") return Format::json;
+        if (name == "words") return Format::words;
+        return std::nullopt;
+    }
+
+    static juce::String getFileExtension (Format format)
+    {
+        switch (format)
+        {
+            case Format::srt: return ".srt";
+            case Format::vtt: return ".vtt";
+            case Format::json: return ".json";
+            case Format::csv:
+            case Format::words: return ".csv";
+        }
+        return {};
+    }
+
+    // A range of source time played on the timeline, e.g. by a playback region
+    struct Placement
+    {
+        double sourceStart = 0.0;
+        double sourceEnd = 0.0;
+        double playbackStart = 0.0;
+
+        // Half-open, so a segment starting where a region ends belongs to the next one
+        bool contains (double sourceTime) const noexcept { return sourceTime >= sourceStart && sourceTime < sourceEnd; }
+        double toPlaybackTime (double sourceTime) const noexcept { return playbackStart + sourceTime - sourceStart; }
+    };
+
+    struct Source
+    {
+        juce::String persistentID;
+        juce::String name;
+        std::shared_ptr<const ASRTranscript> transcript;
+
+        // Where the source is played. Without placements, source times are
+        // used. A segment whose start no placement contains has no playback
+        // time; table rows use the earliest placement that contains it.
+        std::optional<std::vector<Placement>> placements;
+    };
+
+    TranscriptExporter (juce::OutputStream& outIn, Format formatIn) : out (outIn), format (formatIn) {}
+
+    void writeHeader()
+    {
+        switch (format)
+        {
+            case Format::vtt: out << "WEBVTT\n\n"; break;
+            case Format::csv: out << "\"Start\",\"End\",\"Text\",\"Score\",\"Source\"\n"; break;
+            case Format::words: out << "\"Start\",\"End\",\"Word\",\"Probability\",\"Segment\",\"Source\"\n"; break;
+            case Format::json: out << "{\"sources\":["; break;
+            case Format::srt: break;
+        }
+    }
+
+    void writeSource (const Source& source)
+    {
+        if (source.transcript == nullptr)
+            return;
+
+        if (format == Format::json)
+        {
+            writeJSONSource (source);
+            return;
+        }
+
+        if (format == Format::srt || format == Format::vtt)
+        {
+            addCues (source);
+            return;
+        }
+
+        const auto& transcript = *source.transcript;
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+        {
+            const auto start = mapTime (source, transcript.getSegmentStart (i));
+            const auto end = start ? std::optional<double> (*start + transcript.getSegmentEnd (i) - transcript.getSegmentStart (i)) : std::nullopt;
+
+            switch (format)
+            {
+                case Format::csv:
+                    out << quote (formatTimestamp (start)) << ","
+                        << quote (formatTimestamp (end)) << ","
+                        << quote (transcript.getSegmentText (i)) << ","
+                        << quote (juce::String (transcript.getSegmentScore (i), 2)) << ","
+                        << quote (source.name) << "\n";
+                    break;
+
+                case Format::words:
+                    writeWordRows (source, i, start ? *start - transcript.getSegmentStart (i) : std::optional<double>());
+                    break;
+
+                case Format::srt:
+                case Format::vtt:
+                case Format::json:
+                    break;
+            }
+
+            ++numSegments;
+        }
+    }
+
+    void writeFooter()
+    {
+        if (format == Format::srt || format == Format::vtt)
+            writeCues();
+
+        if (format == Format::json)
+            out << "]}\n";
+
+        out.flush();
+    }
+
+    int getNumSegments() const noexcept { return numSegments; }
+
+    // H:MM:SS.mmm or M:SS.mmm, as shown in the transcript grid
+    static juce::String formatTimestamp (std::optional<double> seconds)
+    {
+        if (! seconds)
+            return {};
+
+        const auto [negative, hours, minutes, wholeSeconds, milliseconds] = splitTime (*seconds);
+        const juce::String sign (negative ? "-" : "");
+
+        if (hours > 0)
+            return sign + juce::String::formatted ("%d:%02d:%02d.%03d", hours, minutes, wholeSeconds, milliseconds);
+
+        return sign + juce::String::formatted ("%d:%02d.%03d", minutes, wholeSeconds, milliseconds);
+    }
+
+    // HH:MM:SS,mmm for SRT, or HH:MM:SS.mmm for WebVTT
+    static juce::String formatCueTimestamp (double seconds, char separator)
+    {
+        const auto [negative, hours, minutes, wholeSeconds, milliseconds] = splitTime (seconds);
+        return juce::String (negative ? "-" : "")
+            + juce::String::formatted ("%02d:%02d:%02d", hours, minutes, wholeSeconds)
+            + juce::String::charToString ((juce::juce_wchar) separator)
+            + juce::String::formatted ("%03d", milliseconds);
+    }
+
+private:
+    struct TimeParts
+    {
+        bool negative;
+        int hours;
+        int minutes;
+        int seconds;
+        int milliseconds;
+    };
+
+    // Milliseconds are rounded down, as in the UI's timestamps
+    static TimeParts splitTime (double seconds)
+    {
+        const auto negative = seconds < 0.0;
+        const auto totalMilliseconds = (juce::int64) std::floor (std::abs (seconds) * 1000.0);
+        const auto totalSeconds = totalMilliseconds / 1000;
+
+        return { negative,
+                 (int) (totalSeconds / 3600),
+                 (int) (totalSeconds / 60 % 60),
+                 (int) (totalSeconds % 60),
+                 (int) (totalMilliseconds % 1000) };
+    }
+
+    static juce::String quote (const juce::String& value)
+    {
+        return "\"" + value.replace ("\"", "\"\"") + "\"";
+    }
+
+    struct Cue
+    {
+        double start = 0.0;
+        size_t source = 0; // Index into cueSources
+        int segment = 0;
+    };
+
+    std::optional<double> mapTime (const Source& source, double sourceTime) const
+    {
+        if (! source.placements)
+            return sourceTime;
+
+        std::optional<double> time;
+        for (const auto& placement : *source.placements)
+            if (placement.contains (sourceTime) && (! time || placement.toPlaybackTime (sourceTime) < *time))
+                time = placement.toPlaybackTime (sourceTime);
+
+        return time;
+    }
+
+    // Adds a cue for each time a segment is played; segments that are never
+    // played have no time on the timeline and get no cue
+    void addCues (const Source& source)
+    {
+        const auto sourceIndex = cueSources.size();
+        cueSources.push_back (source);
+
+        const auto& transcript = *source.transcript;
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+        {
+            const auto start = (double) transcript.getSegmentStart (i);
+
+            if (! source.placements)
+            {
+                cues.push_back ({ start, sourceIndex, i });
+            }
+            else
+            {
+                for (const auto& placement : *source.placements)
+                    if (placement.contains (start))
+                        cues.push_back ({ placement.toPlaybackTime (start), sourceIndex, i });
+            }
+
+            ++numSegments;
+        }
+    }
+
+    // Writes the collected cues in timeline order. Cues starting at the same
+    // time keep the order of their sources and segments.
+    void writeCues()
+    {
+        std::stable_sort (cues.begin(), cues.end(), [] (const Cue& a, const Cue& b) { return a.start < b.start; });
+
+        const Source* previousSource = nullptr;
+
+        for (const auto& cue : cues)
+        {
+            const auto& source = cueSources[cue.source];
+            const auto& transcript = *source.transcript;
+
+            // Notes name the source wherever the cues move on to another one
+            if (format == Format::vtt && &source != previousSource)
+                out << "NOTE " << source.name.replace ("-->", "->") << "\n\n";
+
+            previousSource = &source;
+
+            const auto duration = (double) transcript.getSegmentEnd (cue.segment) - transcript.getSegmentStart (cue.segment);
+            writeCue (cue.start, cue.start + duration, transcript.getSegmentText (cue.segment));
+        }
+
+        cues.clear();
+        cueSources.clear();
+    }
+
+    void writeCue (double start, double end, const juce::String& text)
+    {
+        ++numCues;
+
+        if (format == Format::srt)
+        {
+            // Cues are separated by blank lines
+            if (numCues > 1)
+                out << "\n";
+
+            out << juce::String (numCues) << "\n"
+                << formatCueTimestamp (start, ',') << " --> " << formatCueTimestamp (end, ',') << "\n"
+                << text << "\n";
+        }
+        else
+        {
+            // "-->" would end the cue's timing line early
+            out << formatCueTimestamp (start, '.') << " --> " << formatCueTimestamp (end, '.') << "\n"
+                << text.replace ("-->", "->") << "\n\n";
+        }
+    }
+
+    void writeWordRows (const Source& source, int segment, std::optional<double> offset)
+    {
+        const auto& transcript = *source.transcript;
+        const auto [begin, end] = transcript.getSegmentWordRange (segment);
+        const auto segmentID = juce::String ((juce::int64) transcript.getSegmentID (segment));
+
+        for (int w = begin; w < end; ++w)
+        {
+            const auto wordStart = offset ? std::optional<double> (*offset + transcript.getWordStart (w)) : std::nullopt;
+            const auto wordEnd = offset ? std::optional<double> (*offset + transcript.getWordEnd (w)) : std::nullopt;
+
+            out << quote (formatTimestamp (wordStart)) << ","
+                << quote (formatTimestamp (wordEnd)) << ","
+                << quote (transcript.getWordText (w)) << ","
+                << quote (juce::String (transcript.getWordProbability (w), 2)) << ","
+                << quote (segmentID) << ","
+                << quote (source.name) << "\n";
+        }
+    }
+
+    void writeJSONSource (const Source& source)
+    {
+        if (numSources++ > 0)
+            out << ",";
+
+        out << "{\"persistentID\":" << juce::JSON::toString (source.persistentID, true)
+            << ",\"name\":" << juce::JSON::toString (source.name, true)
+            << ",\"segments\":[";
+
+        const auto& transcript = *source.transcript;
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+        {
+            auto segment = transcript.segmentToVar (i, true);
+
+            if (const auto start = mapTime (source, transcript.getSegmentStart (i)))
+            {
+                auto* obj = segment.getDynamicObject();
+                obj->setProperty ("playbackStart", *start);
+                obj->setProperty ("playbackEnd", *start + transcript.getSegmentEnd (i) - transcript.getSegmentStart (i));
+            }
+
+            if (i > 0)
+                out << ",";
+
+            juce::JSON::writeToStream (out, segment, true);
+            ++numSegments;
+        }
+
+        out << "]}";
+    }
+
+    juce::OutputStream& out;
+    const Format format;
+
+    int numSources = 0;
+    int numSegments = 0;
+    int numCues = 0;
+
+    std::vector<Source> cueSources;
+    std::vector<Cue> cues;
+};
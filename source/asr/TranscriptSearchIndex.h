@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+#include "ASRTranscript.h"
+#include "ASRTranscriptCodec.h"
+
+// Inverted index over the segment text of many transcripts.
+//
+// Terms are lowercased runs of letters and digits, kept in one sorted
+// dictionary shared by all sources so prefix and fuzzy expansion happens
+// once per query. Each source has its own postings, mapping term IDs to
+// (segment, position) occurrences, and is reindexed only when its
+// transcript version changes. Transcripts still stored in binary form are
+// indexed from a temporary decode, so searching doesn't make every source
+// keep its decoded transcript. The index never holds on to a transcript, so
+// its owner can keep editing it in place; matches are resolved against the
+// owner's transcript at the indexed version. Terms no source uses any more are dropped
+// from the dictionary. A query matches segments that contain its terms as a
+// phrase. All methods must be called from the same thread.
+class TranscriptSearchIndex
+{
+public:
+    struct Options
+    {
+        bool prefix = true;  // Last query term matches any term it starts
+        bool fuzzy = false;  // Query terms match terms within a small edit distance
+        int limit = 100;
+    };
+
+    struct Match
+    {
+        juce::String sourceID;
+        int segment = 0;
+    };
+
+    // Limits on term expansion, so that short prefixes stay fast
+    static constexpr int maxExpansionsPerTerm = 256;
+
+    bool needsUpdate (const juce::String& sourceID, juce::int64 version) const
+    {
+        const auto it = sources.find (sourceID);
+        return it == sources.end() || it->second.version != version;
+    }
+
+    // Indexes the source's transcript at the given version, or no postings
+    // if it has none
+    void update (const juce::String& sourceID, juce::int64 version, const ASRTranscript* transcript)
+    {
+        auto& source = sources[sourceID];
+        releaseTerms (source);
+        source.version = version;
+
+        if (transcript != nullptr)
+            addPostings (source, *transcript);
+    }
+
+    // As update, for a transcript in ASRTranscriptCodec form. Data that can't
+    // be decoded leaves the source without postings.
+    void update (const juce::String& sourceID, juce::int64 version, const juce::MemoryBlock& encodedTranscript)
+    {
+        auto& source = sources[sourceID];
+        releaseTerms (source);
+        source.version = version;
+
+        ASRTranscript transcript;
+        if (ASRTranscriptCodec::decode (encodedTranscript.getData(), encodedTranscript.getSize(), transcript))
+            addPostings (source, transcript);
+    }
+
+    // Drops sources that are not in the given set
+    void retainOnly (const juce::StringArray& sourceIDs)
+    {
+        for (auto it = sources.begin(); it != sources.end();)
+        {
+            if (sourceIDs.contains (it->first))
+            {
+                ++it;
+            }
+            else
+            {
+                releaseTerms (it->second);
+                it = sources.erase (it);
+            }
+        }
+    }
+
+    size_t getNumTerms() const noexcept { return termIDs.size(); }
+
+    // Returns matching segments in source ID and segment order. Sets
+    // truncated if the results may be incomplete: the limit was reached, or
+    // a query term matched more than maxExpansionsPerTerm dictionary terms.
+    std::vector<Match> search (const juce::String& query, const Options& options, bool& truncated) const
+    {
+        std::vector<Match> matches;
+        truncated = false;
+
+        const auto queryTerms = tokenize (query);
+        if (queryTerms.empty())
+            return matches;
+
+        std::vector<std::vector<uint32_t>> expansions;
+        for (size_t k = 0; k < queryTerms.size(); ++k)
+        {
+            expansions.push_back (expand (queryTerms[k], options.prefix && k + 1 == queryTerms.size(), options.fuzzy, truncated));
+            if (expansions.back().empty())
+                return matches;
+        }
+
+        for (const auto& [sourceID, source] : sources)
+        {
+            for (const auto segment : searchSource (source, expansions))
+            {
+                if ((int) matches.size() >= options.limit)
+                {
+                    truncated = true;
+                    return matches;
+                }
+
+                matches.push_back ({ sourceID, segment });
+            }
+        }
+
+        return matches;
+    }
+
+    static std::vector<std::u32string> tokenize (const juce::String& text)
+    {
+        std::vector<std::u32string> terms;
+        std::u32string term;
+
+        const auto lowerText = text.toLowerCase();
+        for (auto p = lowerText.getCharPointer(); ! p.isEmpty();)
+        {
+            const auto c = p.getAndAdvance();
+
+            if (juce::CharacterFunctions::isLetterOrDigit (c))
+            {
+                term.push_back ((char32_t) c);
+            }
+            else if (c == '\'' || c == 0x2019)
+            {
+                // Apostrophes are dropped rather than splitting words: "don't" -> "dont"
+            }
+            else if (! term.empty())
+            {
+                terms.push_back (std::move (term));
+                term.clear();
+            }
+        }
+
+        if (! term.empty())
+            terms.push_back (std::move (term));
+
+        return terms;
+    }
+
+private:
+    struct SourceIndex
+    {
+        juce::int64 version = -1;
+        std::unordered_map<uint32_t, std::vector<uint64_t>> postings;
+    };
+
+    static uint64_t makeOccurrence (int segment, int position) noexcept
+    {
+        return ((uint64_t) (uint32_t) segment << 32) | (uint32_t) position;
+    }
+
+    static int getSegment (uint64_t occurrence) noexcept { return (int) (occurrence >> 32); }
+
+    void addPostings (SourceIndex& source, const ASRTranscript& transcript)
+    {
+        for (int i = 0; i < transcript.getNumSegments(); ++i)
+        {
+            const auto terms = tokenize (transcript.getSegmentText (i));
+
+            for (size_t position = 0; position < terms.size(); ++position)
+            {
+                auto& occurrences = source.postings[getOrAddTermID (terms[position])];
+                occurrences.push_back (makeOccurrence (i, (int) position));
+            }
+        }
+
+        // Each source holds one reference to each term it uses
+        for (const auto& posting : source.postings)
+            ++termRefCounts[posting.first];
+    }
+
+    // Clears a source's postings, dropping terms no other source uses
+    void releaseTerms (SourceIndex& source)
+    {
+        for (const auto& posting : source.postings)
+        {
+            const auto id = posting.first;
+            if (--termRefCounts[id] == 0)
+            {
+                termIDs.erase (termsByID[id]);
+                freeTermIDs.push_back (id);
+            }
+        }
+
+        source.postings.clear();
+    }
+
+    uint32_t getOrAddTermID (const std::u32string& term)
+    {
+        if (const auto it = termIDs.find (term); it != termIDs.end())
+            return it->second;
+
+        uint32_t id;
+        if (! freeTermIDs.empty())
+        {
+            id = freeTermIDs.back();
+            freeTermIDs.pop_back();
+        }
+        else
+        {
+            id = (uint32_t) termsByID.size();
+            termsByID.emplace_back();
+            termRefCounts.push_back (0);
+        }
+
+        termsByID[id] = termIDs.emplace (term, id).first;
+        return id;
+    }
+
+    // Maximum edit distance allowed for fuzzy matches of a term
+    static int getMaxEdits (size_t length) noexcept
+    {
+        return length >= 8 ? 2 : (length >= 4 ? 1 : 0);
+    }
+
+    // Levenshtein distance, or maxEdits + 1 once it's known to exceed maxEdits
+    static int getEditDistance (const std::u32string& a, const std::u32string& b, int maxEdits)
+    {
+        if (std::abs ((int) a.size() - (int) b.size()) > maxEdits)
+            return maxEdits + 1;
+
+        std::vector<int> previous (b.size() + 1), current (b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j)
+            previous[j] = (int) j;
+
+        for (size_t i = 1; i <= a.size(); ++i)
+        {
+            current[0] = (int) i;
+            auto rowMin = current[0];
+
+            for (size_t j = 1; j <= b.size(); ++j)
+            {
+                const auto cost = a[i - 1] == b[j - 1] ? 0 : 1;
+                current[j] = std::min ({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+                rowMin = std::min (rowMin, current[j]);
+            }
+
+            if (rowMin > maxEdits)
+                return maxEdits + 1;
+
+            std::swap (previous, current);
+        }
+
+        return previous[b.size()];
+    }
+
+    // Returns the IDs of dictionary terms that a query term matches. Sets
+    // truncated if there were more than maxExpansionsPerTerm.
+    std::vector<uint32_t> expand (const std::u32string& queryTerm, bool prefix, bool fuzzy, bool& truncated) const
+    {
+        std::vector<uint32_t> ids;
+
+        if (prefix)
+        {
+            for (auto it = termIDs.lower_bound (queryTerm);
+                 it != termIDs.end() && it->first.compare (0, queryTerm.size(), queryTerm) == 0;
+                 ++it)
+            {
+                if ((int) ids.size() >= maxExpansionsPerTerm)
+                {
+                    truncated = true;
+                    break;
+                }
+
+                ids.push_back (it->second);
+            }
+        }
+        else if (const auto it = termIDs.find (queryTerm); it != termIDs.end())
+        {
+            ids.push_back (it->second);
+        }
+
+        const auto maxEdits = getMaxEdits (queryTerm.size());
+        if (fuzzy && maxEdits > 0)
+        {
+            for (const auto& [term, id] : termIDs)
+            {
+                if (getEditDistance (queryTerm, term, maxEdits) > maxEdits)
+                    continue;
+
+                if ((int) ids.size() >= maxExpansionsPerTerm)
+                {
+                    truncated = true;
+                    break;
+                }
+
+                ids.push_back (id);
+            }
+
+            std::sort (ids.begin(), ids.end());
+            ids.erase (std::unique (ids.begin(), ids.end()), ids.end());
+        }
+
+        return ids;
+    }
+
+    // Returns the sorted indices of segments containing the query terms in order
+    static std::vector<int> searchSource (const SourceIndex& source, const std::vector<std::vector<uint32_t>>& expansions)
+    {
+        const auto collect = [&source] (const std::vector<uint32_t>& ids)
+        {
+            std::vector<uint64_t> occurrences;
+            for (const auto id : ids)
+                if (const auto it = source.postings.find (id); it != source.postings.end())
+                    occurrences.insert (occurrences.end(), it->second.begin(), it->second.end());
+            return occurrences;
+        };
+
+        std::vector<int> segments;
+
+        const auto first = collect (expansions[0]);
+        if (first.empty())
+            return segments;
+
+        // Later terms are looked up by the occurrence they would need to have
+        std::vector<std::unordered_set<uint64_t>> following;
+        for (size_t k = 1; k < expansions.size(); ++k)
+        {
+            const auto occurrences = collect (expansions[k]);
+            if (occurrences.empty())
+                return segments;
+
+            following.emplace_back (occurrences.begin(), occurrences.end());
+        }
+
+        for (const auto occurrence : first)
+        {
+            bool isMatch = true;
+            for (size_t k = 0; k < following.size() && isMatch; ++k)
+                isMatch = following[k].count (occurrence + k + 1) > 0;
+
+            if (isMatch)
+                segments.push_back (getSegment (occurrence));
+        }
+
+        std::sort (segments.begin(), segments.end());
+        segments.erase (std::unique (segments.begin(), segments.end()), segments.end());
+        return segments;
+    }
+
+    std::map<std::u32string, uint32_t> termIDs;
+    std::vector<std::map<std::u32string, uint32_t>::iterator> termsByID;
+    std::vector<int> termRefCounts; // Number of sources using each term
+    std::vector<uint32_t> freeTermIDs;
+    std::map<juce::String, SourceIndex> sources;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <juce_core/juce_core.h>
+#include <whisper.h>
+
+// Process-wide cache of loaded whisper models, shared by all engines through
+// juce::SharedResourcePointer.
+//
+// A model's weights are loaded once and freed when the last engine using it
+// lets go. Contexts are loaded without a state; each engine creates its own
+// with whisper_init_state, so engines can run on the same weights at once,
+// e.g. live captions alongside a file job.
+class WhisperModelCache
+{
+public:
+    using Model = std::shared_ptr<whisper_context>;
+
+    // Returns the loaded model at the given path, loading it if no engine
+    // holds it yet. Returns nullptr if it fails to load.
+    Model acquire (const std::string& modelPath, const whisper_context_params& params)
+    {
+        const juce::ScopedLock lock (modelsLock);
+
+        if (auto model = models[modelPath].lock())
+        {
+            DBG ("Sharing loaded model: " + modelPath);
+            return model;
+        }
+
+        auto* ctx = whisper_init_from_file_with_params_no_state (modelPath.c_str(), params);
+        if (ctx == nullptr)
+        {
+            models.erase (modelPath);
+            return nullptr;
+        }
+
+        Model model (ctx, [] (whisper_context* c)
+        {
+            DBG ("Freeing whisper context");
+            whisper_free (c);
+        });
+
+        models[modelPath] = model;
+        return model;
+    }
+
+private:
+    juce::CriticalSection modelsLock;
+    std::map<std::string, std::weak_ptr<whisper_context>> models;
+};
@@ -8,6 +8,8 @@
 #include "../reaper/ReaperProxy.h"
 #include "../reaper/VST3Extensions.h"
 #include "../types/PlayHeadState.h"
+#include "../utils/ComputeBudget.h"
+#include "../utils/LiveInputBuffer.h"
 
 class ReaSpeechLiteAudioProcessorImpl :
     public juce::AudioProcessor,
@@ -17,13 +19,18 @@ public:
     ReaSpeechLiteAudioProcessorImpl() : AudioProcessor (getBusesProperties())
     {
         state.setProperty ("webState", juce::var(), nullptr);
+        computeBudget->addPlayHead (&playHeadState);
     }
 
-    ~ReaSpeechLiteAudioProcessorImpl() override = default;
+    ~ReaSpeechLiteAudioProcessorImpl() override
+    {
+        computeBudget->removePlayHead (&playHeadState);
+    }
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override
     {
         playHeadState.update (juce::nullopt);
+        liveInput.setSampleRate (sampleRate);
         prepareToPlayForARA (sampleRate, samplesPerBlock, getMainBusNumOutputChannels(), getProcessingPrecision());
     }
 
@@ -57,6 +64,9 @@ public:
         auto* audioPlayHead = getPlayHead();
         playHeadState.update (audioPlayHead->getPosition());
 
+        // Capture the input before ARA rendering replaces it
+        liveInput.push (buffer, getTotalNumInputChannels());
+
         if (! processBlockForARA (buffer, isRealtime(), audioPlayHead))
             processBlockBypassed (buffer, midiMessages);
     }
@@ -94,9 +104,12 @@ public:
     VST3Extensions vst3Extensions { reaperProxy };
 
     PlayHeadState playHeadState;
+    LiveInputBuffer liveInput;
     juce::ValueTree state { "state" };
 
 private:
+    juce::SharedResourcePointer<ComputeBudget> computeBudget;
+
     static BusesProperties getBusesProperties()
     {
         return BusesProperties()
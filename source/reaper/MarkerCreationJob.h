@@ -0,0 +1,312 @@
+#pragma once
+
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+#include "../Config.h"
+#include "../types/MarkerType.h"
+#include "NotesTrackChunk.h"
+#include "ReaperProxy.h"
+
+// Creates REAPER markers, regions or a notes track from a transcript without
+// blocking the message thread for the whole batch.
+//
+// Work is done in time slices on a message thread timer, so REAPER keeps
+// redrawing and handling input in between. Each slice is its own undo block,
+// closed before returning to the message loop, so edits the user makes
+// while the job runs never end up inside it. Items created before a cancel
+// are kept. Markers and regions that already exist in the project, with the
+// same position, end and name, are skipped.
+class MarkerCreationJob : private juce::Timer
+{
+public:
+    using ProgressCallback = std::function<void (int done, int total)>;
+    // Called once with { created, skipped, cancelled, error? }. The job must
+    // not be destroyed from within the callback.
+    using CompletionCallback = std::function<void (const juce::var& result)>;
+
+    MarkerCreationJob (
+        ReaperProxy& rprIn,
+        std::vector<NotesTrackChunk::Note> notesIn,
+        MarkerType::Enum markerTypeIn,
+        ProgressCallback onProgressIn,
+        CompletionCallback onCompleteIn
+    ) : rpr (rprIn),
+        notes (std::move (notesIn)),
+        markerType (markerTypeIn),
+        onProgress (std::move (onProgressIn)),
+        onComplete (std::move (onCompleteIn))
+    {
+    }
+
+    // An unfinished job stops without reporting
+    ~MarkerCreationJob() override
+    {
+        stopTimer();
+
+        if (! finished)
+            restoreCursorPosition();
+    }
+
+    void start()
+    {
+        undoLabel = "Create " + MarkerType::toString (markerType) + " from transcript";
+        startTimer (Config::markerCreationIntervalMs);
+    }
+
+    // Stops before the next slice; the result reports the job as cancelled
+    void cancel()
+    {
+        if (! finished)
+            finish (true);
+    }
+
+    bool isFinished() const noexcept { return finished; }
+
+private:
+    void timerCallback() override
+    {
+        if (rpr.hasPreventUIRefresh)
+            rpr.PreventUIRefresh (1);
+
+        if (rpr.hasUndo_BeginBlock2)
+            rpr.Undo_BeginBlock2 (ReaperProxy::activeProject);
+
+        const auto first = next;
+
+        try
+        {
+            runSlice();
+        }
+        catch (const ReaperProxy::Missing& e)
+        {
+            DBG ("Missing REAPER API function: " + juce::String (e.what()));
+            error = "Missing REAPER API function: " + juce::String (e.what());
+            next = notes.size();
+        }
+
+        endUndoBlock (first);
+
+        if (rpr.hasPreventUIRefresh)
+            rpr.PreventUIRefresh (-1);
+
+        if (next >= notes.size())
+            finish (false);
+        else if (onProgress)
+            onProgress ((int) next, (int) notes.size());
+    }
+
+    void runSlice()
+    {
+        const auto deadline = juce::Time::getMillisecondCounterHiRes() + Config::markerCreationSliceMs;
+
+        if (! prepared)
+        {
+            prepared = true;
+            if (markerType == MarkerType::notes)
+            {
+                if (createNotesTrack())
+                    return;
+            }
+            else
+            {
+                collectExistingMarkers();
+            }
+        }
+
+        while (next < notes.size() && juce::Time::getMillisecondCounterHiRes() < deadline)
+        {
+            if (markerType == MarkerType::notes)
+                addNotesItem (notes[next]);
+            else
+                addMarker (notes[next], (int) next + 1);
+
+            ++next;
+        }
+    }
+
+    void finish (bool cancelled)
+    {
+        stopTimer();
+        finished = true;
+        restoreCursorPosition();
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("created", numCreated);
+        result->setProperty ("skipped", numSkipped);
+        result->setProperty ("cancelled", cancelled);
+        if (error.isNotEmpty())
+            result->setProperty ("error", error);
+
+        if (onComplete)
+            onComplete (juce::var (result.get()));
+    }
+
+    // Closes the slice's undo block. A job that takes several slices leaves
+    // one undo point per slice, labelled with the items it created.
+    void endUndoBlock (size_t first)
+    {
+        if (! rpr.hasUndo_EndBlock2)
+            return;
+
+        auto label = undoLabel;
+        if (next > first && (first > 0 || next < notes.size()))
+            label << " (" << juce::String (first + 1) << "-" << juce::String (next) << " of " << juce::String (notes.size()) << ")";
+
+        rpr.Undo_EndBlock2 (ReaperProxy::activeProject, label.toRawUTF8(), -1);
+    }
+
+    void restoreCursorPosition()
+    {
+        if (originalPosition >= 0.0 && rpr.hasSetEditCurPos2)
+            rpr.SetEditCurPos2 (ReaperProxy::activeProject, originalPosition, true, true);
+
+        originalPosition = -1.0;
+    }
+
+    //==============================================================================
+    static juce::String makeMarkerKey (bool isRegion, double start, double end, const juce::String& name)
+    {
+        // Positions are compared at millisecond resolution, which absorbs rounding in REAPER
+        return juce::String (isRegion ? "R" : "M")
+            + juce::String (juce::roundToInt (start * 1000.0)) + ":"
+            + juce::String (isRegion ? juce::roundToInt (end * 1000.0) : 0) + ":"
+            + name;
+    }
+
+    void collectExistingMarkers()
+    {
+        if (! rpr.hasEnumProjectMarkers3)
+            return;
+
+        bool isRegion = false;
+        double start = 0.0;
+        double end = 0.0;
+        const char* name = nullptr;
+        int number = 0;
+        int color = 0;
+
+        for (int i = 0; rpr.EnumProjectMarkers3 (ReaperProxy::activeProject, i, &isRegion, &start, &end, &name, &number, &color) > 0; ++i)
+            existingMarkers.insert (makeMarkerKey (isRegion, start, end, juce::String::fromUTF8 (name != nullptr ? name : "")));
+    }
+
+    void addMarker (const NotesTrackChunk::Note& note, int markerNum)
+    {
+        const auto isRegion = markerType == MarkerType::regions;
+
+        // Also skips duplicates within the transcript itself
+        if (! existingMarkers.insert (makeMarkerKey (isRegion, note.start, note.end, note.text)).second)
+        {
+            ++numSkipped;
+            return;
+        }
+
+        rpr.AddProjectMarker2 (ReaperProxy::activeProject, isRegion, note.start, note.end, note.text.toRawUTF8(), markerNum, 0);
+        ++numCreated;
+    }
+
+    //==============================================================================
+    // Inserts the notes track. Returns true if all items were added with it.
+    bool createNotesTrack()
+    {
+        const auto index = 0;
+        originalPosition = rpr.GetCursorPositionEx (ReaperProxy::activeProject);
+
+        rpr.InsertTrackInProject (ReaperProxy::activeProject, index, 0);
+        track = rpr.GetTrack (ReaperProxy::activeProject, index);
+        rpr.SetOnlyTrackSelected (track);
+        rpr.GetSetMediaTrackInfo_String (track, "P_NAME", const_cast<char*> ("Transcript"), true);
+
+        if (rpr.hasGetTrackStateChunk && rpr.hasSetTrackStateChunk && addNotesItemsInBulk())
+        {
+            numCreated = (int) notes.size();
+            next = notes.size();
+            return true;
+        }
+
+        return false;
+    }
+
+    // Adds all notes items to the track by rewriting its state chunk in one call
+    bool addNotesItemsInBulk()
+    {
+        const auto trackChunk = getTrackStateChunk();
+        if (trackChunk.isEmpty())
+            return false;
+
+        const auto newChunk = NotesTrackChunk::build (trackChunk, notes);
+        if (newChunk.isEmpty())
+            return false;
+
+        return rpr.SetTrackStateChunk (track, newChunk.toRawUTF8(), false);
+    }
+
+    // Returns the track's state chunk, or an empty string if it can't be read
+    juce::String getTrackStateChunk()
+    {
+        // A new track's chunk is a few kilobytes; grow the buffer if it fills up
+        constexpr size_t initialSize = 64 * 1024;
+        constexpr size_t maxSize = 16 * 1024 * 1024;
+
+        for (auto size = initialSize; size <= maxSize; size *= 2)
+        {
+            juce::HeapBlock<char> buffer (size, true);
+            if (! rpr.GetTrackStateChunk (track, buffer.get(), (int) size, false))
+                return {};
+
+            // The buffer was zeroed, so a chunk that fit leaves the last bytes untouched
+            if (buffer[size - 2] == 0)
+                return juce::String::fromUTF8 (buffer.get());
+        }
+
+        return {};
+    }
+
+    // Fallback for hosts without track state chunk access: one item at a time
+    void addNotesItem (const NotesTrackChunk::Note& note)
+    {
+        rpr.Main_OnCommandEx (40142, 0, ReaperProxy::activeProject); // Insert empty item
+        auto* item = rpr.GetSelectedMediaItem (ReaperProxy::activeProject, 0);
+        rpr.SelectAllMediaItems (ReaperProxy::activeProject, false);
+        rpr.SetMediaItemPosition (item, note.start, true);
+        rpr.SetMediaItemLength (item, note.end - note.start, true);
+
+        char buffer[4096];
+        rpr.GetItemStateChunk (item, buffer, sizeof (buffer), false);
+        const auto chunk = juce::String (buffer);
+
+        // New items have a chunk of around 200 bytes
+        jassert ((size_t) chunk.length() < sizeof (buffer) - 1);
+
+        juce::MemoryOutputStream notesChunk;
+        NotesTrackChunk::writeNotes (notesChunk, note.text);
+
+        const auto newChunk = chunk.replace (">", notesChunk.toUTF8() + ">");
+        rpr.SetItemStateChunk (item, newChunk.toRawUTF8(), false);
+        ++numCreated;
+    }
+
+    ReaperProxy& rpr;
+    const std::vector<NotesTrackChunk::Note> notes;
+    const MarkerType::Enum markerType;
+    ProgressCallback onProgress;
+    CompletionCallback onComplete;
+
+    juce::String undoLabel;
+    juce::String error;
+    bool prepared = false;
+    bool finished = false;
+    size_t next = 0;
+    int numCreated = 0;
+    int numSkipped = 0;
+
+    std::unordered_set<juce::String> existingMarkers;
+    ReaperProxy::MediaTrack* track = nullptr;
+    double originalPosition = -1.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarkerCreationJob)
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+// Builds the state chunk of a track filled with notes items.
+//
+// Creating notes items one at a time costs several REAPER API calls and a
+// state chunk round trip per item. Instead, the item chunks are generated
+// here and appended to an empty track's chunk, so the whole track can be
+// applied with a single SetTrackStateChunk call. REAPER assigns item GUIDs
+// when it loads the chunk.
+struct NotesTrackChunk
+{
+    struct Note
+    {
+        double start = 0.0;
+        double end = 0.0;
+        juce::String text;
+    };
+
+    // Returns the track chunk with the notes items added, or an empty string
+    // if the track chunk is malformed
+    static juce::String build (const juce::String& trackChunk, const std::vector<Note>& notes)
+    {
+        // Items go at the end of the track, before its closing ">"
+        const auto end = trackChunk.trimEnd().lastIndexOfChar ('>');
+        if (end < 0)
+            return {};
+
+        juce::MemoryOutputStream out;
+        out.preallocate ((size_t) trackChunk.getNumBytesAsUTF8() + notes.size() * 160);
+
+        out << trackChunk.substring (0, end);
+
+        for (const auto& note : notes)
+            writeItem (out, note);
+
+        out << trackChunk.substring (end);
+        return out.toUTF8();
+    }
+
+    static void writeItem (juce::OutputStream& out, const Note& note)
+    {
+        out << "<ITEM\n"
+            << "POSITION " << formatTime (note.start) << "\n"
+            << "LENGTH " << formatTime (juce::jmax (0.0, note.end - note.start)) << "\n"
+            << "LOOP 0\n"
+            << "ALLTAKES 0\n"
+            << "SEL 0\n";
+
+        writeNotes (out, note.text);
+        out << ">\n";
+    }
+
+    // Writes a <NOTES> block, in which each line of text is prefixed with "|"
+    static void writeNotes (juce::OutputStream& out, const juce::String& text)
+    {
+        out << "<NOTES\n";
+
+        for (const auto& line : juce::StringArray::fromLines (text.trim()))
+            out << "|" << line.replace ("%", "%%") << "\n";
+
+        out << ">\n";
+    }
+
+private:
+    static juce::String formatTime (double seconds)
+    {
+        return juce::String (seconds, 10);
+    }
+};
@@ -24,11 +24,13 @@ struct ReaperProxy
             return;
 
         hasAddProjectMarker2 = reaperHost->getReaperApi("AddProjectMarker2");
+        hasEnumProjectMarkers3 = reaperHost->getReaperApi("EnumProjectMarkers3");
         hasGetCursorPositionEx = reaperHost->getReaperApi("GetCursorPositionEx");
         hasGetItemStateChunk = reaperHost->getReaperApi("GetItemStateChunk");
         hasGetSelectedMediaItem = reaperHost->getReaperApi("GetSelectedMediaItem");
         hasGetSetMediaTrackInfo_String = reaperHost->getReaperApi("GetSetMediaTrackInfo_String");
         hasGetTrack = reaperHost->getReaperApi("GetTrack");
+        hasGetTrackStateChunk = reaperHost->getReaperApi("GetTrackStateChunk");
         hasInsertTrackInProject = reaperHost->getReaperApi("InsertTrackInProject");
         hasMain_OnCommandEx = reaperHost->getReaperApi("Main_OnCommandEx");
         hasPreventUIRefresh = reaperHost->getReaperApi("PreventUIRefresh");
@@ -38,6 +40,7 @@ struct ReaperProxy
         hasSetMediaItemLength = reaperHost->getReaperApi("SetMediaItemLength");
         hasSetMediaItemPosition = reaperHost->getReaperApi("SetMediaItemPosition");
         hasSetOnlyTrackSelected = reaperHost->getReaperApi("SetOnlyTrackSelected");
+        hasSetTrackStateChunk = reaperHost->getReaperApi("SetTrackStateChunk");
         hasUndo_BeginBlock2 = reaperHost->getReaperApi("Undo_BeginBlock2");
         hasUndo_EndBlock2 = reaperHost->getReaperApi("Undo_EndBlock2");
     }
@@ -62,6 +65,12 @@ struct ReaperProxy
         REAPER_CALL(AddProjectMarker2, int (*) (ReaProject*, bool, double, double, const char*, int, int), proj, isrgn, pos, rgnend, name, wantidx, color)
     }
 
+    void* hasEnumProjectMarkers3 = nullptr;
+    int EnumProjectMarkers3 (ReaProject* proj, int idx, bool* isrgnOut, double* posOut, double* rgnendOut, const char** nameOut, int* markrgnindexnumberOut, int* colorOut)
+    {
+        REAPER_CALL(EnumProjectMarkers3, int (*) (ReaProject*, int, bool*, double*, double*, const char**, int*, int*), proj, idx, isrgnOut, posOut, rgnendOut, nameOut, markrgnindexnumberOut, colorOut)
+    }
+
     void* hasGetCursorPositionEx = nullptr;
     double GetCursorPositionEx (ReaProject* proj)
     {
@@ -92,6 +101,12 @@ struct ReaperProxy
         REAPER_CALL(GetTrack, MediaTrack* (*) (ReaProject*, int), proj, trackidx)
     }
 
+    void* hasGetTrackStateChunk = nullptr;
+    bool GetTrackStateChunk (MediaTrack* track, char* strNeedBig, int strNeedBig_sz, bool isundoOptional)
+    {
+        REAPER_CALL(GetTrackStateChunk, bool (*) (MediaTrack*, char*, int, bool), track, strNeedBig, strNeedBig_sz, isundoOptional)
+    }
+
     void* hasInsertTrackInProject = nullptr;
     MediaTrack* InsertTrackInProject (ReaProject* proj, int idx, int flags)
     {
@@ -146,6 +161,12 @@ struct ReaperProxy
         REAPER_CALL(SetOnlyTrackSelected, void (*) (MediaTrack*), track)
     }
 
+    void* hasSetTrackStateChunk = nullptr;
+    bool SetTrackStateChunk (MediaTrack* track, const char* str, bool isundoOptional)
+    {
+        REAPER_CALL(SetTrackStateChunk, bool (*) (MediaTrack*, const char*, bool), track, str, isundoOptional)
+    }
+
     void* hasUndo_BeginBlock2 = nullptr;
     void Undo_BeginBlock2(ReaProject* proj)
     {
@@ -10,6 +10,7 @@ export interface AudioSource {
 
 // An ARA PlaybackRegion, also known as a media item
 export interface PlaybackRegion {
+  id?: number;
   playbackStart: number;
   playbackEnd: number;
   modificationStart: number;
@@ -17,6 +18,33 @@ export interface PlaybackRegion {
   audioSourcePersistentID: string;
 }
 
+// Changes to playback regions since baseVersion
+export interface PlaybackRegionsDiff {
+  baseVersion: number;
+  version: number;
+  added: PlaybackRegion[];
+  moved: PlaybackRegion[];
+  removed: number[];
+}
+
+// A time range in audio source time, and in playback time when it is
+// being played by a playback region
+export interface TimelineRange {
+  start: number;
+  end: number;
+  playbackStart?: number;
+  playbackEnd?: number;
+}
+
+// The segment and word at a point in time, as found by lookupAtTime
+export interface TimelineHit {
+  regionID?: number;
+  persistentID: string;
+  sourceTime: number;
+  segment?: TimelineRange & { id: number, text: string };
+  word?: TimelineRange & { text: string };
+}
+
 // An ARA RegionSequence, also known as a track
 export interface RegionSequence {
   name: string;
@@ -1,6 +1,15 @@
 export interface Segment {
+  id?: number;
   start: number;
   end: number;
   text: string;
   score: number;
 }
+
+export interface SegmentOperation {
+  op: 'replace' | 'delete';
+  id: number;
+  text?: string;
+  start?: number;
+  end?: number;
+}
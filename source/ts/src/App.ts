@@ -1,9 +1,20 @@
 import AudioSourceGrid from './AudioSourceGrid';
 import Native from './Native';
-import TranscriptGrid from './TranscriptGrid';
-import { AudioSource, PlaybackRegion, RegionSequence } from './ARA';
+import TranscriptGrid, { TranscriptRow } from './TranscriptGrid';
+import { AudioSource, PlaybackRegion, PlaybackRegionsDiff, RegionSequence, TimelineHit } from './ARA';
+import { SegmentOperation } from './ASR';
 import { delay, htmlEscape } from './Utils';
 
+// How much of a transcript the grid has loaded
+interface TranscriptPages {
+  audioSource: AudioSource;
+  version: number;
+  loaded: number;
+  total: number;
+  lastSegmentID?: number;
+  pending?: Promise<void>;
+}
+
 declare global {
   interface Window {
     __JUCE__: {
@@ -19,14 +30,37 @@ declare global {
 }
 
 export default class App {
+  static readonly maxLiveCaptionLines = 3;
+  static readonly transcriptPageSize = 500;
+  static readonly maxSearchResults = 10000;
+
   private native: Native;
 
   processing: boolean = false;
+  tracing: boolean = false;
+  live: boolean = false;
   state: any;
 
   audioSourceGrid: AudioSourceGrid;
   transcriptGrid: TranscriptGrid;
 
+  // Transcript version last seen for each audio source, by persistent ID
+  transcriptVersions: Map<string, number> = new Map();
+
+  // Pages loaded for each transcript, by persistent ID. Only the first page
+  // is loaded up front; the rest follow as the grid is scrolled to them.
+  transcriptPages: Map<string, TranscriptPages> = new Map();
+
+  // Playback regions by ID, kept in sync through playbackRegionsChanged diffs
+  playbackRegions: Map<number, PlaybackRegion> = new Map();
+  playbackRegionsVersion: number = -1;
+
+  // Identifies the latest search, so that stale results are ignored
+  private searchID = 0;
+
+  // Identifies the latest playhead lookup, for the same reason
+  private lookupID = 0;
+
   constructor() {
     this.native = new Native();
 
@@ -34,6 +68,7 @@ export default class App {
       modelName: 'small',
       language: '',
       translate: false,
+      bilingual: false,
       vad: false,
     };
   }
@@ -43,6 +78,7 @@ export default class App {
     this.initAudioSources();
     this.initButtons();
     this.initSearch();
+    this.initShortcuts();
     this.initNativeEvents();
     this.startPolling();
   }
@@ -51,7 +87,10 @@ export default class App {
     this.loadState().then(() => {
       this.initModels();
       this.initLanguages();
-      this.initTranscript();
+      this.initTranscript().then(() => {
+        // Later changes arrive as playHeadStateChanged and playbackRegionsChanged events
+        return this.updatePlaybackRegions();
+      });
     });
   }
 
@@ -67,6 +106,7 @@ export default class App {
     this.initClearTranscriptButton();
     this.initCreateButton();
     this.initExportButton();
+    this.initLiveButton();
   }
 
   initProcessButton() {
@@ -106,11 +146,23 @@ export default class App {
     document.getElementById('create-markers').onclick = () => { this.handleCreateMarkers('markers'); };
     document.getElementById('create-regions').onclick = () => { this.handleCreateMarkers('regions'); };
     document.getElementById('create-notes').onclick = () => { this.handleCreateMarkers('notes'); };
+    document.getElementById('create-cancel').onclick = () => { this.native.cancelMarkerCreation(); };
   }
 
   initExportButton() {
-    document.getElementById('export-csv').onclick = () => { this.transcriptGrid.exportCSV(this.saveAs.bind(this)); };
-    document.getElementById('export-srt').onclick = () => { this.transcriptGrid.exportSRT(this.saveAs.bind(this)); };
+    // Exports are written natively, straight from the stored transcripts
+    for (const format of ['csv', 'srt', 'vtt', 'json', 'words']) {
+      document.getElementById('export-' + format).onclick = () => { this.handleExport(format); };
+    }
+
+    // Translations from bilingual jobs are the first alternate transcript
+    for (const format of ['srt', 'vtt']) {
+      document.getElementById('export-' + format + '-translation').onclick = () => { this.handleExport(format, { alternate: 0 }); };
+    }
+  }
+
+  initLiveButton() {
+    document.getElementById('live-button').onclick = () => { this.toggleLive(); };
   }
 
   initSearch() {
@@ -119,10 +171,25 @@ export default class App {
     document.getElementById('clear-search').onclick = this.clearSearch.bind(this);
   }
 
+  initShortcuts() {
+    document.addEventListener('keydown', (event: KeyboardEvent) => {
+      // Ctrl+Alt+T (Cmd+Alt+T on macOS) toggles performance tracing
+      if ((event.ctrlKey || event.metaKey) && event.altKey && event.code === 'KeyT') {
+        event.preventDefault();
+        this.toggleTracing();
+      }
+    });
+  }
+
   initNativeEvents() {
     window.__JUCE__.backend.addEventListener('audioSourceAdded', this.handleAudioSourceAdded.bind(this));
     window.__JUCE__.backend.addEventListener('audioSourceRemoved', this.handleAudioSourceRemoved.bind(this));
     window.__JUCE__.backend.addEventListener('audioSourceContentUpdated', this.handleAudioSourceUpdated.bind(this));
+    window.__JUCE__.backend.addEventListener('audioSourceTranscriptPatched', this.handleTranscriptPatched.bind(this));
+    window.__JUCE__.backend.addEventListener('liveTranscript', this.handleLiveTranscript.bind(this));
+    window.__JUCE__.backend.addEventListener('markerCreationProgress', this.handleMarkerCreationProgress.bind(this));
+    window.__JUCE__.backend.addEventListener('playHeadStateChanged', this.handlePlayHeadStateChanged.bind(this));
+    window.__JUCE__.backend.addEventListener('playbackRegionsChanged', this.handlePlaybackRegionsChanged.bind(this));
   }
 
   startPolling() {
@@ -206,6 +273,10 @@ export default class App {
       translateCheckbox.checked = this.state.translate;
       translateCheckbox.onchange = this.handleTranslateChange.bind(this);
 
+      const bilingualCheckbox = document.getElementById('bilingual-checkbox') as HTMLInputElement;
+      bilingualCheckbox.checked = this.state.bilingual;
+      bilingualCheckbox.onchange = this.handleBilingualChange.bind(this);
+
       const vadCheckbox = document.getElementById('vad-checkbox') as HTMLInputElement;
       vadCheckbox.checked = this.state.vad;
       vadCheckbox.onchange = this.handleVadChange.bind(this);
@@ -213,7 +284,12 @@ export default class App {
   }
 
   initTranscript() {
-    this.transcriptGrid = new TranscriptGrid('#transcript-grid', (seconds) => this.playAt(seconds));
+    this.transcriptGrid = new TranscriptGrid(
+      '#transcript-grid',
+      (seconds) => this.playAt(seconds),
+      (row) => this.handleTextEdited(row),
+      (sourceID) => this.loadNextTranscriptPage(sourceID)
+    );
     return this.native.getAudioSources().then((audioSources: AudioSource[]) => {
       const promises = audioSources.map((audioSource) => {
         return this.mergeTranscript(audioSource);
@@ -246,6 +322,71 @@ export default class App {
     });
   }
 
+  handleTranscriptPatched(event: { persistentID: string, baseVersion: number, version: number, operations: SegmentOperation[] }) {
+    const knownVersion = this.transcriptVersions.get(event.persistentID);
+
+    // Already applied, e.g. an edit made here whose reply arrived first
+    if (knownVersion === event.version) {
+      return Promise.resolve();
+    }
+
+    // Missed an earlier change, so the whole transcript must be fetched again
+    if (knownVersion !== event.baseVersion) {
+      return this.reloadTranscript(event.persistentID);
+    }
+
+    this.transcriptVersions.set(event.persistentID, event.version);
+    this.transcriptGrid.applySegmentOperations(event.persistentID, event.operations);
+    return Promise.resolve();
+  }
+
+  handleTextEdited(row: TranscriptRow) {
+    const operations: SegmentOperation[] = [{ op: 'replace', id: row.segmentID, text: row.text }];
+    const baseVersion = this.transcriptVersions.get(row.sourceID) ?? 0;
+
+    return this.native.updateTranscriptSegments(row.sourceID, baseVersion, operations).then((result) => {
+      if (result.error) {
+        console.warn('Error updating transcript for audio source:', row.sourceID, result.error);
+        return this.reloadTranscript(row.sourceID);
+      }
+
+      if (this.transcriptVersions.get(row.sourceID) === baseVersion) {
+        this.transcriptVersions.set(row.sourceID, result.version);
+      }
+    });
+  }
+
+  handleLiveTranscript(event: { type: string, text?: string, status?: string, error?: string }) {
+    const partial = document.getElementById('live-captions-partial');
+
+    switch (event.type) {
+      case 'partial':
+        partial.textContent = event.text;
+        break;
+
+      case 'final': {
+        const finalLines = document.getElementById('live-captions-final');
+        const line = document.createElement('div');
+        line.textContent = event.text;
+        finalLines.appendChild(line);
+        while (finalLines.childElementCount > App.maxLiveCaptionLines) {
+          finalLines.firstElementChild.remove();
+        }
+        partial.textContent = '';
+        break;
+      }
+
+      case 'status':
+        partial.textContent = event.status + '...';
+        break;
+
+      case 'error':
+        this.showAlert('danger', '<b>Error:</b> ' + htmlEscape(event.error));
+        this.setLive(false);
+        break;
+    }
+  }
+
   handleModelChange() {
     const select = document.getElementById('model-select') as HTMLSelectElement;
     this.state.modelName = select.options[select.selectedIndex].value;
@@ -263,6 +404,11 @@ export default class App {
     return this.saveState();
   }
 
+  handleBilingualChange() {
+    this.state.bilingual = (document.getElementById('bilingual-checkbox') as HTMLInputElement).checked;
+    return this.saveState();
+  }
+
   handleVadChange() {
     this.state.vad = (document.getElementById('vad-checkbox') as HTMLInputElement).checked;
     return this.saveState();
@@ -276,14 +422,21 @@ export default class App {
     const languageSelect = document.getElementById('language-select') as HTMLSelectElement;
     const languageCode = languageSelect.options[languageSelect.selectedIndex].value;
     const translate = (document.getElementById('translate-checkbox') as HTMLInputElement).checked;
+    const bilingual = (document.getElementById('bilingual-checkbox') as HTMLInputElement).checked;
     const vad = (document.getElementById('vad-checkbox') as HTMLInputElement).checked;
-    const asrOptions = {
+    const asrOptions: any = {
       modelName: this.state.modelName,
       language: languageCode,
       translate: translate,
       vad: vad
     };
 
+    // The translation is decoded alongside the transcript in the same job,
+    // and kept natively for export
+    if (bilingual && !translate) {
+      asrOptions.alternates = [{ language: languageCode, translate: true }];
+    }
+
     const selectedAudioSourceIds = new Set(this.audioSourceGrid.getSelectedRowIds());
 
     return this.native.getAudioSources().then((audioSources: AudioSource[]) => {
@@ -313,9 +466,9 @@ export default class App {
             return processNextAudioSource();
           }
 
-          return this.native.setAudioSourceTranscript(audioSource.persistentID, result).then(() => {
-            return processNextAudioSource();
-          });
+          // The transcript is stored on the audio source natively, and shows up
+          // through the audioSourceContentUpdated event
+          return processNextAudioSource();
         });
       };
 
@@ -350,6 +503,14 @@ export default class App {
   }
 
   handleCreateMarkers(markerType: string) {
+    // Markers cover whole transcripts, including pages not scrolled to yet
+    if (this.hasUnloadedTranscriptPages()) {
+      return this.loadAllTranscriptPages().then(() => this.createMarkersFromRows(markerType));
+    }
+    return this.createMarkersFromRows(markerType);
+  }
+
+  createMarkersFromRows(markerType: string) {
     const rows = this.transcriptGrid.getRows();
     let markers = [];
 
@@ -364,9 +525,16 @@ export default class App {
     }
 
     if (markers.length > 0) {
+      // Markers are created natively in slices, reporting progress as they go
+      this.showMarkerCreationProgress(0, markers.length);
+
       return this.native.createMarkers(markers, markerType).then((result) => {
+        this.hideMarkerCreationProgress();
+
         if (result && result.error) {
           this.showAlert('danger', '<b>Error:</b> ' + htmlEscape(result.error));
+        } else if (result && result.skipped > 0) {
+          this.showAlert('info', `Skipped ${result.skipped} ${markerType} that already exist.`);
         }
       });
     } else {
@@ -374,16 +542,61 @@ export default class App {
     }
   }
 
+  handleMarkerCreationProgress(event: { done: number, total: number }) {
+    this.showMarkerCreationProgress(event.done, event.total);
+  }
+
+  showMarkerCreationProgress(done: number, total: number) {
+    document.getElementById('create-progress-text').textContent = `Creating ${done} / ${total}`;
+    document.getElementById('create-progress').style.display = 'block';
+  }
+
+  hideMarkerCreationProgress() {
+    document.getElementById('create-progress').style.display = 'none';
+  }
+
   handleSearch(event: Event) {
     const target = event.target as HTMLInputElement;
-    this.transcriptGrid.filter(target.value);
+    const text = target.value;
+    const searchID = ++this.searchID;
+
+    // Filter loaded rows right away, then narrow to native search results,
+    // which cover every transcript and allow prefix and fuzzy matches
+    this.transcriptGrid.filter(text);
+
+    if (text.trim() === '') {
+      return Promise.resolve();
+    }
+
+    const options = { prefix: true, fuzzy: true, limit: App.maxSearchResults };
+    return this.native.searchTranscripts(text, options).then((result) => {
+      if (searchID !== this.searchID || result.error || result.truncated) {
+        return;
+      }
+
+      // Matches can be in pages not loaded yet, which the filter needs as rows
+      const lastMatchBySource = new Map<string, number>();
+      for (const match of result.results) {
+        lastMatchBySource.set(match.persistentID, Math.max(match.segmentID, lastMatchBySource.get(match.persistentID) ?? -1));
+      }
+
+      const loads = Array.from(lastMatchBySource).map(([persistentID, segmentID]) => {
+        return this.loadTranscriptThrough(persistentID, segmentID);
+      });
+
+      return Promise.all(loads).then(() => {
+        if (searchID !== this.searchID) {
+          return;
+        }
+
+        const rowIDs = new Set<string>(result.results.map((match) => match.persistentID + '-' + match.segmentID));
+        this.transcriptGrid.filter(text, rowIDs);
+      });
+    });
   }
 
   update() {
-    return Promise.all([
-      this.updateTranscriptionStatus(),
-      this.updatePlaybackRegions(),
-    ]);
+    return this.updateTranscriptionStatus();
   }
 
   updateAudioSources() {
@@ -411,27 +624,94 @@ export default class App {
   }
 
   updatePlaybackRegions() {
-    return this.native.getRegionSequences().then((regionSequences: RegionSequence[]) => {
-      const playbackRegionsByAudioSource =
-        this.collectPlaybackRegionsByAudioSource(regionSequences);
-      this.transcriptGrid.setPlaybackRegionMap(playbackRegionsByAudioSource);
+    return this.native.getPlaybackRegions().then((snapshot: { version: number, regions: PlaybackRegion[] }) => {
+      this.playbackRegions = new Map(snapshot.regions.map((region) => [region.id, region]));
+      this.playbackRegionsVersion = snapshot.version;
+      this.applyPlaybackRegions();
 
       return this.native.getPlayHeadState().then((playHeadState) => {
-        this.transcriptGrid.setPlaybackPosition(playHeadState.timeInSeconds, playHeadState.isPlaying);
+        this.handlePlayHeadStateChanged(playHeadState);
+      });
+    });
+  }
+
+  // The playing segment is looked up natively, and only once playback leaves
+  // the highlighted one
+  handlePlayHeadStateChanged(playHeadState: { timeInSeconds: number, isPlaying: boolean }) {
+    const grid = this.transcriptGrid;
+    const position = playHeadState.timeInSeconds;
+
+    if (!grid || !playHeadState.isPlaying || grid.isActiveAt(position)) {
+      this.lookupID++;
+      grid?.setPlaybackPosition(position, playHeadState.isPlaying);
+      return Promise.resolve();
+    }
+
+    const lookupID = ++this.lookupID;
+    return this.native.lookupAtTime(position).then((result: { hits: TimelineHit[] } | { error: string }) => {
+      if (lookupID !== this.lookupID) {
+        return;
+      }
+
+      const hits = ('hits' in result ? result.hits : []).filter((hit) => hit.segment);
+      if (hits.some((hit) => grid.setActiveSegment(hit.persistentID, hit.segment.id))) {
+        return;
+      }
+
+      // The playing segment may be in a page not loaded yet
+      const loads = hits.map((hit) => this.loadTranscriptThrough(hit.persistentID, hit.segment.id));
+
+      return Promise.all(loads).then(() => {
+        if (lookupID !== this.lookupID) {
+          return;
+        }
+
+        const found = hits.some((hit) => grid.setActiveSegment(hit.persistentID, hit.segment.id));
+
+        // Rows without segment IDs can only be found by scanning
+        if (hits.length > 0 && !found) {
+          grid.setPlaybackPosition(position, true);
+        }
       });
     });
   }
 
+  handlePlaybackRegionsChanged(diff: PlaybackRegionsDiff) {
+    // A diff that doesn't follow the known version means one was missed
+    if (diff.baseVersion !== this.playbackRegionsVersion) {
+      return this.updatePlaybackRegions();
+    }
+
+    for (const id of diff.removed) {
+      this.playbackRegions.delete(id);
+    }
+    for (const region of [...diff.added, ...diff.moved]) {
+      this.playbackRegions.set(region.id, region);
+    }
+
+    this.playbackRegionsVersion = diff.version;
+    this.applyPlaybackRegions();
+    return Promise.resolve();
+  }
+
+  applyPlaybackRegions() {
+    const playbackRegionsByAudioSource =
+      this.groupPlaybackRegionsByAudioSource(this.playbackRegions.values());
+    this.transcriptGrid?.setPlaybackRegionMap(playbackRegionsByAudioSource);
+  }
+
   collectPlaybackRegionsByAudioSource(regionSequences: RegionSequence[]): Map<string, PlaybackRegion[]> {
+    return this.groupPlaybackRegionsByAudioSource(regionSequences.flatMap((rs) => rs.playbackRegions));
+  }
+
+  groupPlaybackRegionsByAudioSource(playbackRegions: Iterable<PlaybackRegion>): Map<string, PlaybackRegion[]> {
     const result = new Map<string, PlaybackRegion[]>();
-    for (const rs of regionSequences) {
-      for (const pr of rs.playbackRegions) {
-        const sourceID = pr.audioSourcePersistentID;
-        if (!result.has(sourceID)) {
-          result.set(sourceID, []);
-        }
-        result.get(sourceID).push(pr);
+    for (const pr of playbackRegions) {
+      const sourceID = pr.audioSourcePersistentID;
+      if (!result.has(sourceID)) {
+        result.set(sourceID, []);
       }
+      result.get(sourceID).push(pr);
     }
     return result;
   }
@@ -527,23 +807,108 @@ export default class App {
   }
 
   mergeTranscript(audioSource: AudioSource) {
-    return this.native.getAudioSourceTranscript(audioSource.persistentID).then((transcript) => {
-      if (transcript.error) {
-        console.warn('Error loading transcript for audio source:', audioSource.persistentID, transcript.error);
+    return this.loadTranscriptPage(audioSource, 0);
+  }
+
+  // Loads one page of a transcript into the grid. A first page replaces the
+  // rows loaded so far; a later one starts over if the transcript changed.
+  loadTranscriptPage(audioSource: AudioSource, offset: number, version?: number) {
+    const persistentID = audioSource.persistentID;
+    const query = { offset, limit: App.transcriptPageSize };
+
+    return this.native.getTranscriptSegments(persistentID, query).then((page) => {
+      if (page.error) {
+        console.warn('Error loading transcript for audio source:', persistentID, page.error);
+        return;
+      }
+
+      if (offset > 0 && page.version !== version) {
+        return this.loadTranscriptPage(audioSource, 0);
+      }
+
+      const pages = this.transcriptPages.get(persistentID);
+
+      // Reloaded meanwhile, so these rows are already there or on their way
+      if (offset > 0 && pages?.loaded !== offset) {
         return;
       }
 
-      this.transcriptGrid.removeRowsBySourceID(audioSource.persistentID);
+      if (offset === 0) {
+        this.transcriptVersions.set(persistentID, page.version);
+        this.transcriptGrid.removeRowsBySourceID(persistentID);
+      }
 
-      if (transcript.segments) {
+      if (page.segments.length > 0) {
         this.showTranscript();
-        this.transcriptGrid.addSegments(transcript.segments, audioSource);
+        this.transcriptGrid.addSegments(page.segments, audioSource, page.offset);
+      }
+
+      const loaded = page.offset + page.segments.length;
+      this.transcriptPages.set(persistentID, {
+        audioSource,
+        version: page.version,
+        loaded,
+        total: page.segments.length > 0 ? page.total : loaded,
+        lastSegmentID: page.segments.length > 0 ? page.segments[page.segments.length - 1].id : pages?.lastSegmentID,
+      });
+    });
+  }
+
+  // Loads the page after the last one loaded, unless it is already on its way
+  loadNextTranscriptPage(persistentID: string): Promise<void> {
+    const pages = this.transcriptPages.get(persistentID);
+    if (!pages || pages.loaded >= pages.total) {
+      return Promise.resolve();
+    }
+
+    if (!pages.pending) {
+      pages.pending = this.loadTranscriptPage(pages.audioSource, pages.loaded, pages.version).finally(() => {
+        pages.pending = undefined;
+      });
+    }
+
+    return pages.pending;
+  }
+
+  // Loads pages until the given segment is in the grid, or the transcript ends
+  loadTranscriptThrough(persistentID: string, segmentID: number): Promise<void> {
+    const pages = this.transcriptPages.get(persistentID);
+    if (!pages || pages.loaded >= pages.total || (pages.lastSegmentID ?? -1) >= segmentID) {
+      return Promise.resolve();
+    }
+
+    return this.loadNextTranscriptPage(persistentID).then(() => {
+      // Nothing more was loaded, e.g. after an error
+      if (this.transcriptPages.get(persistentID) === pages) {
+        return;
+      }
+      return this.loadTranscriptThrough(persistentID, segmentID);
+    });
+  }
+
+  loadAllTranscriptPages() {
+    const promises = Array.from(this.transcriptPages.keys()).map((persistentID) => {
+      return this.loadTranscriptThrough(persistentID, Infinity);
+    });
+    return Promise.all(promises).then(() => {});
+  }
+
+  hasUnloadedTranscriptPages() {
+    return Array.from(this.transcriptPages.values()).some((pages) => pages.loaded < pages.total);
+  }
+
+  reloadTranscript(persistentID: string) {
+    return this.native.getAudioSources().then((audioSources: AudioSource[]) => {
+      const audioSource = audioSources.find((audioSource) => audioSource.persistentID === persistentID);
+      if (audioSource) {
+        return this.mergeTranscript(audioSource);
       }
     });
   }
 
   clearTranscript() {
     this.transcriptGrid.clear();
+    this.transcriptPages.clear();
     return this.native.getAudioSources().then((audioSources: AudioSource[]) => {
       const promises = audioSources.map((audioSource) => {
         return this.native.setAudioSourceTranscript(audioSource.persistentID, {});
@@ -555,6 +920,7 @@ export default class App {
   clearSearch() {
     const searchInput = document.getElementById('search-input') as HTMLInputElement;
     searchInput.value = '';
+    this.searchID++;
     this.transcriptGrid.filter('');
   }
 
@@ -572,6 +938,69 @@ export default class App {
     });
   }
 
+  toggleLive() {
+    if (this.live) {
+      return this.native.stopLiveTranscription().then(() => {
+        this.setLive(false);
+      });
+    }
+
+    const asrOptions = {
+      modelName: this.state.modelName,
+      language: this.state.language,
+    };
+
+    return this.native.startLiveTranscription(asrOptions).then((result) => {
+      if (result && result.error) {
+        this.showAlert('danger', '<b>Error:</b> ' + htmlEscape(result.error));
+        return;
+      }
+      this.setLive(true);
+    });
+  }
+
+  setLive(live: boolean) {
+    this.live = live;
+
+    const liveButton = document.getElementById('live-button');
+    liveButton.classList.toggle('btn-danger', live);
+    liveButton.classList.toggle('btn-outline-secondary', !live);
+
+    const captions = document.getElementById('live-captions');
+    if (live) {
+      document.getElementById('live-captions-final').textContent = '';
+      document.getElementById('live-captions-partial').textContent = '';
+      captions.style.display = 'block';
+    } else {
+      captions.style.display = 'none';
+    }
+  }
+
+  toggleTracing() {
+    return this.native.setTracingEnabled(!this.tracing).then((result) => {
+      if (result.error) {
+        this.showAlert('danger', '<b>Error:</b> ' + htmlEscape(result.error));
+        return;
+      }
+      this.tracing = result.enabled;
+      if (this.tracing) {
+        this.showAlert('info', '<b>Tracing:</b> Recording started');
+      } else if (result.filePath) {
+        this.showAlert('success', '<b>Tracing:</b> Trace saved to ' + htmlEscape(result.filePath));
+      }
+    });
+  }
+
+  handleExport(format: string, options: { separateFiles?: boolean, timeBase?: string, alternate?: number } = {}) {
+    return this.native.exportTranscripts(format, options).then((result) => {
+      if (result.error) {
+        this.showAlert('danger', '<b>Error:</b> ' + htmlEscape(result.error));
+      } else if (result.filePaths && result.filePaths.length > 0) {
+        this.showAlert('success', '<b>Success:</b> File saved to ' + result.filePaths.map(htmlEscape).join(', '));
+      }
+    });
+  }
+
   saveAs(content: string, _mimeType: string, filename: string) {
     const title = "Save As";
     const extension = filename.split('.').pop();
@@ -3,19 +3,29 @@ import * as Juce from "juce-framework-frontend";
 export default class Native {
   abortTranscription = Juce.getNativeFunction("abortTranscription");
   canCreateMarkers = Juce.getNativeFunction("canCreateMarkers");
+  cancelMarkerCreation = Juce.getNativeFunction("cancelMarkerCreation");
   createMarkers = Juce.getNativeFunction("createMarkers");
+  exportTranscripts = Juce.getNativeFunction("exportTranscripts");
   getAudioSources = Juce.getNativeFunction("getAudioSources");
   getAudioSourceTranscript = Juce.getNativeFunction("getAudioSourceTranscript");
   getModels = Juce.getNativeFunction("getModels");
+  getPlaybackRegions = Juce.getNativeFunction("getPlaybackRegions");
   getPlayHeadState = Juce.getNativeFunction("getPlayHeadState");
   getRegionSequences = Juce.getNativeFunction("getRegionSequences");
+  getTranscriptSegments = Juce.getNativeFunction("getTranscriptSegments");
   getTranscriptionStatus = Juce.getNativeFunction("getTranscriptionStatus");
   getWhisperLanguages = Juce.getNativeFunction("getWhisperLanguages");
+  lookupAtTime = Juce.getNativeFunction("lookupAtTime");
   play = Juce.getNativeFunction("play");
   stop = Juce.getNativeFunction("stop");
   saveFile = Juce.getNativeFunction("saveFile");
+  searchTranscripts = Juce.getNativeFunction("searchTranscripts");
   setAudioSourceTranscript = Juce.getNativeFunction("setAudioSourceTranscript");
   setPlaybackPosition = Juce.getNativeFunction("setPlaybackPosition");
+  setTracingEnabled = Juce.getNativeFunction("setTracingEnabled");
   setWebState = Juce.getNativeFunction("setWebState");
+  startLiveTranscription = Juce.getNativeFunction("startLiveTranscription");
+  stopLiveTranscription = Juce.getNativeFunction("stopLiveTranscription");
   transcribeAudioSource = Juce.getNativeFunction("transcribeAudioSource");
+  updateTranscriptSegments = Juce.getNativeFunction("updateTranscriptSegments");
 }
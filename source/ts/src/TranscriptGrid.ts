@@ -1,21 +1,24 @@
 import * as GridConfig from './GridConfig';
 import { AudioSource, PlaybackRegion } from './ARA';
-import { Segment } from './ASR';
+import { Segment, SegmentOperation } from './ASR';
 import { downloadFile, htmlEscape, timestampToString, timestampToStringSRT } from './Utils';
 
 import {
   CellClickedEvent,
+  CellValueChangedEvent,
   ColDef,
   CsvExportParams,
   GridApi,
   GridOptions,
   ICellRendererParams,
   ProcessCellForExportParams,
+  ViewportChangedEvent,
   createGrid,
 } from "ag-grid-community";
 
-interface TranscriptRow extends Segment {
+export interface TranscriptRow extends Segment {
   id: string;
+  segmentID?: number;
   playbackStart?: number;
   playbackEnd?: number;
   source: string;
@@ -23,25 +26,52 @@ interface TranscriptRow extends Segment {
 }
 
 export default class TranscriptGrid {
+  // Rows past the viewport at which the next page of a transcript is requested
+  static readonly rowsNeededMargin = 50;
+
   private gridElement: HTMLElement;
   private gridApi: GridApi;
   private onPlayAt: (seconds: number) => void;
+  private onTextEdited: (row: TranscriptRow) => void;
+  private onRowsNeeded: (sourceID: string) => void;
   private rowData: TranscriptRow[] = [];
-
-  constructor(selector: string, onPlayAt: (seconds: number) => void) {
+  // Last loaded row of each source, where its next page goes
+  private lastRowBySourceID: Map<string, TranscriptRow> = new Map();
+  private playbackRegionsBySourceID?: Map<string, PlaybackRegion[]>;
+  private matchingRowIDs?: Set<string>;
+  private activeRow?: TranscriptRow;
+
+  constructor(
+    selector: string,
+    onPlayAt: (seconds: number) => void,
+    onTextEdited?: (row: TranscriptRow) => void,
+    onRowsNeeded?: (sourceID: string) => void
+  ) {
     this.onPlayAt = onPlayAt;
+    this.onTextEdited = onTextEdited;
+    this.onRowsNeeded = onRowsNeeded;
     this.gridElement = document.querySelector(selector) as HTMLElement;
     this.gridApi = createGrid(this.gridElement, this.getGridOptions());
   }
 
-  addRows(rows: TranscriptRow[]) {
-    this.gridApi.applyTransaction({ add: rows });
-    this.rowData.push(...rows);
+  addRows(rows: TranscriptRow[], addIndex?: number) {
+    if (addIndex === undefined || addIndex >= this.rowData.length) {
+      this.gridApi.applyTransaction({ add: rows });
+      this.rowData.push(...rows);
+    } else {
+      this.gridApi.applyTransaction({ add: rows, addIndex });
+      this.rowData.splice(addIndex, 0, ...rows);
+    }
+
+    for (const row of rows) {
+      this.lastRowBySourceID.set(row.sourceID, row);
+    }
   }
 
-  addSegments(segments: Segment[], audioSource: AudioSource) {
-    const rows: TranscriptRow[] = segments.map((segment, index) => ({
-      id: audioSource.persistentID + '-' + index,
+  addSegments(segments: Segment[], audioSource: AudioSource, offset = 0) {
+    const rows: TranscriptRow[] = segments.map((segment, index) => this.mapToPlayback({
+      id: audioSource.persistentID + '-' + (segment.id ?? offset + index),
+      segmentID: segment.id,
       start: segment.start,
       end: segment.end,
       playbackStart: segment.start,
@@ -52,10 +82,66 @@ export default class TranscriptGrid {
       sourceID: audioSource.persistentID,
     }));
 
-    this.addRows(rows);
+    // Later pages of a transcript go right after its loaded rows
+    const lastRow = this.lastRowBySourceID.get(audioSource.persistentID);
+    this.addRows(rows, lastRow ? this.rowData.indexOf(lastRow) + 1 : undefined);
+  }
+
+  // Applies segment edits for one source, touching only the affected rows
+  applySegmentOperations(sourceID: string, operations: SegmentOperation[]) {
+    const updatedRows: TranscriptRow[] = [];
+    const removedRows: TranscriptRow[] = [];
+
+    for (const operation of operations) {
+      const node = this.gridApi.getRowNode(sourceID + '-' + operation.id);
+      if (!node) {
+        continue;
+      }
+
+      const row = node.data as TranscriptRow;
+      if (operation.op === 'delete') {
+        removedRows.push(row);
+        continue;
+      }
+
+      if (operation.text !== undefined) {
+        row.text = operation.text;
+      }
+      if (operation.start !== undefined || operation.end !== undefined) {
+        row.start = row.playbackStart = operation.start ?? row.start;
+        row.end = row.playbackEnd = operation.end ?? row.end;
+        this.mapToPlayback(row);
+      }
+      updatedRows.push(row);
+    }
+
+    if (removedRows.length > 0) {
+      const removedIDs = new Set(removedRows.map(row => row.id));
+      this.rowData = this.rowData.filter(row => !removedIDs.has(row.id));
+
+      if (removedIDs.has(this.lastRowBySourceID.get(sourceID)?.id)) {
+        this.lastRowBySourceID.delete(sourceID);
+        for (let i = this.rowData.length - 1; i >= 0; i--) {
+          if (this.rowData[i].sourceID === sourceID) {
+            this.lastRowBySourceID.set(sourceID, this.rowData[i]);
+            break;
+          }
+        }
+      }
+    }
+
+    if (updatedRows.length > 0 || removedRows.length > 0) {
+      this.gridApi.applyTransaction({ update: updatedRows, remove: removedRows });
+    }
   }
 
   removeRowsBySourceID(sourceID: string) {
+    if (this.activeRow?.sourceID === sourceID) {
+      this.activeRow = undefined;
+    }
+
+    this.lastRowBySourceID.delete(sourceID);
+
     const rowsToRemove = this.rowData.filter(row => row.sourceID === sourceID);
     if (rowsToRemove.length > 0) {
       this.gridApi.applyTransaction({ remove: rowsToRemove });
@@ -64,6 +150,8 @@ export default class TranscriptGrid {
   }
 
   clear() {
+    this.activeRow = undefined;
+    this.lastRowBySourceID.clear();
     this.gridApi.applyTransaction({ remove: this.rowData });
     this.rowData.length = 0;
   }
@@ -98,8 +186,11 @@ export default class TranscriptGrid {
     return `${index + 1}\n${start} --> ${end}\n${row.text}\n`;
   }
 
-  filter(text: string) {
-    this.gridApi.setGridOption('quickFilterText', text);
+  // Filters rows by text, or to the given rows once native search results are in
+  filter(text: string, matchingRowIDs?: Set<string>) {
+    this.matchingRowIDs = matchingRowIDs;
+    this.gridApi.setGridOption('quickFilterText', matchingRowIDs ? '' : text);
+    this.gridApi.onFilterChanged();
   }
 
   findPlayableRange(playbackRegions: PlaybackRegion[], segmentStart: number, segmentEnd: number) {
@@ -142,6 +233,7 @@ export default class TranscriptGrid {
         field: 'text',
         headerName: 'Text',
         filter: true,
+        editable: (params) => params.data.segmentID !== undefined,
         cellRenderer: this.renderText.bind(this),
         flex: 1
       },
@@ -165,12 +257,16 @@ export default class TranscriptGrid {
       columnDefs: this.getColumnDefs(),
       getRowId: this.getRowId,
       onCellClicked: this.handleCellClicked.bind(this),
+      onCellValueChanged: this.handleCellValueChanged.bind(this),
+      onViewportChanged: this.handleViewportChanged.bind(this),
       rowData: this.rowData,
       rowHeight: 32,
       rowSelection: { mode: 'singleRow', checkboxes: false },
       suppressCellFocus: true,
       theme: GridConfig.getTheme(),
       getRowStyle: GridConfig.stripedRowStyle,
+      isExternalFilterPresent: () => this.matchingRowIDs !== undefined,
+      doesExternalFilterPass: (node) => this.matchingRowIDs?.has(node.data.id) ?? true,
     };
   }
 
@@ -191,6 +287,28 @@ export default class TranscriptGrid {
     }
   }
 
+  handleCellValueChanged(params: CellValueChangedEvent<TranscriptRow>) {
+    if (params.column.getColId() === 'text' && params.newValue !== params.oldValue && this.onTextEdited) {
+      this.onTextEdited(params.data);
+    }
+  }
+
+  // Asks for the next page of each transcript whose last loaded row is shown,
+  // or is about to be, so pages are only fetched once scrolled to
+  handleViewportChanged(event: ViewportChangedEvent<TranscriptRow>) {
+    if (!this.onRowsNeeded || event.lastRow < 0) {
+      return;
+    }
+
+    const lastNeededRow = event.lastRow + TranscriptGrid.rowsNeededMargin;
+    for (const [sourceID, row] of this.lastRowBySourceID) {
+      const rowIndex = this.gridApi.getRowNode(row.id)?.rowIndex;
+      if (rowIndex !== undefined && rowIndex !== null && rowIndex <= lastNeededRow) {
+        this.onRowsNeeded(sourceID);
+      }
+    }
+  }
+
   renderStartTime(params: ICellRendererParams) {
     const linkClasses = 'link-offset-2 link-underline link-underline-opacity-0 link-underline-opacity-50-hover small';
     const time = params.value;
@@ -238,10 +356,15 @@ export default class TranscriptGrid {
   setPlaybackPosition(position: number, isPlaying: boolean) {
     // Don't select a row if not playing
     if (!isPlaying) {
+      this.activeRow = undefined;
       this.gridApi.deselectAll();
       return;
     }
 
+    if (this.isActiveAt(position)) {
+      return;
+    }
+
     // Find the row that contains the current playback time
     const activeRow = this.rowData.find(row =>
       row.playbackStart !== null &&
@@ -251,36 +374,51 @@ export default class TranscriptGrid {
     );
 
     if (activeRow) {
-      const node = this.gridApi.getRowNode(activeRow.id);
-      if (node && !node.isSelected()) {
-        this.gridApi.deselectAll();
-        node.setSelected(true);
-        this.gridApi.ensureNodeVisible(node);
-      }
+      this.selectActiveRow(activeRow.id);
     }
   }
 
-  setPlaybackRegionMap(playbackRegionsBySourceID: Map<string, PlaybackRegion[]>) {
-    const updatedRows = this.rowData.map(row => {
-      const playbackRegions = playbackRegionsBySourceID.get(row.sourceID);
+  // Whether the highlighted row still contains the playback position
+  isActiveAt(position: number): boolean {
+    const row = this.activeRow;
+    return row !== undefined &&
+      row.playbackStart !== null &&
+      row.playbackEnd !== null &&
+      position >= row.playbackStart &&
+      position <= row.playbackEnd;
+  }
+
+  // Highlights a segment found by a native lookup. Returns false if there is
+  // no row for it.
+  setActiveSegment(sourceID: string, segmentID: number): boolean {
+    return this.selectActiveRow(sourceID + '-' + segmentID);
+  }
 
-      if (playbackRegions) {
-        const range = this.findPlayableRange(playbackRegions, row.start, row.end);
-        const newStart = range?.start ?? null;
-        const newEnd = range?.end ?? null;
+  private selectActiveRow(rowID: string): boolean {
+    const node = this.gridApi.getRowNode(rowID);
+    if (!node) {
+      return false;
+    }
 
-        if (row.playbackStart !== newStart || row.playbackEnd !== newEnd) {
-          row.playbackStart = newStart;
-          row.playbackEnd = newEnd;
-          return row;
-        }
-      } else if (row.playbackStart !== null || row.playbackEnd !== null) {
-        row.playbackStart = null;
-        row.playbackEnd = null;
-        return row;
-      }
+    this.activeRow = node.data;
+    if (!node.isSelected()) {
+      this.gridApi.deselectAll();
+      node.setSelected(true);
+      this.gridApi.ensureNodeVisible(node);
+    }
+    return true;
+  }
 
-      return null;
+  // Rows added later are mapped with the most recent regions
+  setPlaybackRegionMap(playbackRegionsBySourceID: Map<string, PlaybackRegion[]>) {
+    this.playbackRegionsBySourceID = playbackRegionsBySourceID;
+
+    const updatedRows = this.rowData.map(row => {
+      const playbackStart = row.playbackStart;
+      const playbackEnd = row.playbackEnd;
+
+      this.mapToPlayback(row);
+      return row.playbackStart !== playbackStart || row.playbackEnd !== playbackEnd ? row : null;
     }).filter(row => row !== null);
 
     if (updatedRows.length > 0) {
@@ -288,6 +426,18 @@ export default class TranscriptGrid {
     }
   }
 
+  private mapToPlayback(row: TranscriptRow): TranscriptRow {
+    if (!this.playbackRegionsBySourceID) {
+      return row;
+    }
+
+    const playbackRegions = this.playbackRegionsBySourceID.get(row.sourceID);
+    const range = playbackRegions ? this.findPlayableRange(playbackRegions, row.start, row.end) : null;
+    row.playbackStart = range?.start ?? null;
+    row.playbackEnd = range?.end ?? null;
+    return row;
+  }
+
   updateRows(rows: TranscriptRow[]) {
     this.gridApi.applyTransaction({ update: rows });
   }
@@ -40,6 +40,7 @@ describe('App', () => {
       expect(app.state.modelName).toBe('small');
       expect(app.state.language).toBe('');
       expect(app.state.translate).toBe(false);
+      expect(app.state.bilingual).toBe(false);
       expect(app.state.vad).toBe(false);
     });
 
@@ -86,7 +87,8 @@ describe('App', () => {
     it('initializes transcript grid correctly', async () => {
       const app = new App();
 
-      mockNative.getAudioSourceTranscript.mockResolvedValue({
+      mockNative.getTranscriptSegments.mockResolvedValue({
+        version: 1, total: 1, offset: 0,
         segments: [{ text: 'test', start: 0, end: 1 }]
       });
 
@@ -274,6 +276,21 @@ describe('App', () => {
       mockSaveState.mockRestore();
     });
 
+    it('handles bilingual checkbox change', async () => {
+      const app = new App();
+      const mockSaveState = jest.spyOn(app, 'saveState').mockImplementation(() => Promise.resolve());
+
+      const checkbox = document.getElementById('bilingual-checkbox') as HTMLInputElement;
+      checkbox.checked = true;
+
+      await app.handleBilingualChange();
+
+      expect(app.state.bilingual).toBe(true);
+      expect(mockSaveState).toHaveBeenCalled();
+
+      mockSaveState.mockRestore();
+    });
+
     it('handles vad checkbox change', async () => {
       const app = new App();
       const mockSaveState = jest.spyOn(app, 'saveState').mockImplementation(() => Promise.resolve());
@@ -352,9 +369,10 @@ describe('App', () => {
         setSelectedRowIds: jest.fn(),
       };
 
-      mockNative.getAudioSourceTranscript
-        .mockResolvedValueOnce({})
+      mockNative.getTranscriptSegments
+        .mockResolvedValueOnce({ version: 0, total: 0, offset: 0, segments: [] })
         .mockResolvedValueOnce({
+          version: 1, total: 1, offset: 0,
           segments: [{ text: 'test', start: 0, end: 1 }]
         });
 
@@ -459,35 +477,36 @@ describe('App', () => {
 
       app.transcriptGrid = {
         setPlaybackRegionMap: jest.fn(),
-        setPlaybackPosition: jest.fn()
+        setPlaybackPosition: jest.fn(),
+        isActiveAt: jest.fn().mockReturnValue(false),
+        setActiveSegment: jest.fn().mockReturnValue(true)
       } as unknown as TranscriptGrid;
 
-      const mockRegionSequences = [
-        {
-          name: 'Track 1',
-          orderIndex: 0,
-          playbackRegions: [
-            {
-              playbackStart: 0,
-              playbackEnd: 1,
-              modificationStart: 0,
-              modificationEnd: 1,
-              audioSourcePersistentID: 'audio1'
-            }
-          ]
-        }
-      ];
+      const mockPlaybackRegions = {
+        version: 3,
+        regions: [
+          {
+            id: 1,
+            playbackStart: 0,
+            playbackEnd: 1,
+            modificationStart: 0,
+            modificationEnd: 1,
+            audioSourcePersistentID: 'audio1'
+          }
+        ]
+      };
 
-      mockNative.getRegionSequences.mockResolvedValue(mockRegionSequences);
+      mockNative.getPlaybackRegions.mockResolvedValue(mockPlaybackRegions);
       mockNative.getPlayHeadState.mockResolvedValue({ timeInSeconds: 0.5, isPlaying: true });
 
       await app.updatePlaybackRegions();
 
-      expect(mockNative.getRegionSequences).toHaveBeenCalled();
+      expect(mockNative.getPlaybackRegions).toHaveBeenCalled();
       expect(mockNative.getPlayHeadState).toHaveBeenCalled();
+      expect(app.playbackRegionsVersion).toBe(3);
 
       expect(app.transcriptGrid.setPlaybackRegionMap).toHaveBeenCalled();
-      expect(app.transcriptGrid.setPlaybackPosition).toHaveBeenCalledWith(0.5, true);
+      expect(mockNative.lookupAtTime).toHaveBeenCalledWith(0.5);
     });
 
     it('integrates update method correctly', async () => {
@@ -500,14 +519,113 @@ describe('App', () => {
 
       await app.update();
 
+      // Playback state is pushed by native events rather than polled
       expect(mockUpdateTranscriptionStatus).toHaveBeenCalled();
-      expect(mockUpdatePlaybackRegions).toHaveBeenCalled();
+      expect(mockUpdatePlaybackRegions).not.toHaveBeenCalled();
 
       mockUpdateTranscriptionStatus.mockRestore();
       mockUpdatePlaybackRegions.mockRestore();
     });
   });
 
+  describe('playback events', () => {
+    it('highlights the playing segment found by a native lookup', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        setPlaybackPosition: jest.fn(),
+        isActiveAt: jest.fn().mockReturnValue(false),
+        setActiveSegment: jest.fn().mockReturnValue(true)
+      } as unknown as TranscriptGrid;
+
+      mockNative.lookupAtTime.mockResolvedValue({
+        hits: [
+          { regionID: 1, persistentID: 'audio1', sourceTime: 1.5, segment: { id: 7, start: 1, end: 2, text: 'Hello' } }
+        ]
+      });
+
+      await app.handlePlayHeadStateChanged({ timeInSeconds: 2.5, isPlaying: true });
+
+      expect(mockNative.lookupAtTime).toHaveBeenCalledWith(2.5);
+      expect(app.transcriptGrid.setActiveSegment).toHaveBeenCalledWith('audio1', 7);
+      expect(app.transcriptGrid.setPlaybackPosition).not.toHaveBeenCalled();
+    });
+
+    it('skips the lookup while the highlighted segment is still playing', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        setPlaybackPosition: jest.fn(),
+        isActiveAt: jest.fn().mockReturnValue(true),
+        setActiveSegment: jest.fn()
+      } as unknown as TranscriptGrid;
+
+      await app.handlePlayHeadStateChanged({ timeInSeconds: 2.5, isPlaying: true });
+
+      expect(mockNative.lookupAtTime).not.toHaveBeenCalled();
+      expect(app.transcriptGrid.setPlaybackPosition).toHaveBeenCalledWith(2.5, true);
+    });
+
+    it('clears the highlight when playback stops', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        setPlaybackPosition: jest.fn(),
+        isActiveAt: jest.fn().mockReturnValue(false)
+      } as unknown as TranscriptGrid;
+
+      await app.handlePlayHeadStateChanged({ timeInSeconds: 2.5, isPlaying: false });
+
+      expect(mockNative.lookupAtTime).not.toHaveBeenCalled();
+      expect(app.transcriptGrid.setPlaybackPosition).toHaveBeenCalledWith(2.5, false);
+    });
+
+    it('applies playback region diffs that follow the known version', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        setPlaybackRegionMap: jest.fn()
+      } as unknown as TranscriptGrid;
+
+      const makeRegion = (id: number, playbackStart: number) => ({
+        id,
+        playbackStart,
+        playbackEnd: playbackStart + 1,
+        modificationStart: 0,
+        modificationEnd: 1,
+        audioSourcePersistentID: 'audio1'
+      });
+
+      app.playbackRegions = new Map([[1, makeRegion(1, 0)], [2, makeRegion(2, 5)]]);
+      app.playbackRegionsVersion = 4;
+
+      const moved = makeRegion(1, 10);
+      const added = makeRegion(3, 20);
+      await app.handlePlaybackRegionsChanged({ baseVersion: 4, version: 5, added: [added], moved: [moved], removed: [2] });
+
+      expect(mockNative.getPlaybackRegions).not.toHaveBeenCalled();
+      expect(app.playbackRegionsVersion).toBe(5);
+      expect(app.transcriptGrid.setPlaybackRegionMap).toHaveBeenCalledWith(new Map([['audio1', [moved, added]]]));
+    });
+
+    it('reloads playback regions when a diff skips a version', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        setPlaybackRegionMap: jest.fn(),
+        setPlaybackPosition: jest.fn()
+      } as unknown as TranscriptGrid;
+
+      app.playbackRegionsVersion = 2;
+      mockNative.getPlaybackRegions.mockResolvedValue({ version: 6, regions: [] });
+
+      await app.handlePlaybackRegionsChanged({ baseVersion: 5, version: 6, added: [], moved: [], removed: [] });
+
+      expect(mockNative.getPlaybackRegions).toHaveBeenCalled();
+      expect(app.playbackRegionsVersion).toBe(6);
+    });
+  });
+
   describe('transcription', () => {
     it('handles process button click', async () => {
       const app = new App();
@@ -529,14 +647,54 @@ describe('App', () => {
         audioSource2
       ]);
 
-      const segments = [{ text: 'test', start: 0, end: 1 }];
+      mockNative.transcribeAudioSource.mockResolvedValue({ aborted: false, numSegments: 1 });
+
+      await app.handleProcess();
+
+      expect(mockNative.transcribeAudioSource).toHaveBeenCalledWith('audio1', expect.any(Object));
+      expect(mockNative.transcribeAudioSource).toHaveBeenCalledWith('audio2', expect.any(Object));
+      expect(mockNative.setAudioSourceTranscript).not.toHaveBeenCalled();
+      expect(app.processing).toBe(false);
+    });
+
+    it('requests a translation alongside the transcript when bilingual', async () => {
+      const app = new App();
+
+      (app as any).audioSourceGrid = {
+        getSelectedRowIds: jest.fn().mockReturnValue(['audio1']),
+      };
+
+      mockNative.getAudioSources.mockResolvedValue([{ persistentID: 'audio1', name: 'Audio 1' }]);
+      mockNative.transcribeAudioSource.mockResolvedValue({ aborted: false, numSegments: 1, numAlternates: 1 });
 
-      mockNative.transcribeAudioSource.mockResolvedValue({ segments });
+      (document.getElementById('bilingual-checkbox') as HTMLInputElement).checked = true;
 
       await app.handleProcess();
 
-      expect(mockNative.setAudioSourceTranscript).toHaveBeenCalledWith('audio1', { segments });
-      expect(mockNative.setAudioSourceTranscript).toHaveBeenCalledWith('audio2', { segments });
+      expect(mockNative.transcribeAudioSource).toHaveBeenCalledWith('audio1', expect.objectContaining({
+        language: '',
+        translate: false,
+        alternates: [{ language: '', translate: true }]
+      }));
+    });
+
+    it('does not request alternates when already translating', async () => {
+      const app = new App();
+
+      (app as any).audioSourceGrid = {
+        getSelectedRowIds: jest.fn().mockReturnValue(['audio1']),
+      };
+
+      mockNative.getAudioSources.mockResolvedValue([{ persistentID: 'audio1', name: 'Audio 1' }]);
+
+      (document.getElementById('bilingual-checkbox') as HTMLInputElement).checked = true;
+      (document.getElementById('translate-checkbox') as HTMLInputElement).checked = true;
+
+      await app.handleProcess();
+
+      const options = mockNative.transcribeAudioSource.mock.calls[0][1] as any;
+      expect(options.translate).toBe(true);
+      expect(options.alternates).toBeUndefined();
     });
 
     it('handles process errors', async () => {
@@ -703,6 +861,83 @@ describe('App', () => {
       expect(alerts.innerHTML).toContain(error);
     });
 
+    it('shows marker creation progress and reports skipped duplicates', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        getRows: jest.fn().mockReturnValue([
+          { playbackStart: 0, playbackEnd: 1, text: 'Test 1' },
+          { playbackStart: 2, playbackEnd: 3, text: 'Test 2' }
+        ])
+      };
+
+      let resolveCreate: (result: any) => void;
+      mockNative.createMarkers.mockReturnValue(new Promise((resolve) => { resolveCreate = resolve; }));
+
+      const done = app.handleCreateMarkers('regions');
+
+      const progress = document.getElementById('create-progress') as HTMLElement;
+      expect(progress.style.display).toBe('block');
+
+      app.handleMarkerCreationProgress({ done: 1, total: 2 });
+      expect(document.getElementById('create-progress-text').textContent).toBe('Creating 1 / 2');
+
+      resolveCreate({ created: 1, skipped: 1, cancelled: false });
+      await done;
+
+      expect(progress.style.display).toBe('none');
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('Skipped 1 regions');
+    });
+
+    it('cancels marker creation', () => {
+      const app = new App();
+      app.initCreateButton();
+
+      (document.getElementById('create-cancel') as HTMLElement).click();
+
+      expect(mockNative.cancelMarkerCreation).toHaveBeenCalled();
+    });
+
+    it('exports transcripts natively', async () => {
+      const app = new App();
+      app.initExportButton();
+
+      const handleExport = jest.spyOn(app, 'handleExport');
+      (document.getElementById('export-vtt') as HTMLElement).click();
+      expect(handleExport).toHaveBeenCalledWith('vtt');
+
+      mockNative.exportTranscripts.mockResolvedValue({ filePaths: ['/tmp/transcript.vtt'], numSegments: 2 });
+      await app.handleExport('vtt');
+
+      expect(mockNative.exportTranscripts).toHaveBeenCalledWith('vtt', {});
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('/tmp/transcript.vtt');
+    });
+
+    it('exports translations from the first alternate transcript', async () => {
+      const app = new App();
+      app.initExportButton();
+
+      const handleExport = jest.spyOn(app, 'handleExport');
+      (document.getElementById('export-srt-translation') as HTMLElement).click();
+      expect(handleExport).toHaveBeenCalledWith('srt', { alternate: 0 });
+
+      (document.getElementById('export-vtt-translation') as HTMLElement).click();
+      expect(handleExport).toHaveBeenCalledWith('vtt', { alternate: 0 });
+      expect(mockNative.exportTranscripts).toHaveBeenCalledWith('vtt', { alternate: 0 });
+    });
+
+    it('handles errors exporting transcripts', async () => {
+      const app = new App();
+      mockNative.exportTranscripts.mockResolvedValue({ error: 'Failed to write transcript.srt' });
+
+      await app.handleExport('srt');
+
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('Failed to write transcript.srt');
+    });
+
     it('plays at a given time', async () => {
       const app = new App();
       const seconds = 10;
@@ -715,6 +950,306 @@ describe('App', () => {
     });
   });
 
+  describe('tracing', () => {
+    it('starts tracing', async () => {
+      const app = new App();
+      mockNative.setTracingEnabled.mockResolvedValue({ enabled: true, filePath: '' });
+
+      await app.toggleTracing();
+
+      expect(mockNative.setTracingEnabled).toHaveBeenCalledWith(true);
+      expect(app.tracing).toBe(true);
+
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('Recording started');
+    });
+
+    it('stops tracing and reports the trace file', async () => {
+      const app = new App();
+      app.tracing = true;
+      mockNative.setTracingEnabled.mockResolvedValue({ enabled: false, filePath: '/tmp/trace.json' });
+
+      await app.toggleTracing();
+
+      expect(mockNative.setTracingEnabled).toHaveBeenCalledWith(false);
+      expect(app.tracing).toBe(false);
+
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('/tmp/trace.json');
+    });
+
+    it('handles tracing errors', async () => {
+      const app = new App();
+      mockNative.setTracingEnabled.mockResolvedValue({ error: 'Failed to save trace' });
+
+      await app.toggleTracing();
+
+      expect(app.tracing).toBe(false);
+
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('Failed to save trace');
+    });
+  });
+
+  describe('live captions', () => {
+    it('starts live transcription with the current model and language', async () => {
+      const app = new App();
+      app.state.modelName = 'medium';
+      app.state.language = 'en';
+
+      await app.toggleLive();
+
+      expect(mockNative.startLiveTranscription).toHaveBeenCalledWith({ modelName: 'medium', language: 'en' });
+      expect(app.live).toBe(true);
+      expect(document.getElementById('live-captions').style.display).toBe('block');
+    });
+
+    it('stops live transcription', async () => {
+      const app = new App();
+      app.setLive(true);
+
+      await app.toggleLive();
+
+      expect(mockNative.stopLiveTranscription).toHaveBeenCalled();
+      expect(app.live).toBe(false);
+      expect(document.getElementById('live-captions').style.display).toBe('none');
+    });
+
+    it('shows partial and final hypotheses', () => {
+      const app = new App();
+      app.setLive(true);
+
+      app.handleLiveTranscript({ type: 'partial', text: 'hello' });
+      expect(document.getElementById('live-captions-partial').textContent).toBe('hello');
+
+      app.handleLiveTranscript({ type: 'final', text: 'hello world' });
+      expect(document.getElementById('live-captions-partial').textContent).toBe('');
+      expect(document.getElementById('live-captions-final').textContent).toBe('hello world');
+    });
+
+    it('keeps only the most recent final lines', () => {
+      const app = new App();
+      app.setLive(true);
+
+      for (let i = 0; i < App.maxLiveCaptionLines + 2; i++) {
+        app.handleLiveTranscript({ type: 'final', text: 'line ' + i });
+      }
+
+      const finalLines = document.getElementById('live-captions-final');
+      expect(finalLines.childElementCount).toBe(App.maxLiveCaptionLines);
+      expect(finalLines.lastElementChild.textContent).toBe('line ' + (App.maxLiveCaptionLines + 1));
+    });
+
+    it('stops on live transcription errors', () => {
+      const app = new App();
+      app.setLive(true);
+
+      app.handleLiveTranscript({ type: 'error', error: 'Failed to load model' });
+
+      expect(app.live).toBe(false);
+      const alerts = document.getElementById('alerts') as HTMLElement;
+      expect(alerts.innerHTML).toContain('Failed to load model');
+    });
+  });
+
+  describe('transcript loading', () => {
+    it('loads only the first page until more is asked for', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        addSegments: jest.fn(),
+        removeRowsBySourceID: jest.fn(),
+      };
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      const first = { id: 0, text: 'first', start: 0, end: 1, score: 1 };
+      const second = { id: 1, text: 'second', start: 1, end: 2, score: 1 };
+
+      mockNative.getTranscriptSegments
+        .mockResolvedValueOnce({ version: 2, total: 2, offset: 0, segments: [first] })
+        .mockResolvedValueOnce({ version: 2, total: 2, offset: 1, segments: [second] });
+
+      await app.mergeTranscript(audioSource);
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledTimes(1);
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledWith('audio1', { offset: 0, limit: App.transcriptPageSize });
+      expect(app.transcriptGrid.addSegments).toHaveBeenCalledWith([first], audioSource, 0);
+
+      await app.loadNextTranscriptPage('audio1');
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenNthCalledWith(2, 'audio1', { offset: 1, limit: App.transcriptPageSize });
+      expect(app.transcriptGrid.addSegments).toHaveBeenCalledWith([second], audioSource, 1);
+      expect(app.transcriptGrid.removeRowsBySourceID).toHaveBeenCalledTimes(1);
+      expect(app.transcriptVersions.get('audio1')).toBe(2);
+
+      // Nothing is left to load
+      await app.loadNextTranscriptPage('audio1');
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledTimes(2);
+      expect(app.hasUnloadedTranscriptPages()).toBe(false);
+    });
+
+    it('asks for each page once while it is loading', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        addSegments: jest.fn(),
+        removeRowsBySourceID: jest.fn(),
+      };
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      app.transcriptPages.set('audio1', { audioSource, version: 2, loaded: 1, total: 3, lastSegmentID: 0 });
+
+      mockNative.getTranscriptSegments.mockResolvedValueOnce({
+        version: 2, total: 3, offset: 1, segments: [{ id: 1, text: 'test', start: 1, end: 2, score: 1 }]
+      });
+
+      await Promise.all([app.loadNextTranscriptPage('audio1'), app.loadNextTranscriptPage('audio1')]);
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledTimes(1);
+      expect(app.transcriptPages.get('audio1').loaded).toBe(2);
+    });
+
+    it('starts over if the transcript changes while loading', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        addSegments: jest.fn(),
+        removeRowsBySourceID: jest.fn(),
+      };
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      const segment = { id: 0, text: 'test', start: 0, end: 1, score: 1 };
+
+      mockNative.getTranscriptSegments
+        .mockResolvedValueOnce({ version: 2, total: 2, offset: 0, segments: [segment] })
+        .mockResolvedValueOnce({ version: 3, total: 1, offset: 1, segments: [] })
+        .mockResolvedValueOnce({ version: 3, total: 1, offset: 0, segments: [segment] });
+
+      await app.mergeTranscript(audioSource);
+      await app.loadNextTranscriptPage('audio1');
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledTimes(3);
+      expect(app.transcriptGrid.removeRowsBySourceID).toHaveBeenCalledTimes(2);
+      expect(app.transcriptVersions.get('audio1')).toBe(3);
+    });
+
+    it('loads the pages up to a segment found by a playhead lookup', async () => {
+      const app = new App();
+
+      app.transcriptGrid = {
+        addSegments: jest.fn(),
+        removeRowsBySourceID: jest.fn(),
+        setPlaybackPosition: jest.fn(),
+        isActiveAt: jest.fn().mockReturnValue(false),
+        setActiveSegment: jest.fn().mockReturnValueOnce(false).mockReturnValueOnce(true),
+      } as unknown as TranscriptGrid;
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      app.transcriptPages.set('audio1', { audioSource, version: 2, loaded: 1, total: 3, lastSegmentID: 0 });
+
+      const segments = [
+        { id: 1, text: 'one', start: 1, end: 2, score: 1 },
+        { id: 2, text: 'two', start: 2, end: 3, score: 1 },
+      ];
+      mockNative.getTranscriptSegments.mockResolvedValueOnce({ version: 2, total: 3, offset: 1, segments });
+      mockNative.lookupAtTime.mockResolvedValue({
+        hits: [{ regionID: 1, persistentID: 'audio1', sourceTime: 2.5, segment: segments[1] }]
+      });
+
+      await app.handlePlayHeadStateChanged({ timeInSeconds: 2.5, isPlaying: true });
+
+      expect(mockNative.getTranscriptSegments).toHaveBeenCalledWith('audio1', { offset: 1, limit: App.transcriptPageSize });
+      expect(app.transcriptGrid.setActiveSegment).toHaveBeenLastCalledWith('audio1', 2);
+      expect(app.transcriptGrid.setPlaybackPosition).not.toHaveBeenCalled();
+    });
+
+    it('loads every page before creating markers', async () => {
+      const app = new App();
+
+      const rows = [{ playbackStart: 0, playbackEnd: 1, text: 'Test 1' }];
+      (app as any).transcriptGrid = {
+        addSegments: jest.fn((segments: any[]) => {
+          rows.push({ playbackStart: 1, playbackEnd: 2, text: segments[0].text });
+        }),
+        removeRowsBySourceID: jest.fn(),
+        getRows: jest.fn().mockReturnValue(rows),
+      };
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      app.transcriptPages.set('audio1', { audioSource, version: 2, loaded: 1, total: 2, lastSegmentID: 0 });
+
+      mockNative.getTranscriptSegments.mockResolvedValueOnce({
+        version: 2, total: 2, offset: 1, segments: [{ id: 1, text: 'Test 2', start: 1, end: 2, score: 1 }]
+      });
+
+      await app.handleCreateMarkers('markers');
+
+      expect(mockNative.createMarkers).toHaveBeenCalledWith([
+        { start: 0, end: 1, name: 'Test 1' },
+        { start: 1, end: 2, name: 'Test 2' }
+      ], 'markers');
+    });
+  });
+
+  describe('transcript edits', () => {
+    it('sends edited text as a segment patch', async () => {
+      const app = new App();
+      app.transcriptVersions.set('audio1', 3);
+      mockNative.updateTranscriptSegments.mockResolvedValue({ version: 4 });
+
+      const row = { id: 'audio1-7', segmentID: 7, start: 0, end: 1, text: 'edited', score: 1, source: 'Audio 1', sourceID: 'audio1' };
+      await app.handleTextEdited(row);
+
+      expect(mockNative.updateTranscriptSegments).toHaveBeenCalledWith('audio1', 3, [{ op: 'replace', id: 7, text: 'edited' }]);
+      expect(app.transcriptVersions.get('audio1')).toBe(4);
+    });
+
+    it('reloads the transcript when an edit is rejected', async () => {
+      const app = new App();
+      app.transcriptVersions.set('audio1', 3);
+      mockNative.updateTranscriptSegments.mockResolvedValue({ error: 'Transcript version conflict', version: 5 });
+
+      const reloadSpy = jest.spyOn(app, 'reloadTranscript').mockResolvedValue(undefined);
+
+      const row = { id: 'audio1-7', segmentID: 7, start: 0, end: 1, text: 'edited', score: 1, source: 'Audio 1', sourceID: 'audio1' };
+      await app.handleTextEdited(row);
+
+      expect(reloadSpy).toHaveBeenCalledWith('audio1');
+    });
+
+    it('applies patches that follow the known version', async () => {
+      const app = new App();
+      app.transcriptVersions.set('audio1', 3);
+
+      (app as any).transcriptGrid = {
+        applySegmentOperations: jest.fn(),
+      };
+
+      const operations = [{ op: 'delete' as const, id: 2 }];
+      await app.handleTranscriptPatched({ persistentID: 'audio1', baseVersion: 3, version: 4, operations });
+
+      expect(app.transcriptGrid.applySegmentOperations).toHaveBeenCalledWith('audio1', operations);
+      expect(app.transcriptVersions.get('audio1')).toBe(4);
+    });
+
+    it('reloads the transcript when a patch skips a version', async () => {
+      const app = new App();
+      app.transcriptVersions.set('audio1', 2);
+
+      (app as any).transcriptGrid = {
+        applySegmentOperations: jest.fn(),
+      };
+
+      const reloadSpy = jest.spyOn(app, 'reloadTranscript').mockResolvedValue(undefined);
+
+      await app.handleTranscriptPatched({ persistentID: 'audio1', baseVersion: 3, version: 4, operations: [] });
+
+      expect(app.transcriptGrid.applySegmentOperations).not.toHaveBeenCalled();
+      expect(reloadSpy).toHaveBeenCalledWith('audio1');
+    });
+  });
+
   describe('search', () => {
     it('handles search input', () => {
       const app = new App();
@@ -732,6 +1267,72 @@ describe('App', () => {
       expect(app.transcriptGrid.filter).toHaveBeenCalledWith('test');
     });
 
+    it('narrows the filter to native search results', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        filter: jest.fn()
+      };
+
+      mockNative.searchTranscripts.mockResolvedValue({
+        results: [{ persistentID: 'audio1', segmentID: 4, start: 1, end: 2, text: 'hello world' }],
+        truncated: false
+      });
+
+      const searchInput = document.getElementById('search-input') as HTMLInputElement;
+      searchInput.value = 'hello wor';
+
+      await app.handleSearch({ target: searchInput } as unknown as Event);
+
+      expect(mockNative.searchTranscripts).toHaveBeenCalledWith('hello wor', expect.objectContaining({ prefix: true }));
+      expect(app.transcriptGrid.filter).toHaveBeenLastCalledWith('hello wor', new Set(['audio1-4']));
+    });
+
+    it('loads the pages holding search results before filtering to them', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        addSegments: jest.fn(),
+        removeRowsBySourceID: jest.fn(),
+        filter: jest.fn(),
+      };
+
+      const audioSource = { persistentID: 'audio1', name: 'Audio 1' } as any;
+      app.transcriptPages.set('audio1', { audioSource, version: 2, loaded: 1, total: 2, lastSegmentID: 0 });
+
+      const segment = { id: 1, text: 'hello world', start: 1, end: 2, score: 1 };
+      mockNative.getTranscriptSegments.mockResolvedValueOnce({ version: 2, total: 2, offset: 1, segments: [segment] });
+      mockNative.searchTranscripts.mockResolvedValue({
+        results: [{ persistentID: 'audio1', segmentID: 1, start: 1, end: 2, text: 'hello world' }],
+        truncated: false
+      });
+
+      const searchInput = document.getElementById('search-input') as HTMLInputElement;
+      searchInput.value = 'hello';
+
+      await app.handleSearch({ target: searchInput } as unknown as Event);
+
+      expect(app.transcriptGrid.addSegments).toHaveBeenCalledWith([segment], audioSource, 1);
+      expect(app.transcriptGrid.filter).toHaveBeenLastCalledWith('hello', new Set(['audio1-1']));
+    });
+
+    it('ignores search results that arrive after a newer search', async () => {
+      const app = new App();
+
+      (app as any).transcriptGrid = {
+        filter: jest.fn()
+      };
+
+      const searchInput = document.getElementById('search-input') as HTMLInputElement;
+      searchInput.value = 'hello';
+
+      const pending = app.handleSearch({ target: searchInput } as unknown as Event);
+      app.clearSearch();
+      await pending;
+
+      expect(app.transcriptGrid.filter).toHaveBeenLastCalledWith('');
+    });
+
     it('clears search input', () => {
       const app = new App();
 
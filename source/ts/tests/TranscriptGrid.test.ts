@@ -136,6 +136,37 @@ describe('TranscriptGrid', () => {
     expect(remainingRows.every(row => row.sourceID === 'test456')).toBe(true);
   });
 
+  it('inserts later pages after the rows loaded for their source', () => {
+    const audioSource1 = makeAudioSource('Test Audio 1', 'test123');
+    const audioSource2 = makeAudioSource('Test Audio 2', 'test456');
+
+    grid.addSegments([{ id: 0, start: 0, end: 1, text: 'One', score: 0.9 }], audioSource1);
+    grid.addSegments([{ id: 0, start: 0, end: 1, text: 'Other', score: 0.9 }], audioSource2);
+    grid.addSegments([{ id: 1, start: 1, end: 2, text: 'Two', score: 0.9 }], audioSource1, 1);
+
+    expect(grid['gridApi'].applyTransaction).toHaveBeenLastCalledWith({
+      add: [expect.objectContaining({ id: 'test123-1' })],
+      addIndex: 1,
+    });
+    expect(grid.getRows().map(row => row.id)).toEqual(['test123-0', 'test123-1', 'test456-0']);
+  });
+
+  it('asks for more rows when the last loaded row of a source comes into view', () => {
+    const onRowsNeeded = jest.fn();
+    grid = new TranscriptGrid('#grid', onPlayAt, undefined, onRowsNeeded);
+
+    grid.addSegments([{ id: 0, start: 0, end: 1, text: 'One', score: 0.9 }], makeAudioSource('Test Audio 1', 'test123'));
+    grid.addSegments([{ id: 0, start: 0, end: 1, text: 'Other', score: 0.9 }], makeAudioSource('Test Audio 2', 'test456'));
+
+    const rowIndexes: Record<string, number> = { 'test123-0': 10, 'test456-0': 10 + 20 + TranscriptGrid.rowsNeededMargin + 1 };
+    grid['gridApi'].getRowNode = jest.fn((id: string) => ({ rowIndex: rowIndexes[id] })) as any;
+
+    grid.handleViewportChanged({ firstRow: 0, lastRow: 20 } as any);
+
+    expect(onRowsNeeded).toHaveBeenCalledTimes(1);
+    expect(onRowsNeeded).toHaveBeenCalledWith('test123');
+  });
+
   it('should find playable range based on playback regions', () => {
     const playbackRegions = [
       {
@@ -257,6 +288,32 @@ describe('TranscriptGrid', () => {
     expect(grid['gridApi'].ensureNodeVisible).toHaveBeenCalledWith(node);
   });
 
+  it('should highlight a segment by ID and track whether it is still playing', () => {
+    grid.addSegments([
+      { id: 4, start: 0, end: 10, text: 'Segment 1', score: 0.9 },
+      { id: 5, start: 10, end: 20, text: 'Segment 2', score: 0.8 }
+    ], makeAudioSource('Test Audio', 'test123'));
+
+    const node = {
+      data: grid.getRows()[1],
+      setSelected: jest.fn(),
+      isSelected: jest.fn().mockReturnValue(false)
+    };
+    grid['gridApi'].getRowNode = jest.fn((id: string) => id === 'test123-5' ? node : undefined) as any;
+    grid['gridApi'].deselectAll = jest.fn();
+    grid['gridApi'].ensureNodeVisible = jest.fn();
+
+    expect(grid.setActiveSegment('test123', 5)).toBe(true);
+    expect(node.setSelected).toHaveBeenCalledWith(true);
+    expect(grid.isActiveAt(15)).toBe(true);
+    expect(grid.isActiveAt(5)).toBe(false);
+
+    expect(grid.setActiveSegment('test123', 9)).toBe(false);
+
+    grid.setPlaybackPosition(15, false);
+    expect(grid.isActiveAt(15)).toBe(false);
+  });
+
   it('should not change selection if position is outside any segment', () => {
     grid.addSegments([
       { start: 0, end: 10, text: 'Segment 1', score: 0.9 },
@@ -364,6 +421,26 @@ describe('TranscriptGrid', () => {
     expect(grid.getRows()[0].playbackEnd).toBeNull();
   });
 
+  it('should map rows added after the playback regions are known', () => {
+    const playbackRegionsBySourceID = new Map<string, PlaybackRegion[]>();
+    playbackRegionsBySourceID.set('test123', [
+      {
+        playbackStart: 10,
+        playbackEnd: 20,
+        modificationStart: 0,
+        modificationEnd: 10,
+        audioSourcePersistentID: 'test123'
+      }
+    ]);
+
+    grid.setPlaybackRegionMap(playbackRegionsBySourceID);
+    grid.addSegments([{ start: 0, end: 10, text: '', score: 0 }], makeAudioSource('Test Audio', 'test123'));
+
+    const rows = grid.getRows();
+    expect(rows[0].playbackStart).toBe(10);
+    expect(rows[0].playbackEnd).toBe(20);
+  });
+
   it('should not update rows when playback regions have not changed', () => {
     const playbackRegionsBySourceID = new Map<string, PlaybackRegion[]>();
     playbackRegionsBySourceID.set('test123', [
@@ -564,6 +641,50 @@ describe('TranscriptGrid', () => {
     expect(grid.processCellForCSV(otherParams)).toBe('test');
   });
 
+  it('applies segment operations to matching rows only', () => {
+    const rows = [
+      { id: 'test123-4', segmentID: 4, start: 10, end: 15, text: 'Hello', score: 0.95, source: 'Test Audio', sourceID: 'test123' },
+      { id: 'test123-5', segmentID: 5, start: 16, end: 20, text: 'World', score: 0.85, source: 'Test Audio', sourceID: 'test123' },
+    ];
+    grid.addRows(rows);
+
+    grid['gridApi'].getRowNode = jest.fn((id: string) => {
+      const row = rows.find(row => row.id === id);
+      return row ? { data: row } : undefined;
+    }) as any;
+
+    grid.applySegmentOperations('test123', [
+      { op: 'replace', id: 4, text: 'Hi' },
+      { op: 'delete', id: 5 },
+      { op: 'delete', id: 99 },
+    ]);
+
+    expect(grid['gridApi'].applyTransaction).toHaveBeenLastCalledWith({
+      update: [expect.objectContaining({ id: 'test123-4', text: 'Hi' })],
+      remove: [expect.objectContaining({ id: 'test123-5' })],
+    });
+    expect(grid.getRows().map(row => row.id)).toEqual(['test123-4']);
+  });
+
+  it('filters to search results instead of text when given row IDs', () => {
+    grid['gridApi'].setGridOption = jest.fn() as any;
+    grid['gridApi'].onFilterChanged = jest.fn() as any;
+
+    grid.filter('hello', new Set(['test123-1']));
+
+    expect(grid['gridApi'].setGridOption).toHaveBeenCalledWith('quickFilterText', '');
+
+    const options = grid.getGridOptions();
+    expect(options.isExternalFilterPresent({} as any)).toBe(true);
+    expect(options.doesExternalFilterPass({ data: { id: 'test123-1' } } as any)).toBe(true);
+    expect(options.doesExternalFilterPass({ data: { id: 'test123-2' } } as any)).toBe(false);
+
+    grid.filter('hello');
+
+    expect(grid['gridApi'].setGridOption).toHaveBeenLastCalledWith('quickFilterText', 'hello');
+    expect(options.isExternalFilterPresent({} as any)).toBe(false);
+  });
+
   it('processes rows for SRT export', () => {
     const row = {
       id: 'test123-0',
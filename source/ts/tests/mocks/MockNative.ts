@@ -7,20 +7,30 @@ export class MockNative {
   // Common native functions exposed as properties
   public abortTranscription: jest.Mock;
   public canCreateMarkers: jest.Mock;
+  public cancelMarkerCreation: jest.Mock;
   public createMarkers: jest.Mock;
+  public exportTranscripts: jest.Mock;
   public getAudioSources: jest.Mock;
   public getAudioSourceTranscript: jest.Mock;
   public getModels: jest.Mock;
+  public getPlaybackRegions: jest.Mock;
   public getPlayHeadState: jest.Mock;
   public getRegionSequences: jest.Mock;
+  public getTranscriptSegments: jest.Mock;
   public getTranscriptionStatus: jest.Mock;
   public getWhisperLanguages: jest.Mock;
+  public lookupAtTime: jest.Mock;
   public play: jest.Mock;
+  public searchTranscripts: jest.Mock;
   public setAudioSourceTranscript: jest.Mock;
   public setPlaybackPosition: jest.Mock;
+  public setTracingEnabled: jest.Mock;
   public setWebState: jest.Mock;
+  public startLiveTranscription: jest.Mock;
   public stop: jest.Mock;
+  public stopLiveTranscription: jest.Mock;
   public transcribeAudioSource: jest.Mock;
+  public updateTranscriptSegments: jest.Mock;
 
   constructor() {
     // Setup the global Juce.getNativeFunction mock
@@ -29,20 +39,30 @@ export class MockNative {
     // Initialize common mocks (without setting defaults yet)
     this.abortTranscription = this.createMock('abortTranscription');
     this.canCreateMarkers = this.createMock('canCreateMarkers');
+    this.cancelMarkerCreation = this.createMock('cancelMarkerCreation');
     this.createMarkers = this.createMock('createMarkers');
+    this.exportTranscripts = this.createMock('exportTranscripts');
     this.getAudioSources = this.createMock('getAudioSources');
     this.getAudioSourceTranscript = this.createMock('getAudioSourceTranscript');
     this.getModels = this.createMock('getModels');
+    this.getPlaybackRegions = this.createMock('getPlaybackRegions');
     this.getPlayHeadState = this.createMock('getPlayHeadState');
     this.getRegionSequences = this.createMock('getRegionSequences');
+    this.getTranscriptSegments = this.createMock('getTranscriptSegments');
     this.getTranscriptionStatus = this.createMock('getTranscriptionStatus');
     this.getWhisperLanguages = this.createMock('getWhisperLanguages');
+    this.lookupAtTime = this.createMock('lookupAtTime');
     this.play = this.createMock('play');
+    this.searchTranscripts = this.createMock('searchTranscripts');
     this.setAudioSourceTranscript = this.createMock('setAudioSourceTranscript');
     this.setPlaybackPosition = this.createMock('setPlaybackPosition');
+    this.setTracingEnabled = this.createMock('setTracingEnabled');
     this.setWebState = this.createMock('setWebState');
+    this.startLiveTranscription = this.createMock('startLiveTranscription');
     this.stop = this.createMock('stop');
+    this.stopLiveTranscription = this.createMock('stopLiveTranscription');
     this.transcribeAudioSource = this.createMock('transcribeAudioSource');
+    this.updateTranscriptSegments = this.createMock('updateTranscriptSegments');
 
     // Initialize all mocks with their default values
     this.reset();
@@ -97,20 +117,30 @@ export class MockNative {
     // Set default implementations for common mocks
     this.abortTranscription.mockReturnValue(Promise.resolve(true));
     this.canCreateMarkers.mockReturnValue(Promise.resolve(true));
-    this.createMarkers.mockReturnValue(Promise.resolve());
+    this.cancelMarkerCreation.mockReturnValue(Promise.resolve());
+    this.createMarkers.mockReturnValue(Promise.resolve({"created": 0, "skipped": 0, "cancelled": false}));
+    this.exportTranscripts.mockReturnValue(Promise.resolve({"filePaths": [], "numSegments": 0}));
     this.getAudioSources.mockReturnValue(Promise.resolve([]));
     this.getAudioSourceTranscript.mockReturnValue(Promise.resolve({}));
     this.getModels.mockReturnValue(Promise.resolve([]));
+    this.getPlaybackRegions.mockReturnValue(Promise.resolve({"version": 0, "regions": []}));
     this.getPlayHeadState.mockReturnValue(Promise.resolve({"timeInSeconds": 0, "isPlaying": false}));
     this.getRegionSequences.mockReturnValue(Promise.resolve([]));
+    this.getTranscriptSegments.mockReturnValue(Promise.resolve({"version": 0, "total": 0, "offset": 0, "segments": []}));
     this.getTranscriptionStatus.mockReturnValue(Promise.resolve({"status": "", "progress": 0}));
     this.getWhisperLanguages.mockReturnValue(Promise.resolve([]));
+    this.lookupAtTime.mockReturnValue(Promise.resolve({"hits": []}));
     this.play.mockReturnValue(Promise.resolve());
+    this.searchTranscripts.mockReturnValue(Promise.resolve({"results": [], "truncated": false}));
     this.setAudioSourceTranscript.mockReturnValue(Promise.resolve());
     this.setPlaybackPosition.mockReturnValue(Promise.resolve());
+    this.setTracingEnabled.mockReturnValue(Promise.resolve({"enabled": false, "filePath": ""}));
     this.setWebState.mockReturnValue(Promise.resolve());
+    this.startLiveTranscription.mockReturnValue(Promise.resolve());
     this.stop.mockReturnValue(Promise.resolve());
-    this.transcribeAudioSource.mockReturnValue(Promise.resolve({"segments": []}));
+    this.stopLiveTranscription.mockReturnValue(Promise.resolve());
+    this.transcribeAudioSource.mockReturnValue(Promise.resolve({"aborted": false, "numSegments": 0}));
+    this.updateTranscriptSegments.mockReturnValue(Promise.resolve({"version": 1}));
   }
 }
 
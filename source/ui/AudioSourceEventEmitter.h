@@ -3,7 +3,12 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
-class AudioSourceEventEmitter : private juce::ARADocument::Listener, private juce::ARAAudioSource::Listener
+#include "../ara/ReaSpeechLiteAudioSource.h"
+
+class AudioSourceEventEmitter :
+    private juce::ARADocument::Listener,
+    private juce::ARAAudioSource::Listener,
+    private ReaSpeechLiteAudioSource::TranscriptListener
 {
 public:
     AudioSourceEventEmitter (
@@ -18,7 +23,7 @@ public:
 
             for (auto* audioSource : document->getAudioSources())
             {
-                audioSource->addListener (this);
+                addAudioSourceListeners (audioSource);
             }
         }
     }
@@ -29,7 +34,7 @@ public:
         {
             for (auto* audioSource : document->getAudioSources())
             {
-                audioSource->removeListener (this);
+                removeAudioSourceListeners (audioSource);
             }
 
             document->removeListener (this);
@@ -39,13 +44,13 @@ public:
 private:
     void didAddAudioSourceToDocument (juce::ARADocument*, juce::ARAAudioSource* audioSource) override
     {
-        audioSource->addListener (this);
+        addAudioSourceListeners (audioSource);
         emitAudioSourceEvent ("audioSourceAdded", audioSource);
     }
 
     void willRemoveAudioSourceFromDocument (juce::ARADocument*, juce::ARAAudioSource* audioSource) override
     {
-        audioSource->removeListener (this);
+        removeAudioSourceListeners (audioSource);
         emitAudioSourceEvent ("audioSourceRemoved", audioSource);
     }
 
@@ -54,6 +59,35 @@ private:
         emitAudioSourceEvent ("audioSourceContentUpdated", audioSource);
     }
 
+    void transcriptPatched (ReaSpeechLiteAudioSource& audioSource,
+                            juce::int64 baseVersion,
+                            juce::int64 version,
+                            const ASRTranscriptPatch& patch) override
+    {
+        juce::DynamicObject::Ptr eventObj = new juce::DynamicObject();
+        eventObj->setProperty ("persistentID", juce::String (audioSource.getPersistentID()));
+        eventObj->setProperty ("baseVersion", baseVersion);
+        eventObj->setProperty ("version", version);
+        eventObj->setProperty ("operations", patch.toVar());
+        webComponent.emitEventIfBrowserIsVisible ("audioSourceTranscriptPatched", juce::var (eventObj.get()));
+    }
+
+    void addAudioSourceListeners (juce::ARAAudioSource* audioSource)
+    {
+        audioSource->addListener (this);
+
+        if (auto* rslAudioSource = dynamic_cast<ReaSpeechLiteAudioSource*> (audioSource))
+            rslAudioSource->addTranscriptListener (this);
+    }
+
+    void removeAudioSourceListeners (juce::ARAAudioSource* audioSource)
+    {
+        audioSource->removeListener (this);
+
+        if (auto* rslAudioSource = dynamic_cast<ReaSpeechLiteAudioSource*> (audioSource))
+            rslAudioSource->removeTranscriptListener (this);
+    }
+
     void emitAudioSourceEvent (const juce::String& eventName, juce::ARAAudioSource* audioSource)
     {
         juce::DynamicObject::Ptr eventObj = new juce::DynamicObject();
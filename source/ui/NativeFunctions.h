@@ -2,7 +2,10 @@
 
 #include <atomic>
 #include <functional>
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
@@ -13,12 +16,19 @@
 #include "../asr/ASREngine.h"
 #include "../asr/ASROptions.h"
 #include "../asr/ASRThreadPoolJob.h"
+#include "../asr/ASRTranscript.h"
+#include "../asr/ASRTranscriptPatch.h"
+#include "../asr/TranscriptExporter.h"
+#include "../asr/LiveTranscriber.h"
 #include "../asr/WhisperLanguages.h"
 #include "../plugin/ReaSpeechLiteAudioProcessorImpl.h"
+#include "../reaper/MarkerCreationJob.h"
+#include "../reaper/NotesTrackChunk.h"
 #include "../reaper/ReaperProxy.h"
 #include "../types/MarkerType.h"
 #include "../utils/AbortHandler.h"
 #include "../utils/SafeUTF8.h"
+#include "../utils/TraceRecorder.h"
 
 class NativeFunctions : public OptionsBuilder<juce::WebBrowserComponent::Options>
 {
@@ -29,40 +39,77 @@ public:
     ) : editorView (editorViewIn),
         audioProcessor (audioProcessorIn)
     {
-        asrEngine = std::make_unique<ASREngine> (Config::getModelsDir());
+        asrEngine = std::make_unique<ASREngine>();
+    }
+
+    ~NativeFunctions()
+    {
+        // Stop live transcription before anything it reports to goes away
+        liveTranscriber.reset();
+        markerCreationJob.reset();
+    }
+
+    using EventEmitter = std::function<void (const juce::Identifier&, const juce::var&)>;
+
+    // Sets the function used to send events to the web view
+    void setEventEmitter (EventEmitter emitterIn)
+    {
+        eventEmitter = std::move (emitterIn);
     }
 
     // Timeout in milliseconds for aborting transcription jobs
     static constexpr int abortTimeout = 5000;
 
+    // Default and maximum number of segments returned by getTranscriptSegments
+    static constexpr int defaultSegmentPageSize = 500;
+    static constexpr int maxSegmentPageSize = 5000;
+
     juce::WebBrowserComponent::Options buildOptions (const juce::WebBrowserComponent::Options& initialOptions)
     {
-        auto bindFn = [this] (auto memberFn)
+        using MemberFn = void (NativeFunctions::*) (const juce::var&, std::function<void (const juce::var&)>);
+
+        static const std::vector<std::pair<const char*, MemberFn>> nativeFunctions = {
+            { "abortTranscription", &NativeFunctions::abortTranscription },
+            { "canCreateMarkers", &NativeFunctions::canCreateMarkers },
+            { "cancelMarkerCreation", &NativeFunctions::cancelMarkerCreation },
+            { "createMarkers", &NativeFunctions::createMarkers },
+            { "exportTranscripts", &NativeFunctions::exportTranscripts },
+            { "getAudioSources", &NativeFunctions::getAudioSources },
+            { "getAudioSourceTranscript", &NativeFunctions::getAudioSourceTranscript },
+            { "getModels", &NativeFunctions::getModels },
+            { "getPlaybackRegions", &NativeFunctions::getPlaybackRegions },
+            { "getPlayHeadState", &NativeFunctions::getPlayHeadState },
+            { "getRegionSequences", &NativeFunctions::getRegionSequences },
+            { "getTranscriptSegments", &NativeFunctions::getTranscriptSegments },
+            { "getTranscriptionStatus", &NativeFunctions::getTranscriptionStatus },
+            { "getWhisperLanguages", &NativeFunctions::getWhisperLanguages },
+            { "lookupAtTime", &NativeFunctions::lookupAtTime },
+            { "play", &NativeFunctions::play },
+            { "stop", &NativeFunctions::stop },
+            { "saveFile", &NativeFunctions::saveFile },
+            { "searchTranscripts", &NativeFunctions::searchTranscripts },
+            { "setAudioSourceTranscript", &NativeFunctions::setAudioSourceTranscript },
+            { "setPlaybackPosition", &NativeFunctions::setPlaybackPosition },
+            { "setTracingEnabled", &NativeFunctions::setTracingEnabled },
+            { "setWebState", &NativeFunctions::setWebState },
+            { "startLiveTranscription", &NativeFunctions::startLiveTranscription },
+            { "stopLiveTranscription", &NativeFunctions::stopLiveTranscription },
+            { "transcribeAudioSource", &NativeFunctions::transcribeAudioSource },
+            { "updateTranscriptSegments", &NativeFunctions::updateTranscriptSegments }
+        };
+
+        auto options = initialOptions;
+
+        for (const auto& [name, memberFn] : nativeFunctions)
         {
-            return [this, memberFn] (const auto& args, const auto& complete)
+            options = options.withNativeFunction (name, [this, name = name, memberFn = memberFn] (const auto& args, const auto& complete)
             {
+                const ScopedTrace trace (name, "bridge");
                 (this->*memberFn) (args, complete);
-            };
-        };
+            });
+        }
 
-        return initialOptions
-            .withNativeFunction ("abortTranscription", bindFn (&NativeFunctions::abortTranscription))
-            .withNativeFunction ("canCreateMarkers", bindFn (&NativeFunctions::canCreateMarkers))
-            .withNativeFunction ("createMarkers", bindFn (&NativeFunctions::createMarkers))
-            .withNativeFunction ("getAudioSources", bindFn (&NativeFunctions::getAudioSources))
-            .withNativeFunction ("getAudioSourceTranscript", bindFn (&NativeFunctions::getAudioSourceTranscript))
-            .withNativeFunction ("getModels", bindFn (&NativeFunctions::getModels))
-            .withNativeFunction ("getPlayHeadState", bindFn (&NativeFunctions::getPlayHeadState))
-            .withNativeFunction ("getRegionSequences", bindFn (&NativeFunctions::getRegionSequences))
-            .withNativeFunction ("getTranscriptionStatus", bindFn (&NativeFunctions::getTranscriptionStatus))
-            .withNativeFunction ("getWhisperLanguages", bindFn (&NativeFunctions::getWhisperLanguages))
-            .withNativeFunction ("play", bindFn (&NativeFunctions::play))
-            .withNativeFunction ("stop", bindFn (&NativeFunctions::stop))
-            .withNativeFunction ("saveFile", bindFn (&NativeFunctions::saveFile))
-            .withNativeFunction ("setAudioSourceTranscript", bindFn (&NativeFunctions::setAudioSourceTranscript))
-            .withNativeFunction ("setPlaybackPosition", bindFn (&NativeFunctions::setPlaybackPosition))
-            .withNativeFunction ("setWebState", bindFn (&NativeFunctions::setWebState))
-            .withNativeFunction ("transcribeAudioSource", bindFn (&NativeFunctions::transcribeAudioSource));
+        return options;
     }
 
     void abortTranscription (const juce::var&, std::function<void (const juce::var&)> complete)
@@ -79,6 +126,9 @@ public:
             complete (juce::var (false));
     }
 
+    // Creates markers, regions or a notes track as a job that runs in time
+    // slices, emitting "markerCreationProgress" events. Completes with
+    // { created, skipped, cancelled } when the job ends.
     void createMarkers (const juce::var& args, std::function<void (const juce::var&)> complete)
     {
         if (! args.isArray() || args.size() < 2 || ! args[0].isArray() || ! args[1].isString())
@@ -103,23 +153,133 @@ public:
             return;
         }
 
-        withReaperUndo ("Create " + MarkerType::toString (markerType) + " from transcript", [&] {
-            try
+        if (markerCreationJob != nullptr && ! markerCreationJob->isFinished())
+        {
+            complete (makeError ("Marker creation already in progress"));
+            return;
+        }
+
+        std::vector<NotesTrackChunk::Note> notes;
+        notes.reserve ((size_t) markers->size());
+
+        for (const auto& markerVar : *markers)
+            notes.push_back ({ (double) markerVar["start"], (double) markerVar["end"], markerVar["name"].toString() });
+
+        const auto weakThis = juce::WeakReference<NativeFunctions> (this);
+
+        markerCreationJob = std::make_unique<MarkerCreationJob> (
+            rpr,
+            std::move (notes),
+            markerType,
+            [weakThis] (int done, int total)
             {
-                if (markerType == MarkerType::notes)
-                    addReaperNotesTrack (markers);
-                else
-                    addReaperMarkers (markers, markerType);
-            }
-            catch (const ReaperProxy::Missing& e)
+                if (weakThis == nullptr || ! weakThis->eventEmitter)
+                    return;
+
+                juce::DynamicObject::Ptr progress = new juce::DynamicObject();
+                progress->setProperty ("done", done);
+                progress->setProperty ("total", total);
+                weakThis->eventEmitter ("markerCreationProgress", juce::var (progress.get()));
+            },
+            [weakThis, complete] (const juce::var& result)
             {
-                DBG ("Missing REAPER API function: " + juce::String (e.what()));
-            }
-        });
+                complete (result);
+
+                // The job can't be destroyed from its own callback
+                juce::MessageManager::callAsync ([weakThis]
+                {
+                    if (weakThis != nullptr && weakThis->markerCreationJob != nullptr && weakThis->markerCreationJob->isFinished())
+                        weakThis->markerCreationJob.reset();
+                });
+            });
+
+        markerCreationJob->start();
+    }
+
+    void cancelMarkerCreation (const juce::var&, std::function<void (const juce::var&)> complete)
+    {
+        if (markerCreationJob != nullptr)
+            markerCreationJob->cancel();
 
         complete (juce::var());
     }
 
+    // Exports the transcripts of every audio source, or of those listed in
+    // { persistentIDs }, as "srt", "vtt", "csv", "json" or "words" (word-level
+    // CSV). They're written to one chosen file, or with { separateFiles } to
+    // one file per source in a chosen directory. Times are playback times
+    // unless { timeBase: "source" }; cues that no region plays are left out.
+    // Completes with { filePaths, numSegments }, or no paths if cancelled.
+    void exportTranscripts (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! args[0].isString() || (args.size() > 1 && ! args[1].isObject()))
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        const auto format = TranscriptExporter::formatFromString (args[0].toString());
+        if (! format)
+        {
+            complete (makeError ("Invalid export format"));
+            return;
+        }
+
+        const auto options = args.size() > 1 ? args[1] : juce::var();
+        const auto separateFiles = (bool) options.getProperty ("separateFiles", false);
+        const auto extension = TranscriptExporter::getFileExtension (*format);
+
+        const auto documentsDir = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+        const auto flags = separateFiles
+            ? juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories
+            : juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::warnAboutOverwriting;
+
+        fileChooser = std::make_unique<juce::FileChooser> (
+            separateFiles ? "Export transcripts to folder" : "Export transcripts",
+            separateFiles ? documentsDir : documentsDir.getChildFile ("transcript" + extension),
+            separateFiles ? juce::String() : "*" + extension);
+
+        fileChooser->launchAsync (flags, [this, format, options, separateFiles, extension, complete] (const juce::FileChooser& chooser)
+        {
+            const auto target = chooser.getResult();
+            juce::Array<juce::var> filePaths;
+            int numSegments = 0;
+
+            if (target != juce::File())
+            {
+                const auto sources = getExportSources (options);
+                juce::String error;
+
+                if (separateFiles)
+                {
+                    for (const auto& source : sources)
+                    {
+                        const auto file = target.getNonexistentChildFile (juce::File::createLegalFileName (source.name), extension, false);
+                        if (! writeExport (file, *format, { source }, numSegments, error))
+                            break;
+
+                        filePaths.add (file.getFullPathName());
+                    }
+                }
+                else if (writeExport (target, *format, sources, numSegments, error))
+                {
+                    filePaths.add (target.getFullPathName());
+                }
+
+                if (error.isNotEmpty())
+                {
+                    complete (makeError (error));
+                    return;
+                }
+            }
+
+            juce::DynamicObject::Ptr result = new juce::DynamicObject();
+            result->setProperty ("filePaths", filePaths);
+            result->setProperty ("numSegments", numSegments);
+            complete (juce::var (result.get()));
+        });
+    }
+
     void getAudioSources (const juce::var&, std::function<void (const juce::var&)> complete)
     {
         if (auto* document = getDocument())
@@ -159,7 +319,12 @@ public:
             {
                 if (audioSource->getPersistentID() == audioSourceID)
                 {
-                    complete (audioSource->getTranscript());
+                    const auto version = audioSource->getTranscriptVersion();
+                    const auto transcript = audioSource->getTranscript();
+
+                    auto result = transcript != nullptr ? transcript->toVar (false) : juce::var (new juce::DynamicObject());
+                    result.getDynamicObject()->setProperty ("version", version);
+                    complete (result);
                     return;
                 }
             }
@@ -188,39 +353,94 @@ public:
         complete (juce::var (playHeadStateObj.get()));
     }
 
+    // Returns { version, regions }; later changes arrive as playbackRegionsChanged diffs
+    void getPlaybackRegions (const juce::var&, std::function<void (const juce::var&)> complete)
+    {
+        if (auto* documentController = getDocumentController())
+        {
+            complete (documentController->getRegionSequenceModel().getSnapshot());
+            return;
+        }
+        complete (makeError ("Document not found"));
+    }
+
     void getRegionSequences (const juce::var&, std::function<void (const juce::var&)> complete)
     {
-        if (auto* document = getDocument())
+        if (auto* documentController = getDocumentController())
         {
-            juce::Array<juce::var> regionSequences;
-            for (const auto& rs : document->getRegionSequences())
+            complete (documentController->getRegionSequenceModel().getRegionSequences());
+            return;
+        }
+        complete (makeError ("Document not found"));
+    }
+
+    // Returns a page of segments as { version, total, offset, segments }. The
+    // query selects segments by index ({ offset, limit }) or by time ({ start,
+    // end }, in audio source seconds), and may ask for word data ({ words }).
+    void getTranscriptSegments (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! args[0].isString() || (args.size() > 1 && ! args[1].isObject()))
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        auto* audioSource = dynamic_cast<ReaSpeechLiteAudioSource*> (getAudioSourceByPersistentID (args[0].toString()));
+        if (audioSource == nullptr)
+        {
+            complete (makeError ("Audio source not found"));
+            return;
+        }
+
+        const auto query = args.size() > 1 ? args[1] : juce::var();
+        const auto withWords = (bool) query.getProperty ("words", false);
+        const auto limit = juce::jlimit (0, maxSegmentPageSize, (int) query.getProperty ("limit", defaultSegmentPageSize));
+
+        const auto version = audioSource->getTranscriptVersion();
+        const auto transcript = audioSource->getTranscript();
+        const auto numSegments = transcript != nullptr ? transcript->getNumSegments() : 0;
+
+        int begin = 0;
+        int end = 0;
+
+        if (transcript != nullptr)
+        {
+            if (query.hasProperty ("start") || query.hasProperty ("end"))
             {
-                juce::DynamicObject::Ptr regionSequence = new juce::DynamicObject();
-                regionSequence->setProperty ("name", SafeUTF8::encode (rs->getName()));
-                regionSequence->setProperty ("orderIndex", rs->getOrderIndex());
+                const auto startTime = (float) query.getProperty ("start", 0.0);
+                begin = transcript->findFirstSegmentEndingAfter (startTime);
+                end = begin;
 
-                juce::Array<juce::var> playbackRegions;
-                for (const auto& pr : rs->getPlaybackRegions())
+                if (query.hasProperty ("end"))
                 {
-                    juce::DynamicObject::Ptr playbackRegion = new juce::DynamicObject();
-                    playbackRegion->setProperty ("name", SafeUTF8::encode (pr->getName()));
-                    playbackRegion->setProperty ("playbackStart", pr->getStartInPlaybackTime());
-                    playbackRegion->setProperty ("playbackEnd", pr->getEndInPlaybackTime());
-                    playbackRegion->setProperty ("modificationStart", pr->getStartInAudioModificationTime());
-                    playbackRegion->setProperty ("modificationEnd", pr->getEndInAudioModificationTime());
-                    auto* audioSource = pr->getAudioModification()->getAudioSource();
-                    playbackRegion->setProperty ("audioSourcePersistentID", juce::String (audioSource->getPersistentID()));
-                    playbackRegions.add (playbackRegion.get());
+                    const auto endTime = (float) query["end"];
+                    while (end < numSegments && end - begin < limit && transcript->getSegmentStart (end) < endTime)
+                        ++end;
+                }
+                else
+                {
+                    end = juce::jmin (numSegments, begin + limit);
                 }
-                regionSequence->setProperty ("playbackRegions", playbackRegions);
-
-                regionSequences.add (regionSequence.get());
             }
-
-            complete (juce::var (regionSequences));
-            return;
+            else
+            {
+                begin = juce::jlimit (0, numSegments, (int) query.getProperty ("offset", 0));
+                end = juce::jmin (numSegments, begin + limit);
+            }
         }
-        complete (makeError ("Document not found"));
+
+        juce::Array<juce::var> segments;
+        segments.ensureStorageAllocated (end - begin);
+
+        for (int i = begin; i < end; ++i)
+            segments.add (transcript->segmentToVar (i, withWords));
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("version", version);
+        result->setProperty ("total", numSegments);
+        result->setProperty ("offset", begin);
+        result->setProperty ("segments", segments);
+        complete (juce::var (result.get()));
     }
 
     void getTranscriptionStatus (const juce::var&, std::function<void (const juce::var&)> complete)
@@ -263,6 +483,45 @@ public:
         complete (juce::var (WhisperLanguages::get()));
     }
 
+    // Returns { hits: [{ regionID?, persistentID, sourceTime, segment?, word? }] }
+    // for the segment and word playing at a playback time, one hit per
+    // playback region. With { persistentID }, the time is in that audio
+    // source's time instead. Segments and words have source times, and
+    // playback times when the hit has a region.
+    void lookupAtTime (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! (args[0].isDouble() || args[0].isInt() || args[0].isInt64())
+            || (args.size() > 1 && ! args[1].isObject()))
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        auto* documentController = getDocumentController();
+        if (documentController == nullptr)
+        {
+            complete (makeError ("Document not found"));
+            return;
+        }
+
+        const auto time = (double) args[0];
+        auto& timelineIndex = documentController->getUpdatedTimelineIndex();
+
+        const auto sourceID = args.size() > 1 ? args[1].getProperty ("persistentID", juce::var()) : juce::var();
+        const auto hits = sourceID.isString() ? timelineIndex.lookupSourceTime (sourceID.toString(), time)
+                                              : timelineIndex.lookupPlaybackTime (time);
+
+        juce::Array<juce::var> hitsVar;
+        hitsVar.ensureStorageAllocated ((int) hits.size());
+
+        for (const auto& hit : hits)
+            hitsVar.add (timelineHitToVar (hit));
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("hits", hitsVar);
+        complete (juce::var (result.get()));
+    }
+
     void play (const juce::var&, std::function<void (const juce::var&)> complete)
     {
         if (auto* playbackController = getPlaybackController())
@@ -327,6 +586,73 @@ public:
         });
     }
 
+    // Returns { results: [{ persistentID, segmentID, start, end, text }], truncated }
+    // for segments of any audio source that contain the query as a phrase
+    void searchTranscripts (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! args[0].isString())
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        auto* documentController = getDocumentController();
+        if (documentController == nullptr)
+        {
+            complete (makeError ("Document not found"));
+            return;
+        }
+
+        TranscriptSearchIndex::Options options;
+        if (args.size() > 1 && args[1].isObject())
+        {
+            options.prefix = (bool) args[1].getProperty ("prefix", options.prefix);
+            options.fuzzy = (bool) args[1].getProperty ("fuzzy", options.fuzzy);
+            options.limit = juce::jmax (0, (int) args[1].getProperty ("limit", options.limit));
+        }
+
+        bool truncated = false;
+        const auto matches = documentController->getUpdatedSearchIndex().search (args[0].toString(), options, truncated);
+
+        juce::Array<juce::var> results;
+        results.ensureStorageAllocated ((int) matches.size());
+
+        // The index doesn't hold transcripts, so they are looked up once per
+        // matching source. Sources indexed from their stored form are only
+        // decoded if they match.
+        std::map<juce::String, std::shared_ptr<const ASRTranscript>> matchTranscripts;
+        const auto getMatchTranscript = [&] (const TranscriptSearchIndex::Match& match)
+        {
+            auto& transcript = matchTranscripts[match.sourceID];
+            if (transcript == nullptr)
+                for (auto* audioSource : getDocument()->getAudioSources<ReaSpeechLiteAudioSource>())
+                    if (match.sourceID == audioSource->getPersistentID())
+                        transcript = audioSource->getTranscript();
+
+            return transcript;
+        };
+
+        for (const auto& match : matches)
+        {
+            const auto transcript = getMatchTranscript (match);
+            if (transcript == nullptr || match.segment >= transcript->getNumSegments())
+                continue;
+
+            juce::DynamicObject::Ptr resultObj = new juce::DynamicObject();
+            resultObj->setProperty ("persistentID", match.sourceID);
+            resultObj->setProperty ("segmentID", (juce::int64) transcript->getSegmentID (match.segment));
+            resultObj->setProperty ("start", transcript->getSegmentStart (match.segment));
+            resultObj->setProperty ("end", transcript->getSegmentEnd (match.segment));
+            resultObj->setProperty ("text", transcript->getSegmentText (match.segment));
+            results.add (juce::var (resultObj.get()));
+        }
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("results", results);
+        result->setProperty ("truncated", truncated);
+        complete (juce::var (result.get()));
+    }
+
     void setAudioSourceTranscript (const juce::var& args, std::function<void (const juce::var&)> complete)
     {
         if (! args.isArray() || args.size() < 2 || ! args[0].isString() || ! args[1].isObject())
@@ -336,7 +662,6 @@ public:
         }
 
         const auto audioSourceID = args[0].toString();
-        const auto transcript = args[1].getDynamicObject();
 
         if (auto* document = getDocument())
         {
@@ -345,7 +670,14 @@ public:
             {
                 if (audioSource->getPersistentID() == audioSourceID)
                 {
-                    audioSource->setTranscript (transcript);
+                    // An object without segments clears the transcript. Segments
+                    // read without words keep the words they had.
+                    const auto previous = audioSource->getTranscript();
+                    auto transcript = std::make_shared<ASRTranscript>();
+                    if (! ASRTranscript::fromVar (args[1], *transcript, previous.get()))
+                        transcript.reset();
+
+                    audioSource->setTranscript (std::move (transcript));
                     complete (juce::var());
                     return;
                 }
@@ -374,6 +706,45 @@ public:
         complete (makeError ("Playback controller not found"));
     }
 
+    void setTracingEnabled (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! args[0].isBool())
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        auto& recorder = TraceRecorder::getInstance();
+        const bool enabled = args[0];
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("enabled", enabled);
+        result->setProperty ("filePath", "");
+
+        if (! enabled && TraceRecorder::isEnabled())
+        {
+            recorder.setEnabled (false);
+
+            const auto traceFile = juce::File::getSpecialLocation (juce::File::tempDirectory)
+                .getNonexistentChildFile (juce::String (JucePlugin_Name) + "-trace", ".json");
+
+            if (! recorder.writeToFile (traceFile))
+            {
+                complete (makeError ("Failed to save trace"));
+                return;
+            }
+
+            result->setProperty ("filePath", traceFile.getFullPathName());
+            result->setProperty ("droppedEvents", recorder.getNumDroppedEvents());
+        }
+        else
+        {
+            recorder.setEnabled (enabled);
+        }
+
+        complete (juce::var (result.get()));
+    }
+
     void setWebState (const juce::var& args, std::function<void (const juce::var&)> complete)
     {
         if (! args.isArray() || args.size() < 1 || ! args[0].isString())
@@ -402,20 +773,7 @@ public:
 
         std::unique_ptr<ASROptions> options = std::make_unique<ASROptions>();
         if (args.size() > 1)
-        {
-            const auto optionsObj = args[1].getDynamicObject();
-            if (optionsObj != nullptr)
-            {
-                if (optionsObj->hasProperty ("modelName"))
-                    options->modelName = optionsObj->getProperty ("modelName");
-                if (optionsObj->hasProperty ("language"))
-                    options->language = optionsObj->getProperty ("language");
-                if (optionsObj->hasProperty ("translate"))
-                    options->translate = optionsObj->getProperty ("translate");
-                if (optionsObj->hasProperty ("vad"))
-                    options->vad = optionsObj->getProperty ("vad");
-            }
-        }
+            parseASROptions (args[1], *options);
 
         const auto audioSourcePersistentID = args[0].toString();
         if (auto* audioSource = getAudioSourceByPersistentID (audioSourcePersistentID))
@@ -427,18 +785,39 @@ public:
                 [this] (ASRThreadPoolJobStatus status) {
                     asrStatus = status;
                 },
-                [this, complete] (const ASRThreadPoolJobResult& result) {
-                    if (result.isError)
-                        complete (makeError (result.errorMessage));
-                    else
+                [weakThis = juce::WeakReference<NativeFunctions> (this), audioSourcePersistentID, complete] (const ASRThreadPoolJobResult& result) {
+                    // Store the transcript on the message thread, then report completion
+                    juce::MessageManager::callAsync ([weakThis, audioSourcePersistentID, complete, result]
                     {
+                        if (weakThis == nullptr)
+                            return;
+
+                        if (result.isError)
+                        {
+                            complete (weakThis->makeError (result.errorMessage));
+                            return;
+                        }
+
                         juce::DynamicObject::Ptr obj = new juce::DynamicObject();
-                        juce::Array<juce::var> segments;
-                        for (const auto& segment : result.segments)
-                            segments.add (segment.toDynamicObject(false).get());
-                        obj->setProperty ("segments", segments);
+                        obj->setProperty ("aborted", result.isAborted);
+
+                        if (! result.isAborted)
+                        {
+                            auto* audioSource = dynamic_cast<ReaSpeechLiteAudioSource*> (weakThis->getAudioSourceByPersistentID (audioSourcePersistentID));
+                            if (audioSource == nullptr)
+                            {
+                                complete (weakThis->makeError ("Audio source not found"));
+                                return;
+                            }
+
+                            audioSource->setTranscript (result.transcript);
+                            audioSource->setAlternateTranscripts (result.alternateTranscripts);
+                            obj->setProperty ("numSegments", result.transcript->getNumSegments());
+                            obj->setProperty ("numAlternates", (int) result.alternateTranscripts.size());
+                        }
+
                         complete (juce::var (obj.get()));
-                    }
+                    });
                 }
             );
             threadPool.addJob (job, true);
@@ -447,7 +826,117 @@ public:
         complete (makeError ("Audio source not found"));
     }
 
+    void startLiveTranscription (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 1 || ! args[0].isObject())
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        ASROptions options;
+        options.translate = false;
+        options.vad = false;
+        parseASROptions (args[0], options);
+
+        if (liveTranscriber == nullptr)
+        {
+            // Events arrive on the transcriber's thread and are forwarded on the message thread
+            liveTranscriber = std::make_unique<LiveTranscriber> (
+                audioProcessor.liveInput,
+                [weakThis = juce::WeakReference<NativeFunctions> (this)] (const juce::var& event)
+                {
+                    juce::MessageManager::callAsync ([weakThis, event]
+                    {
+                        if (weakThis != nullptr && weakThis->eventEmitter)
+                            weakThis->eventEmitter ("liveTranscript", event);
+                    });
+                });
+        }
+
+        liveTranscriber->start (options);
+        complete (juce::var());
+    }
+
+    void stopLiveTranscription (const juce::var&, std::function<void (const juce::var&)> complete)
+    {
+        if (liveTranscriber != nullptr)
+            liveTranscriber->stop();
+
+        complete (juce::var());
+    }
+
+    void updateTranscriptSegments (const juce::var& args, std::function<void (const juce::var&)> complete)
+    {
+        if (! args.isArray() || args.size() < 3 || ! args[0].isString() || ! args[2].isArray())
+        {
+            complete (makeError ("Invalid arguments"));
+            return;
+        }
+
+        const auto audioSourcePersistentID = args[0].toString();
+        const auto baseVersion = (juce::int64) args[1];
+
+        ASRTranscriptPatch patch;
+        juce::String error;
+        if (! ASRTranscriptPatch::fromVar (args[2], patch, error))
+        {
+            complete (makeError (error));
+            return;
+        }
+
+        auto* audioSource = dynamic_cast<ReaSpeechLiteAudioSource*> (getAudioSourceByPersistentID (audioSourcePersistentID));
+        if (audioSource == nullptr)
+        {
+            complete (makeError ("Audio source not found"));
+            return;
+        }
+
+        const auto version = audioSource->patchTranscript (patch, baseVersion, error);
+        if (version < 0)
+        {
+            // The current version lets the caller tell a conflict from a bad request
+            auto result = makeError (error);
+            result.getDynamicObject()->setProperty ("version", audioSource->getTranscriptVersion());
+            complete (result);
+            return;
+        }
+
+        juce::DynamicObject::Ptr result = new juce::DynamicObject();
+        result->setProperty ("version", version);
+        complete (juce::var (result.get()));
+    }
+
 private:
+    static void parseASROptions (const juce::var& optionsVar, ASROptions& options)
+    {
+        if (const auto* optionsObj = optionsVar.getDynamicObject())
+        {
+            if (optionsObj->hasProperty ("modelName"))
+                options.modelName = optionsObj->getProperty ("modelName");
+            if (optionsObj->hasProperty ("language"))
+                options.language = optionsObj->getProperty ("language");
+            if (optionsObj->hasProperty ("translate"))
+                options.translate = optionsObj->getProperty ("translate");
+            if (optionsObj->hasProperty ("vad"))
+                options.vad = optionsObj->getProperty ("vad");
+            if (optionsObj->hasProperty ("shareEncoder"))
+                options.shareEncoder = optionsObj->getProperty ("shareEncoder");
+
+            // Further decodes of the same audio, e.g. [{ "language": "en", "translate": true }]
+            if (const auto* alternates = optionsObj->getProperty ("alternates").getArray())
+            {
+                for (const auto& alternateVar : *alternates)
+                {
+                    ASRDecodeOptions alternate;
+                    alternate.language = alternateVar.getProperty ("language", options.language);
+                    alternate.translate = alternateVar.getProperty ("translate", false);
+                    options.alternates.push_back (alternate);
+                }
+            }
+        }
+    }
+
     ReaSpeechLiteDocumentController* getDocumentController()
     {
         return ReaSpeechLiteDocumentController::get (editorView);
@@ -486,92 +975,136 @@ private:
         return juce::var (error.get());
     }
 
-    void addReaperMarkers (const juce::Array<juce::var>* markers, const MarkerType::Enum markerType)
+    // Collects the transcripts to export, in document order, with the
+    // playback regions of each unless source time was asked for
+    std::vector<TranscriptExporter::Source> getExportSources (const juce::var& options)
     {
-        int markerNum = 1;
-        for (const auto& markerVar : *markers)
+        std::vector<TranscriptExporter::Source> sources;
+
+        auto* documentController = getDocumentController();
+        if (documentController == nullptr)
+            return sources;
+
+        const auto* persistentIDs = options.getProperty ("persistentIDs", juce::var()).getArray();
+        const auto usePlaybackTime = options.getProperty ("timeBase", "playback").toString() != "source";
+
+        // Exports an alternate transcript, such as a translation, instead of the main one
+        const auto alternate = (int) options.getProperty ("alternate", -1);
+        auto* timelineIndex = usePlaybackTime ? &documentController->getUpdatedTimelineIndex() : nullptr;
+
+        for (auto* audioSource : documentController->getDocument()->getAudioSources<ReaSpeechLiteAudioSource>())
         {
-            const auto marker = markerVar.getDynamicObject();
-            const auto regions = markerType == MarkerType::regions;
-            const auto start = marker->getProperty ("start");
-            const auto end = marker->getProperty ("end");
-            const auto name = marker->getProperty ("name");
+            const juce::String persistentID (audioSource->getPersistentID());
+            if (persistentIDs != nullptr && ! persistentIDs->contains (persistentID))
+                continue;
+
+            auto transcript = alternate >= 0 ? audioSource->getAlternateTranscript (alternate) : audioSource->getTranscript();
+            if (transcript == nullptr)
+                continue;
+
+            TranscriptExporter::Source source { persistentID, SafeUTF8::encode (audioSource->getName()), std::move (transcript), std::nullopt };
+
+            // Every playback region of the source, so repeated regions get their own cues
+            if (timelineIndex != nullptr)
+            {
+                auto& placements = source.placements.emplace();
+                for (const auto& region : timelineIndex->getRegions())
+                    if (region.sourceID == persistentID)
+                        placements.push_back ({ region.sourceStart, region.sourceEnd, region.playbackStart });
+            }
 
-            rpr.AddProjectMarker2 (ReaperProxy::activeProject, regions, start, end, name.toString().toRawUTF8(), markerNum, 0);
-            markerNum++;
+            sources.push_back (std::move (source));
         }
+
+        return sources;
     }
 
-    void addReaperNotesTrack (const juce::Array<juce::var>* markers, const char* trackName = "Transcript")
+    // Streams an export to a temporary file, which replaces the target once complete
+    static bool writeExport (const juce::File& file,
+                             TranscriptExporter::Format format,
+                             const std::vector<TranscriptExporter::Source>& sources,
+                             int& numSegments,
+                             juce::String& error)
     {
-        const auto index = 0;
-        const auto originalPosition = rpr.GetCursorPositionEx (ReaperProxy::activeProject);
+        const ScopedTrace trace ("NativeFunctions::writeExport", "export");
 
-        rpr.InsertTrackInProject (ReaperProxy::activeProject, index, 0);
-        const auto track = rpr.GetTrack (ReaperProxy::activeProject, index);
-        rpr.SetOnlyTrackSelected (track);
-        rpr.GetSetMediaTrackInfo_String (track, "P_NAME", const_cast<char*> (trackName), true);
+        juce::TemporaryFile tempFile (file);
 
-        for (const auto& markerVar : *markers)
         {
-            const auto marker = markerVar.getDynamicObject();
-            const auto start = marker->getProperty ("start");
-            const auto end = marker->getProperty ("end");
-            const auto name = marker->getProperty ("name");
+            juce::FileOutputStream out (tempFile.getFile());
+            if (! out.openedOk())
+            {
+                error = "Failed to write " + file.getFileName();
+                return false;
+            }
+
+            TranscriptExporter exporter (out, format);
+            exporter.writeHeader();
 
-            const auto item = createEmptyReaperItem (start, end);
-            setReaperNoteText (item, name.toString());
+            for (const auto& source : sources)
+                exporter.writeSource (source);
+
+            exporter.writeFooter();
+            numSegments += exporter.getNumSegments();
+
+            if (out.getStatus().failed())
+            {
+                error = "Failed to write " + file.getFileName() + ": " + out.getStatus().getErrorMessage();
+                return false;
+            }
         }
 
-        rpr.SetEditCurPos2 (ReaperProxy::activeProject, originalPosition, true, true);
-    }
+        if (! tempFile.overwriteTargetFileWithTemporary())
+        {
+            error = "Failed to save " + file.getFileName();
+            return false;
+        }
 
-    ReaperProxy::MediaItem* createEmptyReaperItem (const double start, const double end)
-    {
-        rpr.Main_OnCommandEx(40142, 0, ReaperProxy::activeProject); // Insert empty item
-        auto* item = rpr.GetSelectedMediaItem(ReaperProxy::activeProject, 0);
-        rpr.SelectAllMediaItems (ReaperProxy::activeProject, false);
-        rpr.SetMediaItemPosition (item, start, true);
-        rpr.SetMediaItemLength (item, end - start, true);
-        return item;
+        return true;
     }
 
-    void setReaperNoteText (ReaperProxy::MediaItem* item, const juce::String& text, bool stretch = false)
+    static juce::var timelineHitToVar (const TimelineIndex::Hit& hit)
     {
-        char buffer[4096];
-        rpr.GetItemStateChunk (item, buffer, sizeof (buffer), false);
-        const auto chunk = juce::String (buffer);
-
-        // This function is currently only used with new items, and the chunk size
-        // in that case is currently around 200 bytes. If this changes, the buffer
-        // size may need to be increased. The current size is a bit arbitrary.
-        auto chunkSize = static_cast<size_t> (chunk.length());
-        auto bufferSize = sizeof (buffer);
-        jassert (chunkSize < bufferSize - 1);
+        const auto* region = hit.region;
 
-        juce::String notesChunk;
-        notesChunk << "<NOTES\n|" << text.trim() << "\n>\n";
-        const juce::String flagsChunk { stretch ? "IMGRESOURCEFLAGS 11\n" : "" };
+        const auto makeRange = [region] (double start, double end)
+        {
+            juce::DynamicObject::Ptr range = new juce::DynamicObject();
+            range->setProperty ("start", start);
+            range->setProperty ("end", end);
 
-        const auto newChunk = chunk.replace(">", notesChunk.replace ("%", "%%") + flagsChunk + ">");
-        rpr.SetItemStateChunk (item, newChunk.toRawUTF8(), false);
-    }
+            if (region != nullptr)
+            {
+                range->setProperty ("playbackStart", region->toPlaybackTime (start));
+                range->setProperty ("playbackEnd", region->toPlaybackTime (end));
+            }
 
-    void withReaperUndo (const juce::String& label, std::function<void()> action)
-    {
-        if (rpr.hasPreventUIRefresh)
-            rpr.PreventUIRefresh(1);
+            return range;
+        };
 
-        if (rpr.hasUndo_BeginBlock2)
-            rpr.Undo_BeginBlock2(ReaperProxy::activeProject);
+        juce::DynamicObject::Ptr hitObj = new juce::DynamicObject();
+        if (region != nullptr)
+            hitObj->setProperty ("regionID", region->id);
+        hitObj->setProperty ("persistentID", hit.sourceID);
+        hitObj->setProperty ("sourceTime", hit.sourceTime);
 
-        action();
+        if (hit.segment >= 0)
+        {
+            const auto& transcript = *hit.transcript;
+            auto segment = makeRange (transcript.getSegmentStart (hit.segment), transcript.getSegmentEnd (hit.segment));
+            segment->setProperty ("id", (juce::int64) transcript.getSegmentID (hit.segment));
+            segment->setProperty ("text", transcript.getSegmentText (hit.segment));
+            hitObj->setProperty ("segment", juce::var (segment.get()));
 
-        if (rpr.hasUndo_EndBlock2)
-            rpr.Undo_EndBlock2(ReaperProxy::activeProject, label.toRawUTF8(), -1);
+            if (hit.word >= 0)
+            {
+                auto word = makeRange (transcript.getWordStart (hit.word), transcript.getWordEnd (hit.word));
+                word->setProperty ("text", transcript.getWordText (hit.word));
+                hitObj->setProperty ("word", juce::var (word.get()));
+            }
+        }
 
-        if (rpr.hasPreventUIRefresh)
-            rpr.PreventUIRefresh(-1);
+        return juce::var (hitObj.get());
     }
 
     juce::ARAEditorView& editorView;
@@ -583,4 +1116,10 @@ private:
     juce::ThreadPool threadPool { 1 };
 
     std::unique_ptr<juce::FileChooser> fileChooser;
+
+    EventEmitter eventEmitter;
+    std::unique_ptr<LiveTranscriber> liveTranscriber;
+    std::unique_ptr<MarkerCreationJob> markerCreationJob;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (NativeFunctions)
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <limits>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+#include "../Config.h"
+#include "../ara/RegionSequenceModel.h"
+#include "../types/PlayHeadState.h"
+
+// Pushes playhead and region sequence changes to the web view, so it doesn't
+// have to poll for them.
+//
+// The playhead is sampled from PlayHeadState on a message thread timer, and
+// "playHeadStateChanged" is emitted whenever the position or transport state
+// has changed since the last tick, so seeks while stopped arrive as promptly
+// as movement during playback. Playback region diffs from the
+// RegionSequenceModel are emitted as "playbackRegionsChanged".
+class PlaybackEventEmitter : private RegionSequenceModel::Listener, private juce::Timer
+{
+public:
+    PlaybackEventEmitter (
+        RegionSequenceModel& regionSequenceModelIn,
+        juce::WebBrowserComponent& webComponentIn,
+        const PlayHeadState& playHeadStateIn
+    ) : regionSequenceModel (regionSequenceModelIn),
+        webComponent (webComponentIn),
+        playHeadState (playHeadStateIn)
+    {
+        regionSequenceModel.addListener (this);
+        startTimerHz (Config::playHeadEventRate);
+    }
+
+    ~PlaybackEventEmitter() override
+    {
+        stopTimer();
+        regionSequenceModel.removeListener (this);
+    }
+
+private:
+    void playbackRegionsChanged (const juce::var& diff) override
+    {
+        webComponent.emitEventIfBrowserIsVisible ("playbackRegionsChanged", diff);
+    }
+
+    void timerCallback() override
+    {
+        const auto isPlaying = playHeadState.isPlaying.load (std::memory_order_relaxed);
+        const auto timeInSeconds = playHeadState.timeInSeconds.load (std::memory_order_relaxed);
+
+        if (isPlaying == lastIsPlaying && timeInSeconds == lastTimeInSeconds)
+            return;
+
+        lastIsPlaying = isPlaying;
+        lastTimeInSeconds = timeInSeconds;
+
+        // The values compared above, rather than a fresh read that may have moved on
+        juce::DynamicObject::Ptr playHeadStateObj = new juce::DynamicObject();
+        playHeadStateObj->setProperty ("isPlaying", isPlaying);
+        playHeadStateObj->setProperty ("timeInSeconds", timeInSeconds);
+
+        webComponent.emitEventIfBrowserIsVisible ("playHeadStateChanged", juce::var (playHeadStateObj.get()));
+    }
+
+    RegionSequenceModel& regionSequenceModel;
+    juce::WebBrowserComponent& webComponent;
+    const PlayHeadState& playHeadState;
+
+    bool lastIsPlaying = false;
+    double lastTimeInSeconds = std::numeric_limits<double>::quiet_NaN(); // Never equal, so the first tick emits
+};
@@ -9,9 +9,11 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_gui_extra/juce_gui_extra.h>
 
+#include "../ara/ReaSpeechLiteDocumentController.h"
 #include "../plugin/ReaSpeechLiteAudioProcessorImpl.h"
 #include "AudioSourceEventEmitter.h"
 #include "NativeFunctions.h"
+#include "PlaybackEventEmitter.h"
 #include "Resources.h"
 
 class ReaSpeechLiteAudioProcessorEditor final :
@@ -39,8 +41,17 @@ public:
             );
             addAndMakeVisible (*webComponent);
 
+            nativeFunctions->setEventEmitter ([this] (const juce::Identifier& eventId, const juce::var& payload)
+            {
+                if (webComponent != nullptr)
+                    webComponent->emitEventIfBrowserIsVisible (eventId, payload);
+            });
+
             audioSourceEventEmitter = std::make_unique<AudioSourceEventEmitter> (*editorView, *webComponent);
 
+            if (auto* documentController = ReaSpeechLiteDocumentController::get (*editorView))
+                playbackEventEmitter = std::make_unique<PlaybackEventEmitter> (documentController->getRegionSequenceModel(), *webComponent, p.playHeadState);
+
             // Navigate to index page
             webComponent->goToURL (juce::WebBrowserComponent::getResourceProviderRoot());
         }
@@ -80,6 +91,7 @@ private:
     std::unique_ptr<NativeFunctions> nativeFunctions;
     std::unique_ptr<juce::WebBrowserComponent> webComponent;
     std::unique_ptr<AudioSourceEventEmitter> audioSourceEventEmitter;
+    std::unique_ptr<PlaybackEventEmitter> playbackEventEmitter;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReaSpeechLiteAudioProcessorEditor)
 };
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <functional>
+
+#include <juce_core/juce_core.h>
+
+#include "../types/PlayHeadState.h"
+#include "RenderStats.h"
+
+// Process-wide arbiter for inference threads, shared by all plugin instances
+// through juce::SharedResourcePointer.
+//
+// The total budget is one less than the number of physical cores. It shrinks
+// while any registered transport is playing, and further when any registered
+// renderer's block time approaches its deadline. Each whisper call takes a
+// lease, which is granted its fair share of what the other leases left, but
+// always at least one thread. Long jobs refresh their lease between windows,
+// so the shares even out and grow again once the transport stops.
+class ComputeBudget
+{
+public:
+    // Render load (fraction of the block deadline) above which inference backs off
+    static constexpr double highLoad = 0.5;
+    static constexpr double criticalLoad = 0.8;
+
+    ComputeBudget()
+        : maxThreads (juce::jmax (1, juce::SystemStats::getNumPhysicalCpus() - 1))
+    {
+    }
+
+    // Holds a share of the budget for the lifetime of one inference call
+    class Lease
+    {
+    public:
+        explicit Lease (ComputeBudget& budgetIn) : budget (budgetIn)
+        {
+            const juce::ScopedLock lock (budget.leasesLock);
+            ++budget.numLeases;
+            numThreads = budget.grantLocked();
+        }
+
+        ~Lease()
+        {
+            const juce::ScopedLock lock (budget.leasesLock);
+            budget.numGrantedThreads -= numThreads;
+            --budget.numLeases;
+        }
+
+        int getNumThreads() const noexcept
+        {
+            return numThreads;
+        }
+
+        // Gives back this lease's threads and takes its current share again.
+        // Returns the new number of threads for the next inference call.
+        int refresh()
+        {
+            const juce::ScopedLock lock (budget.leasesLock);
+            budget.numGrantedThreads -= numThreads;
+            numThreads = budget.grantLocked();
+            return numThreads;
+        }
+
+        // Blocks while the audio engine is close to missing deadlines, so a
+        // long-running call can yield at safe points. Single-threaded calls
+        // are allowed to continue.
+        void waitWhileOverloaded (const std::function<bool ()>& isAborted) const
+        {
+            while (numThreads > 1 && budget.isOverloaded() && ! isAborted())
+                juce::Thread::sleep (overloadPollInterval);
+        }
+
+    private:
+        ComputeBudget& budget;
+        int numThreads = 1;
+
+        JUCE_DECLARE_NON_COPYABLE (Lease)
+    };
+
+    void addPlayHead (const PlayHeadState* playHead)
+    {
+        const juce::ScopedLock lock (sourcesLock);
+        playHeads.addIfNotAlreadyThere (playHead);
+    }
+
+    void removePlayHead (const PlayHeadState* playHead)
+    {
+        const juce::ScopedLock lock (sourcesLock);
+        playHeads.removeFirstMatchingValue (playHead);
+    }
+
+    void addRenderStats (const RenderStats* stats)
+    {
+        const juce::ScopedLock lock (sourcesLock);
+        renderStats.addIfNotAlreadyThere (stats);
+    }
+
+    void removeRenderStats (const RenderStats* stats)
+    {
+        const juce::ScopedLock lock (sourcesLock);
+        renderStats.removeFirstMatchingValue (stats);
+    }
+
+    // Number of inference threads that may run right now, across all callers
+    int getTotalThreads() const
+    {
+        const juce::ScopedLock lock (sourcesLock);
+
+        if (! isAnyPlaying())
+            return maxThreads;
+
+        const auto load = getMaxRenderLoad();
+
+        if (load >= criticalLoad)
+            return 1;
+
+        if (load >= highLoad)
+            return juce::jmax (1, maxThreads / 4);
+
+        return juce::jmax (1, maxThreads / 2);
+    }
+
+    bool isOverloaded() const
+    {
+        const juce::ScopedLock lock (sourcesLock);
+        return isAnyPlaying() && getMaxRenderLoad() >= criticalLoad;
+    }
+
+private:
+    static constexpr int overloadPollInterval = 50;
+
+    // Grants a share of the budget to the lease being granted, which is
+    // already counted in numLeases. Call with leasesLock held.
+    int grantLocked()
+    {
+        const auto totalThreads = getTotalThreads();
+        const auto fairShare = totalThreads / numLeases;
+        const auto available = totalThreads - numGrantedThreads;
+        const auto numThreads = juce::jmax (1, juce::jmin (fairShare, available));
+
+        numGrantedThreads += numThreads;
+        return numThreads;
+    }
+
+    bool isAnyPlaying() const
+    {
+        for (const auto* playHead : playHeads)
+            if (playHead->isPlaying.load (std::memory_order_relaxed))
+                return true;
+
+        return false;
+    }
+
+    // Render load is only meaningful while playing, as stopped renderers keep
+    // their last smoothed value
+    double getMaxRenderLoad() const
+    {
+        double load = 0.0;
+        for (const auto* stats : renderStats)
+            load = juce::jmax (load, stats->getLoad());
+
+        return load;
+    }
+
+    const int maxThreads;
+
+    juce::CriticalSection leasesLock;
+    int numLeases = 0;
+    int numGrantedThreads = 0;
+
+    juce::CriticalSection sourcesLock;
+    juce::Array<const PlayHeadState*> playHeads;
+    juce::Array<const RenderStats*> renderStats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ComputeBudget)
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+// Immutable value published by one writer thread and read wait-free by one
+// realtime reader thread, with epoch-based reclamation.
+//
+// The reader announces the current epoch for the duration of a ReadScope.
+// Publishing swaps in the new value, then advances the epoch; the replaced
+// value is freed on the writer thread once the reader is idle or has
+// announced a later epoch, so it can't still be looking at it. The reader
+// never locks, allocates or frees.
+template <typename T>
+class EpochSnapshot
+{
+public:
+    EpochSnapshot() = default;
+
+    ~EpochSnapshot()
+    {
+        jassert (readerEpoch.load() == idle);
+        delete current.load();
+    }
+
+    // Reader thread only. Holds the snapshot current at construction.
+    class ReadScope
+    {
+    public:
+        explicit ReadScope (EpochSnapshot& ownerIn) : owner (ownerIn)
+        {
+            owner.readerEpoch.store (owner.epoch.load());
+            value = owner.current.load();
+        }
+
+        ~ReadScope()
+        {
+            owner.readerEpoch.store (idle);
+        }
+
+        const T* get() const noexcept { return value; }
+        const T* operator->() const noexcept { return value; }
+        explicit operator bool() const noexcept { return value != nullptr; }
+
+    private:
+        EpochSnapshot& owner;
+        const T* value = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
+    // Writer thread only. A null value unpublishes the current one.
+    void publish (std::unique_ptr<const T> value)
+    {
+        std::unique_ptr<const T> previous (current.exchange (value.release()));
+        const auto retiredEpoch = ++epoch;
+
+        if (previous != nullptr)
+            retired.emplace_back (retiredEpoch, std::move (previous));
+
+        reclaim();
+    }
+
+    // Writer thread only. Frees replaced values the reader can no longer hold.
+    void reclaim()
+    {
+        const auto announced = readerEpoch.load();
+
+        retired.erase (std::remove_if (retired.begin(), retired.end(), [announced] (const auto& entry)
+                                       {
+                                           return announced == idle || announced >= entry.first;
+                                       }),
+                       retired.end());
+    }
+
+    // Writer thread only. The value most recently published.
+    const T* getLatest() const noexcept
+    {
+        return current.load();
+    }
+
+private:
+    static constexpr juce::uint64 idle = 0;
+
+    // Sequentially consistent, so a reader announcing an epoch before a
+    // publish is seen by reclaim(), and one announcing after it loads the
+    // new value
+    std::atomic<const T*> current { nullptr };
+    std::atomic<juce::uint64> epoch { 1 };
+    std::atomic<juce::uint64> readerEpoch { idle };
+
+    std::vector<std::pair<juce::uint64, std::unique_ptr<const T>>> retired;
+
+    JUCE_DECLARE_NON_COPYABLE (EpochSnapshot)
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+// Static set of closed intervals, answering "which intervals overlap this
+// range?" without visiting intervals that can't.
+//
+// Intervals are sorted by start and form an implicit balanced search tree:
+// the middle interval of each subrange is the root of that subrange. Each
+// root also stores the maximum end within its subrange, so a query skips
+// every subtree that ends too early or starts too late. Each reported
+// interval costs at most O(log n), however long the other intervals are.
+// Call build() after adding intervals and before querying. Queries don't
+// allocate, so they are safe on the audio thread.
+template <typename Value, typename Time = double>
+class IntervalIndex
+{
+public:
+    struct Interval
+    {
+        Time start {};
+        Time end {};
+        Value value {};
+    };
+
+    void clear()
+    {
+        intervals.clear();
+        maxEnd.clear();
+    }
+
+    void reserve (size_t size) { intervals.reserve (size); }
+
+    void add (Time start, Time end, Value value)
+    {
+        intervals.push_back ({ start, end, std::move (value) });
+    }
+
+    void build()
+    {
+        // Stable, so intervals added in start order (e.g. segments) keep their order
+        std::stable_sort (intervals.begin(), intervals.end(),
+                          [] (const Interval& a, const Interval& b) { return a.start < b.start; });
+
+        maxEnd.resize (intervals.size());
+        if (! intervals.empty())
+            buildSubtree (0, intervals.size());
+    }
+
+    bool isEmpty() const noexcept { return intervals.empty(); }
+    size_t size() const noexcept { return intervals.size(); }
+
+    // Calls fn (interval) for each interval overlapping [from, to], latest
+    // start first, until fn returns false
+    template <typename Fn>
+    void forEachOverlapping (Time from, Time to, Fn&& fn) const
+    {
+        jassert (maxEnd.size() == intervals.size()); // Missing call to build()
+        visitSubtree (0, intervals.size(), from, to, fn);
+    }
+
+    // Calls fn (interval) for each interval containing the time, latest start
+    // first, until fn returns false
+    template <typename Fn>
+    void forEachContaining (Time time, Fn&& fn) const
+    {
+        forEachOverlapping (time, time, fn);
+    }
+
+    // Returns the interval with the latest start that contains the time, or nullptr
+    const Interval* findLatestContaining (Time time) const
+    {
+        const Interval* found = nullptr;
+        forEachContaining (time, [&found] (const Interval& interval) { found = &interval; return false; });
+        return found;
+    }
+
+private:
+    Time buildSubtree (size_t first, size_t last)
+    {
+        const auto root = first + (last - first) / 2;
+        auto end = intervals[root].end;
+
+        if (first < root)
+            end = std::max (end, buildSubtree (first, root));
+        if (root + 1 < last)
+            end = std::max (end, buildSubtree (root + 1, last));
+
+        maxEnd[root] = end;
+        return end;
+    }
+
+    // Visits the subtree of [first, last) in reverse order. Returns false
+    // once fn has asked to stop.
+    template <typename Fn>
+    bool visitSubtree (size_t first, size_t last, Time from, Time to, Fn& fn) const
+    {
+        if (first >= last)
+            return true;
+
+        const auto root = first + (last - first) / 2;
+
+        // Nothing in this subtree reaches the range
+        if (maxEnd[root] < from)
+            return true;
+
+        // Everything after the root starts later still
+        if (intervals[root].start <= to)
+        {
+            if (! visitSubtree (root + 1, last, from, to, fn))
+                return false;
+
+            if (intervals[root].end >= from && ! fn (intervals[root]))
+                return false;
+        }
+
+        return visitSubtree (first, root, from, to, fn);
+    }
+
+    std::vector<Interval> intervals;
+    std::vector<Time> maxEnd; // Maximum end in the subtree rooted at each index
+};
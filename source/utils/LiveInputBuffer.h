@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+// Single-producer, single-consumer ring buffer that carries a mono downmix of
+// the plugin's input from the audio thread to a worker thread. Pushing never
+// allocates or locks; while inactive, it returns immediately.
+class LiveInputBuffer
+{
+public:
+    // Enough for several seconds at any common host sample rate
+    static constexpr int capacity = 1 << 20;
+
+    // Called from the consumer before activating. Allocates storage the
+    // first time and discards any stale samples.
+    void setActive (bool shouldBeActive)
+    {
+        if (shouldBeActive)
+        {
+            if (samples.empty())
+                samples.resize ((size_t) capacity);
+
+            fifo.reset();
+        }
+
+        active.store (shouldBeActive, std::memory_order_release);
+    }
+
+    bool isActive() const noexcept
+    {
+        return active.load (std::memory_order_acquire);
+    }
+
+    void setSampleRate (double sampleRateIn) noexcept
+    {
+        sampleRate.store (sampleRateIn, std::memory_order_relaxed);
+    }
+
+    double getSampleRate() const noexcept
+    {
+        return sampleRate.load (std::memory_order_relaxed);
+    }
+
+    // Audio thread only
+    void push (const juce::AudioBuffer<float>& buffer, int numChannels) noexcept
+    {
+        if (! isActive() || numChannels <= 0)
+            return;
+
+        const auto numSamples = buffer.getNumSamples();
+        const auto scope = fifo.write (numSamples);
+
+        if (scope.blockSize1 + scope.blockSize2 < numSamples)
+            numDropped.fetch_add (numSamples - (scope.blockSize1 + scope.blockSize2), std::memory_order_relaxed);
+
+        const auto gain = 1.0f / (float) numChannels;
+        downmix (buffer, numChannels, gain, 0, scope.startIndex1, scope.blockSize1);
+        downmix (buffer, numChannels, gain, scope.blockSize1, scope.startIndex2, scope.blockSize2);
+    }
+
+    // Worker thread only. Returns the number of samples read.
+    int read (float* dest, int maxSamples) noexcept
+    {
+        const auto scope = fifo.read (maxSamples);
+
+        if (scope.blockSize1 > 0)
+            std::copy_n (samples.data() + scope.startIndex1, scope.blockSize1, dest);
+
+        if (scope.blockSize2 > 0)
+            std::copy_n (samples.data() + scope.startIndex2, scope.blockSize2, dest + scope.blockSize1);
+
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    // Number of samples lost because the worker fell behind
+    juce::int64 getNumDropped() const noexcept
+    {
+        return numDropped.load (std::memory_order_relaxed);
+    }
+
+private:
+    void downmix (const juce::AudioBuffer<float>& buffer, int numChannels, float gain, int sourceIndex, int destIndex, int numSamples) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        auto* dest = samples.data() + destIndex;
+        juce::FloatVectorOperations::copyWithMultiply (dest, buffer.getReadPointer (0, sourceIndex), gain, numSamples);
+
+        for (int channel = 1; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::addWithMultiply (dest, buffer.getReadPointer (channel, sourceIndex), gain, numSamples);
+    }
+
+    juce::AbstractFifo fifo { capacity };
+    std::vector<float> samples;
+    std::atomic<bool> active { false };
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<juce::int64> numDropped { 0 };
+};
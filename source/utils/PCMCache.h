@@ -0,0 +1,643 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+#include "../Config.h"
+
+// Process-wide cache of decoded audio, shared by all plugin instances through
+// juce::SharedResourcePointer.
+//
+// Each rendition is one source's audio at one sample rate, with all
+// channels, a single one, or all of them mixed down to one. Renditions are
+// immutable and handed out as shared pointers, so one stays valid while in
+// use even if it is spilled or evicted.
+// Renditions are rendered in chunks, straight into a temporary file if they
+// are larger than the memory budget. Once the renditions in memory exceed the
+// budget, the least recently used ones are written to temporary files and
+// memory-mapped instead; spilled renditions beyond the disk budget are
+// dropped. File I/O happens outside the cache's lock.
+//
+// Sources are identified by pointer. Their owner calls invalidate() when the
+// audio changes, and removeSource() before the source is destroyed.
+class PCMCache
+{
+public:
+    static constexpr int allChannels = -1;
+    static constexpr int mixedChannels = -2; // All channels averaged into one
+
+    struct Key
+    {
+        const void* source = nullptr;
+        double sampleRate = 0.0;
+        int channel = allChannels;
+
+        bool operator< (const Key& other) const noexcept
+        {
+            return std::tie (source, sampleRate, channel) < std::tie (other.source, other.sampleRate, other.channel);
+        }
+    };
+
+    class RenditionWriter;
+
+    class Rendition
+    {
+    public:
+        ~Rendition()
+        {
+            // Unmapped before deleting, which Windows requires
+            mapped.reset();
+
+            if (file != juce::File())
+                file.deleteFile();
+        }
+
+        double getSampleRate() const noexcept { return sampleRate; }
+        int getNumChannels() const noexcept { return numChannels; }
+        int getNumSamples() const noexcept { return numSamples; }
+        size_t getNumBytes() const noexcept { return (size_t) numChannels * (size_t) numSamples * sizeof (float); }
+        bool isSpilled() const noexcept { return mapped != nullptr; }
+
+        const float* getReadPointer (int channel) const noexcept
+        {
+            jassert (juce::isPositiveAndBelow (channel, numChannels));
+
+            const auto* data = mapped != nullptr ? static_cast<const float*> (mapped->getData()) : samples.get();
+            return data + (size_t) channel * (size_t) numSamples;
+        }
+
+    private:
+        friend class PCMCache;
+        friend class RenditionWriter;
+
+        // Takes the samples, or the file and its mapping
+        Rendition (double sampleRateIn, int numChannelsIn, int numSamplesIn, juce::HeapBlock<float> samplesIn,
+                   const juce::File& fileIn = {}, std::unique_ptr<juce::MemoryMappedFile> mappedIn = nullptr)
+            : sampleRate (sampleRateIn),
+              numChannels (numChannelsIn),
+              numSamples (numSamplesIn),
+              samples (std::move (samplesIn)),
+              file (fileIn),
+              mapped (std::move (mappedIn))
+        {
+        }
+
+        const double sampleRate;
+        const int numChannels;
+        const int numSamples;
+
+        juce::HeapBlock<float> samples;
+        juce::File file;
+        std::unique_ptr<juce::MemoryMappedFile> mapped;
+
+        JUCE_DECLARE_NON_COPYABLE (Rendition)
+    };
+
+    // Reads a rendition as a 32-bit float audio file, keeping it alive
+    class Reader final : public juce::AudioFormatReader
+    {
+    public:
+        explicit Reader (std::shared_ptr<const Rendition> renditionIn)
+            : AudioFormatReader (nullptr, "PCM Cache"),
+              rendition (std::move (renditionIn))
+        {
+            sampleRate = rendition->getSampleRate();
+            lengthInSamples = rendition->getNumSamples();
+            numChannels = (unsigned int) rendition->getNumChannels();
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+        }
+
+        bool readSamples (
+            int* const* destChannels,
+            int numDestChannels,
+            int startOffsetInDestBuffer,
+            juce::int64 startSampleInFile,
+            int numSamples) override
+        {
+            clearSamplesBeyondAvailableLength (destChannels, numDestChannels, startOffsetInDestBuffer,
+                                               startSampleInFile, numSamples, lengthInSamples);
+
+            if (numSamples <= 0)
+                return true;
+
+            for (int channel = 0; channel < numDestChannels; ++channel)
+            {
+                if (destChannels[channel] == nullptr)
+                    continue;
+
+                auto* dest = reinterpret_cast<float*> (destChannels[channel]) + startOffsetInDestBuffer;
+
+                if (channel < (int) numChannels)
+                    juce::FloatVectorOperations::copy (dest, rendition->getReadPointer (channel) + startSampleInFile, numSamples);
+                else
+                    juce::FloatVectorOperations::clear (dest, numSamples);
+            }
+
+            return true;
+        }
+
+    private:
+        std::shared_ptr<const Rendition> rendition;
+    };
+
+    // Receives a rendition's samples in chunks as it is rendered. Renditions
+    // larger than the memory budget are written straight to a spill file, so
+    // they are never held in memory whole.
+    class RenditionWriter
+    {
+    public:
+        RenditionWriter (const juce::File& spillDirectoryIn, double sampleRateIn)
+            : spillDirectory (spillDirectoryIn),
+              sampleRate (sampleRateIn)
+        {
+        }
+
+        ~RenditionWriter()
+        {
+            out.reset();
+
+            if (file != juce::File())
+                file.deleteFile();
+        }
+
+        // Sets up storage for the rendition. Returns false if it couldn't.
+        bool prepare (int numChannelsIn, int numSamplesIn)
+        {
+            const auto numBytes = (size_t) numChannelsIn * (size_t) numSamplesIn * sizeof (float);
+
+            if (numBytes > Config::pcmCacheMemoryBudgetBytes)
+                return prepareFile (numChannelsIn, numSamplesIn);
+
+            numChannels = numChannelsIn;
+            numSamples = numSamplesIn;
+            samples.allocate ((size_t) numChannels * (size_t) numSamples, true);
+            return true;
+        }
+
+        // As prepare, but always writes to a spill file
+        bool prepareFile (int numChannelsIn, int numSamplesIn)
+        {
+            numChannels = numChannelsIn;
+            numSamples = numSamplesIn;
+
+            if (! spillDirectory.createDirectory())
+                return false;
+
+            file = spillDirectory.getNonexistentChildFile ("rendition", ".pcm", false);
+            out = std::make_unique<juce::FileOutputStream> (file);
+            return out->openedOk();
+        }
+
+        // Writes samples of one channel. Returns false if they couldn't be written.
+        bool write (int channel, int startSample, const float* data, int numSamplesToWrite)
+        {
+            jassert (juce::isPositiveAndBelow (channel, numChannels) && startSample + numSamplesToWrite <= numSamples);
+
+            const auto offset = (size_t) channel * (size_t) numSamples + (size_t) startSample;
+
+            if (out == nullptr)
+            {
+                juce::FloatVectorOperations::copy (samples.get() + offset, data, numSamplesToWrite);
+                return true;
+            }
+
+            return out->setPosition ((juce::int64) (offset * sizeof (float)))
+                && out->write (data, (size_t) numSamplesToWrite * sizeof (float));
+        }
+
+        // Returns the rendition, or nullptr if writing it failed
+        std::shared_ptr<const Rendition> finish()
+        {
+            if (out == nullptr)
+                return std::shared_ptr<const Rendition> (new Rendition (sampleRate, numChannels, numSamples, std::move (samples)));
+
+            out->flush();
+            const auto written = out->getStatus().wasOk();
+            out.reset();
+
+            if (! written)
+                return nullptr;
+
+            auto mapped = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+            if (mapped->getData() == nullptr
+                || mapped->getSize() < (size_t) numChannels * (size_t) numSamples * sizeof (float))
+                return nullptr;
+
+            // The rendition deletes the file from now on
+            auto rendition = std::shared_ptr<const Rendition> (
+                new Rendition (sampleRate, numChannels, numSamples, {}, file, std::move (mapped)));
+            file = juce::File();
+            return rendition;
+        }
+
+    private:
+        const juce::File spillDirectory;
+        const double sampleRate;
+        int numChannels = 0;
+        int numSamples = 0;
+
+        juce::HeapBlock<float> samples;
+        juce::File file;
+        std::unique_ptr<juce::FileOutputStream> out;
+
+        JUCE_DECLARE_NON_COPYABLE (RenditionWriter)
+    };
+
+    // Renders a source's audio in the given format into the writer. Returns
+    // false if it was aborted or the source couldn't be read.
+    using RenderFunction = std::function<bool (RenditionWriter& writer, const std::function<bool()>& isAborted)>;
+
+    PCMCache()
+    {
+        // Held for the lifetime of the cache, so other processes leave this
+        // process's spill files alone
+        const auto locked = spillDirectoryLock.enter (0);
+        jassertquiet (locked);
+
+        removeStaleSpillDirectories();
+    }
+
+    ~PCMCache()
+    {
+        pool.removeAllJobs (true, -1);
+
+        {
+            const juce::ScopedLock lock (cacheLock);
+            entries.clear();
+        }
+
+        spillDirectory.deleteRecursively();
+        spillDirectoryLock.exit();
+    }
+
+    // Changes each time the source's cached audio is invalidated. Renders
+    // started at an older generation are not cached.
+    juce::uint32 getGeneration (const void* source) const
+    {
+        const juce::ScopedLock lock (cacheLock);
+        return getGenerationLocked (source);
+    }
+
+    std::shared_ptr<const Rendition> find (const Key& key)
+    {
+        const juce::ScopedLock lock (cacheLock);
+
+        const auto it = entries.find (key);
+        if (it == entries.end())
+            return nullptr;
+
+        it->second.lastUsed = ++useCount;
+        return it->second.rendition;
+    }
+
+    // Caches the rendition unless the source was invalidated since the
+    // generation was read
+    void insert (const Key& key, juce::uint32 generation, std::shared_ptr<const Rendition> rendition)
+    {
+        std::shared_ptr<const Rendition> replaced;
+        {
+            const juce::ScopedLock lock (cacheLock);
+
+            if (getGenerationLocked (key.source) != generation)
+                return;
+
+            auto& entry = entries[key];
+            replaced = std::exchange (entry.rendition, std::move (rendition));
+            entry.lastUsed = ++useCount;
+            entry.isSpilling = false;
+        }
+
+        enforceBudgets();
+    }
+
+    // Returns the cached rendition, or renders and caches it on this thread
+    std::shared_ptr<const Rendition> findOrRender (const Key& key, const RenderFunction& render, const std::function<bool()>& isAborted)
+    {
+        if (auto rendition = find (key))
+            return rendition;
+
+        const auto generation = getGeneration (key.source);
+
+        RenditionWriter writer (spillDirectory, key.sampleRate);
+        if (! render (writer, isAborted))
+            return nullptr;
+
+        auto rendition = writer.finish();
+        if (rendition != nullptr)
+            insert (key, generation, rendition);
+
+        return rendition;
+    }
+
+    // Renders and caches a rendition on the cache's thread, unless it is
+    // already cached or being rendered. If given, onRendered is called on the
+    // cache's thread once this or an earlier request's render finishes, or
+    // on the calling thread if it is already cached, so the caller can look
+    // the rendition up. It isn't called if the render fails or the source is
+    // invalidated first.
+    void renderInBackground (const Key& key, RenderFunction render, std::function<void()> onRendered = nullptr)
+    {
+        {
+            const juce::ScopedLock lock (cacheLock);
+
+            if (entries.find (key) == entries.end())
+            {
+                queueRenderLocked (key, std::move (render), std::move (onRendered));
+                return;
+            }
+        }
+
+        if (onRendered != nullptr)
+            onRendered();
+    }
+
+    // Drops the source's cached audio, e.g. after its samples changed
+    void invalidate (const void* source)
+    {
+        std::vector<std::shared_ptr<const Rendition>> removed;
+
+        const juce::ScopedLock lock (cacheLock);
+
+        ++generations[source];
+        removeEntriesLocked (source, removed);
+    }
+
+    // Drops the source's cached audio and waits for its renders to stop.
+    // Must be called before the source is destroyed.
+    void removeSource (const void* source)
+    {
+        SourceJobSelector selector (source);
+        pool.removeAllJobs (true, -1, &selector);
+
+        std::vector<std::shared_ptr<const Rendition>> removed;
+
+        const juce::ScopedLock lock (cacheLock);
+        generations.erase (source);
+        removeEntriesLocked (source, removed);
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const Rendition> rendition;
+        juce::uint64 lastUsed = 0;
+        bool isSpilling = false;
+    };
+
+    class RenderJob final : public juce::ThreadPoolJob
+    {
+    public:
+        RenderJob (PCMCache& cacheIn, const Key& keyIn, RenderFunction renderIn)
+            : ThreadPoolJob ("PCM Cache Render"),
+              key (keyIn),
+              cache (cacheIn),
+              render (std::move (renderIn))
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            const auto rendition = cache.findOrRender (key, render, [this] { return shouldExit(); });
+
+            std::vector<std::function<void()>> onRendered;
+            {
+                const juce::ScopedLock lock (cache.cacheLock);
+
+                // The source may have been invalidated and rendered again since
+                const auto it = cache.pending.find (key);
+                if (it != cache.pending.end() && it->second.job == this)
+                {
+                    if (rendition != nullptr)
+                        onRendered = std::move (it->second.onRendered);
+
+                    cache.pending.erase (it);
+                }
+            }
+
+            for (const auto& callback : onRendered)
+                callback();
+
+            return jobHasFinished;
+        }
+
+        const Key key;
+
+    private:
+        PCMCache& cache;
+        RenderFunction render;
+    };
+
+    class SourceJobSelector final : public juce::ThreadPool::JobSelector
+    {
+    public:
+        explicit SourceJobSelector (const void* sourceIn) : source (sourceIn) {}
+
+        bool isJobSuitable (juce::ThreadPoolJob* job) override
+        {
+            auto* renderJob = dynamic_cast<RenderJob*> (job);
+            return renderJob != nullptr && renderJob->key.source == source;
+        }
+
+    private:
+        const void* source;
+    };
+
+    // Each process spills into its own subdirectory of this one, named by a
+    // random ID, while holding an inter-process lock named after it
+    static juce::File getSpillRoot()
+    {
+        return juce::File::getSpecialLocation (juce::File::tempDirectory)
+            .getChildFile (juce::String (JucePlugin_Name) + " PCM Cache");
+    }
+
+    static juce::String getSpillLockName (const juce::String& spillID)
+    {
+        return juce::String (JucePlugin_Name) + "PCMCache" + spillID;
+    }
+
+    // Deletes spill directories left behind by processes that crashed. A
+    // directory whose lock can be taken has no running owner.
+    void removeStaleSpillDirectories() const
+    {
+        for (const auto& entry : juce::RangedDirectoryIterator (getSpillRoot(), false, "*", juce::File::findDirectories))
+        {
+            const auto directory = entry.getFile();
+            if (directory == spillDirectory)
+                continue;
+
+            juce::InterProcessLock ownerLock (getSpillLockName (directory.getFileName()));
+
+            if (ownerLock.enter (0))
+            {
+                directory.deleteRecursively();
+                ownerLock.exit();
+            }
+        }
+    }
+
+    juce::uint32 getGenerationLocked (const void* source) const
+    {
+        const auto it = generations.find (source);
+        return it != generations.end() ? it->second : 0;
+    }
+
+    // Renditions are moved to removed, so that deleting their files happens
+    // after the lock is released. Declare removed before taking the lock.
+    void removeEntriesLocked (const void* source, std::vector<std::shared_ptr<const Rendition>>& removed)
+    {
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->first.source != source)
+            {
+                ++it;
+                continue;
+            }
+
+            removed.push_back (std::move (it->second.rendition));
+            it = entries.erase (it);
+        }
+
+        for (auto it = pending.begin(); it != pending.end();)
+            it = it->first.source == source ? pending.erase (it) : std::next (it);
+    }
+
+    // Starts a render of the key, or joins the one already started
+    void queueRenderLocked (const Key& key, RenderFunction render, std::function<void()> onRendered)
+    {
+        const auto [it, isNew] = pending.try_emplace (key);
+        if (onRendered != nullptr)
+            it->second.onRendered.push_back (std::move (onRendered));
+
+        if (! isNew)
+            return;
+
+        auto* job = new RenderJob (*this, key, std::move (render));
+        it->second.job = job;
+        pool.addJob (job, true);
+    }
+
+    // Spills the least recently used renditions until those in memory fit,
+    // then drops the least recently used spilled ones until those fit on
+    // disk. Renditions are chosen under the lock and written outside it.
+    void enforceBudgets()
+    {
+        for (;;)
+        {
+            std::vector<std::shared_ptr<const Rendition>> removed;
+            std::shared_ptr<const Rendition> toSpill;
+            Key toSpillKey;
+
+            {
+                const juce::ScopedLock lock (cacheLock);
+
+                size_t memoryBytes = 0;
+                juce::int64 diskBytes = 0;
+                std::map<Key, Entry>::iterator oldestInMemory = entries.end();
+                std::map<Key, Entry>::iterator oldestSpilled = entries.end();
+
+                for (auto it = entries.begin(); it != entries.end(); ++it)
+                {
+                    auto& entry = it->second;
+
+                    if (entry.rendition->isSpilled())
+                    {
+                        diskBytes += (juce::int64) entry.rendition->getNumBytes();
+                        if (oldestSpilled == entries.end() || entry.lastUsed < oldestSpilled->second.lastUsed)
+                            oldestSpilled = it;
+                    }
+                    else
+                    {
+                        // Counted until its spilled copy replaces it
+                        memoryBytes += entry.rendition->getNumBytes();
+
+                        if (! entry.isSpilling
+                            && (oldestInMemory == entries.end() || entry.lastUsed < oldestInMemory->second.lastUsed))
+                            oldestInMemory = it;
+                    }
+                }
+
+                if (diskBytes > Config::pcmCacheDiskBudgetBytes && oldestSpilled != entries.end())
+                {
+                    removed.push_back (std::move (oldestSpilled->second.rendition));
+                    entries.erase (oldestSpilled);
+                    continue;
+                }
+
+                if (memoryBytes <= Config::pcmCacheMemoryBudgetBytes || oldestInMemory == entries.end())
+                    return;
+
+                oldestInMemory->second.isSpilling = true;
+                toSpillKey = oldestInMemory->first;
+                toSpill = oldestInMemory->second.rendition;
+            }
+
+            auto spilled = spill (*toSpill);
+
+            const juce::ScopedLock lock (cacheLock);
+
+            // Unless the entry was replaced or removed meanwhile
+            const auto it = entries.find (toSpillKey);
+            if (it == entries.end() || it->second.rendition != toSpill)
+                continue;
+
+            if (spilled != nullptr)
+            {
+                removed.push_back (std::exchange (it->second.rendition, std::move (spilled)));
+                it->second.isSpilling = false;
+            }
+            else
+            {
+                // Can't spill, so it can't be kept either
+                removed.push_back (std::move (it->second.rendition));
+                entries.erase (it);
+            }
+        }
+    }
+
+    // Returns a copy of the rendition backed by a memory-mapped file, or
+    // nullptr if it couldn't be written
+    std::shared_ptr<const Rendition> spill (const Rendition& rendition) const
+    {
+        RenditionWriter writer (spillDirectory, rendition.getSampleRate());
+
+        if (! writer.prepareFile (rendition.getNumChannels(), rendition.getNumSamples()))
+            return nullptr;
+
+        for (int channel = 0; channel < rendition.getNumChannels(); ++channel)
+            if (! writer.write (channel, 0, rendition.getReadPointer (channel), rendition.getNumSamples()))
+                return nullptr;
+
+        return writer.finish();
+    }
+
+    const juce::String spillID = juce::Uuid().toString();
+    const juce::File spillDirectory = getSpillRoot().getChildFile (spillID);
+    juce::InterProcessLock spillDirectoryLock { getSpillLockName (spillID) };
+
+    // A background render and those waiting for it
+    struct Pending
+    {
+        const RenderJob* job = nullptr;
+        std::vector<std::function<void()>> onRendered;
+    };
+
+    juce::CriticalSection cacheLock;
+    std::map<Key, Entry> entries;
+    std::map<const void*, juce::uint32> generations;
+    std::map<Key, Pending> pending;
+    juce::uint64 useCount = 0;
+
+    // Background renders yield to playback and transcription
+    juce::ThreadPool pool { 1, 0, juce::Thread::Priority::background };
+
+    JUCE_DECLARE_NON_COPYABLE (PCMCache)
+};
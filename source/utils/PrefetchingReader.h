@@ -0,0 +1,308 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+#include "../Config.h"
+
+// Audio format reader that serves realtime reads from buffers filled ahead of
+// time on a background thread, so the audio thread never waits on the source.
+//
+// Each lane is a single-producer, single-consumer ring holding a contiguous
+// run of source samples. Only the reading thread moves a lane: forwards as it
+// reads, or to a new start when playback jumps or a cue asks for audio that
+// will be needed soon (the next region, or the loop start). The background
+// thread fills each lane up to a buffer's length past its read position.
+//
+// Realtime reads that miss every lane output silence and count an underrun.
+// Non-realtime reads, as in an offline bounce, fall back to reading the
+// source directly.
+class PrefetchingReader final : public juce::AudioFormatReader,
+                                private juce::TimeSliceClient
+{
+public:
+    // The readers must read the same source. The background reader is only
+    // used by the thread, the direct one by non-realtime reads.
+    PrefetchingReader (
+        std::unique_ptr<juce::AudioFormatReader> backgroundReaderIn,
+        std::unique_ptr<juce::AudioFormatReader> directReaderIn,
+        juce::TimeSliceThread& threadIn
+    ) : AudioFormatReader (nullptr, backgroundReaderIn->getFormatName()),
+        backgroundReader (std::move (backgroundReaderIn)),
+        directReader (std::move (directReaderIn)),
+        thread (threadIn)
+    {
+        sampleRate = backgroundReader->sampleRate;
+        lengthInSamples = backgroundReader->lengthInSamples;
+        numChannels = backgroundReader->numChannels;
+        metadataValues = backgroundReader->metadataValues;
+        bitsPerSample = 32;
+        usesFloatingPointData = true;
+
+        bufferSize = juce::jmax (2 * Config::prefetchChunkSamples,
+                                 juce::roundToInt (Config::prefetchBufferSeconds * sampleRate));
+
+        for (auto& lane : lanes)
+            lane.ring.setSize ((int) numChannels, bufferSize);
+
+        thread.addTimeSliceClient (this);
+    }
+
+    ~PrefetchingReader() override
+    {
+        // Waits for a slice in progress to finish
+        thread.removeTimeSliceClient (this);
+    }
+
+    // Reads that miss are silent when realtime, and read directly otherwise
+    void setRealtime (bool shouldBeRealtime) noexcept
+    {
+        realtime.store (shouldBeRealtime, std::memory_order_relaxed);
+    }
+
+    // Asks for audio from the given position to be buffered, unless a lane
+    // already holds it or is filling towards it. Reading thread only.
+    void cue (juce::int64 position) noexcept
+    {
+        if (position < 0 || position >= lengthInSamples)
+            return;
+
+        for (const auto& lane : lanes)
+            if (covers (lane, position))
+                return;
+
+        // Replace the least recently used lane, starting a little early in
+        // case the position was rounded differently from the actual read
+        auto* victim = &lanes[0];
+        for (auto& lane : lanes)
+            if (lane.lastUsed < victim->lastUsed)
+                victim = &lane;
+
+        retarget (*victim, juce::jmax ((juce::int64) 0, position - cuePreRoll));
+    }
+
+    // Discards buffered audio, e.g. after the source was edited. Lanes refill
+    // from their current read positions. Reading thread only.
+    void invalidate() noexcept
+    {
+        for (auto& lane : lanes)
+        {
+            const auto start = lane.start.load (std::memory_order_relaxed);
+            if (start >= 0)
+                retarget (lane, lane.readPosition.load (std::memory_order_relaxed));
+        }
+    }
+
+    // Number of realtime reads that found no buffered audio
+    juce::int64 getNumUnderruns() const noexcept
+    {
+        return numUnderruns.load (std::memory_order_relaxed);
+    }
+
+    bool readSamples (
+        int* const* destChannels,
+        int numDestChannels,
+        int startOffsetInDestBuffer,
+        juce::int64 startSampleInFile,
+        int numSamples) override
+    {
+        clearSamplesBeyondAvailableLength (destChannels, numDestChannels, startOffsetInDestBuffer,
+                                           startSampleInFile, numSamples, lengthInSamples);
+
+        if (numSamples <= 0)
+            return true;
+
+        if (auto* lane = findLane (startSampleInFile))
+        {
+            const auto numAvailable = (int) juce::jmin (
+                (juce::int64) numSamples,
+                lane->writePosition.load (std::memory_order_acquire) - startSampleInFile);
+
+            copyFromLane (*lane, destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numAvailable);
+            lane->readPosition.store (startSampleInFile + numAvailable, std::memory_order_release);
+            lane->lastUsed = ++useCount;
+
+            startOffsetInDestBuffer += numAvailable;
+            startSampleInFile += numAvailable;
+            numSamples -= numAvailable;
+
+            if (numSamples == 0)
+                return true;
+        }
+
+        if (! realtime.load (std::memory_order_relaxed))
+            return readDirectly (destChannels, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+
+        for (int channel = 0; channel < numDestChannels; ++channel)
+            if (destChannels[channel] != nullptr)
+                juce::FloatVectorOperations::clear (
+                    reinterpret_cast<float*> (destChannels[channel]) + startOffsetInDestBuffer, numSamples);
+
+        numUnderruns.fetch_add (1, std::memory_order_relaxed);
+        cue (startSampleInFile);
+        return true;
+    }
+
+private:
+    struct Lane
+    {
+        juce::AudioBuffer<float> ring;
+
+        // Written by the reading thread. A start of -1 marks an unused lane.
+        std::atomic<juce::int64> start { -1 };
+        std::atomic<juce::int64> readPosition { 0 };
+        std::atomic<juce::uint32> requestedGeneration { 0 };
+        juce::uint32 lastUsed = 0;
+
+        // Written by the background thread
+        std::atomic<juce::int64> writePosition { -1 };
+        std::atomic<juce::uint32> acknowledgedGeneration { 0 };
+    };
+
+    static constexpr int numLanes = 3;
+    static constexpr juce::int64 cuePreRoll = 1024;
+
+    //==============================================================================
+    // Reading thread
+
+    bool covers (const Lane& lane, juce::int64 position) const noexcept
+    {
+        const auto readPosition = lane.readPosition.load (std::memory_order_relaxed);
+        return lane.start.load (std::memory_order_relaxed) >= 0
+            && readPosition <= position
+            && position < readPosition + bufferSize;
+    }
+
+    // A lane that has audio at the position, once the thread has taken up its
+    // latest start
+    Lane* findLane (juce::int64 position) noexcept
+    {
+        for (auto& lane : lanes)
+        {
+            if (lane.acknowledgedGeneration.load (std::memory_order_acquire)
+                    != lane.requestedGeneration.load (std::memory_order_relaxed))
+                continue;
+
+            if (lane.readPosition.load (std::memory_order_relaxed) <= position
+                && position < lane.writePosition.load (std::memory_order_acquire))
+                return &lane;
+        }
+
+        return nullptr;
+    }
+
+    // The lane isn't read again until the thread acknowledges the new
+    // generation, so the ring can be refilled from the new start
+    void retarget (Lane& lane, juce::int64 start) noexcept
+    {
+        lane.start.store (start, std::memory_order_relaxed);
+        lane.readPosition.store (start, std::memory_order_relaxed);
+        lane.lastUsed = ++useCount;
+
+        lane.requestedGeneration.store (lane.requestedGeneration.load (std::memory_order_relaxed) + 1,
+                                        std::memory_order_release);
+    }
+
+    void copyFromLane (const Lane& lane, int* const* destChannels, int numDestChannels,
+                       int destOffset, juce::int64 position, int numSamples) const noexcept
+    {
+        const auto index = (int) (position % bufferSize);
+        const auto numBeforeWrap = juce::jmin (numSamples, bufferSize - index);
+
+        for (int channel = 0; channel < numDestChannels; ++channel)
+        {
+            if (destChannels[channel] == nullptr)
+                continue;
+
+            auto* dest = reinterpret_cast<float*> (destChannels[channel]) + destOffset;
+
+            if (channel >= (int) numChannels)
+            {
+                juce::FloatVectorOperations::clear (dest, numSamples);
+                continue;
+            }
+
+            const auto* ring = lane.ring.getReadPointer (channel);
+            juce::FloatVectorOperations::copy (dest, ring + index, numBeforeWrap);
+            juce::FloatVectorOperations::copy (dest + numBeforeWrap, ring, numSamples - numBeforeWrap);
+        }
+    }
+
+    bool readDirectly (int* const* destChannels, int numDestChannels, int destOffset,
+                       juce::int64 position, int numSamples)
+    {
+        // Non-realtime, so allocating here is fine
+        juce::HeapBlock<int*> offsetChannels ((size_t) numDestChannels);
+
+        for (int channel = 0; channel < numDestChannels; ++channel)
+            offsetChannels[channel] = destChannels[channel] != nullptr ? destChannels[channel] + destOffset : nullptr;
+
+        return directReader->read (offsetChannels.get(), numDestChannels, position, numSamples, false);
+    }
+
+    //==============================================================================
+    // Background thread
+
+    int useTimeSlice() override
+    {
+        bool didRead = false;
+
+        for (auto& lane : lanes)
+            didRead = fillLane (lane) || didRead;
+
+        return didRead ? 1 : idleInterval;
+    }
+
+    // Reads one chunk into the lane if it has room. Returns true if it read.
+    bool fillLane (Lane& lane)
+    {
+        const auto generation = lane.requestedGeneration.load (std::memory_order_acquire);
+
+        if (generation != lane.acknowledgedGeneration.load (std::memory_order_relaxed))
+        {
+            lane.writePosition.store (lane.start.load (std::memory_order_relaxed), std::memory_order_relaxed);
+            lane.acknowledgedGeneration.store (generation, std::memory_order_release);
+        }
+
+        const auto writePosition = lane.writePosition.load (std::memory_order_relaxed);
+        if (writePosition < 0)
+            return false;
+
+        // Positions before the read position have been consumed and can be overwritten
+        const auto end = juce::jmin (lane.readPosition.load (std::memory_order_acquire) + bufferSize, lengthInSamples);
+        const auto numToRead = (int) juce::jmin ((juce::int64) Config::prefetchChunkSamples, end - writePosition);
+
+        if (numToRead <= 0)
+            return false;
+
+        const auto index = (int) (writePosition % bufferSize);
+        const auto numBeforeWrap = juce::jmin (numToRead, bufferSize - index);
+
+        backgroundReader->read (&lane.ring, index, numBeforeWrap, writePosition, true, true);
+
+        if (numBeforeWrap < numToRead)
+            backgroundReader->read (&lane.ring, 0, numToRead - numBeforeWrap, writePosition + numBeforeWrap, true, true);
+
+        lane.writePosition.store (writePosition + numToRead, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr int idleInterval = 10;
+
+    std::unique_ptr<juce::AudioFormatReader> backgroundReader;
+    std::unique_ptr<juce::AudioFormatReader> directReader;
+    juce::TimeSliceThread& thread;
+
+    int bufferSize = 0;
+    std::array<Lane, numLanes> lanes;
+    juce::uint32 useCount = 0;
+    std::atomic<bool> realtime { true };
+    std::atomic<juce::int64> numUnderruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PrefetchingReader)
+};
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+
+#include <juce_core/juce_core.h>
+
+// Lock-free timing statistics for a realtime render callback. Recording only
+// touches atomics, so it is safe to use on the audio thread.
+class RenderStats
+{
+public:
+    struct Snapshot
+    {
+        juce::int64 numBlocks = 0;
+        juce::int64 numOverruns = 0;
+        juce::int64 numSilencedBlocks = 0;
+        double worstMs = 0.0;
+        double p50Ms = 0.0;
+        double p95Ms = 0.0;
+        double p99Ms = 0.0;
+        double load = 0.0;
+
+        juce::String toString() const
+        {
+            return "blocks: " + juce::String (numBlocks)
+                + ", overruns: " + juce::String (numOverruns)
+                + ", silenced: " + juce::String (numSilencedBlocks)
+                + ", p50: " + juce::String (p50Ms, 3) + " ms"
+                + ", p95: " + juce::String (p95Ms, 3) + " ms"
+                + ", p99: " + juce::String (p99Ms, 3) + " ms"
+                + ", worst: " + juce::String (worstMs, 3) + " ms"
+                + ", load: " + juce::String (load * 100.0, 1) + "%";
+        }
+    };
+
+    // Times one render block and records it against the block's deadline
+    class ScopedBlockTimer
+    {
+    public:
+        ScopedBlockTimer (RenderStats& statsIn, int numSamples, double sampleRate)
+            : stats (statsIn),
+              deadlineSeconds (sampleRate > 0.0 ? numSamples / sampleRate : 0.0),
+              startTicks (juce::Time::getHighResolutionTicks())
+        {
+        }
+
+        ~ScopedBlockTimer()
+        {
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds (
+                juce::Time::getHighResolutionTicks() - startTicks);
+            stats.record (elapsed, deadlineSeconds);
+        }
+
+    private:
+        RenderStats& stats;
+        const double deadlineSeconds;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlockTimer)
+    };
+
+    void record (double elapsedSeconds, double deadlineSeconds) noexcept
+    {
+        const auto micros = elapsedSeconds * 1.0e6;
+
+        numBlocks.fetch_add (1, std::memory_order_relaxed);
+        histogram[(size_t) bucketForMicros (micros)].fetch_add (1, std::memory_order_relaxed);
+
+        auto worst = worstMicros.load (std::memory_order_relaxed);
+        while (micros > worst && ! worstMicros.compare_exchange_weak (worst, micros, std::memory_order_relaxed))
+        {
+        }
+
+        if (deadlineSeconds > 0.0)
+        {
+            const auto blockLoad = elapsedSeconds / deadlineSeconds;
+
+            if (blockLoad > 1.0)
+                numOverruns.fetch_add (1, std::memory_order_relaxed);
+
+            // Exponential moving average, weighted towards the most recent blocks
+            const auto previous = load.load (std::memory_order_relaxed);
+            load.store (previous + loadSmoothing * (blockLoad - previous), std::memory_order_relaxed);
+        }
+    }
+
+    void recordSilencedBlock() noexcept
+    {
+        numSilencedBlocks.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    // Smoothed ratio of block processing time to block duration (1.0 = deadline)
+    double getLoad() const noexcept
+    {
+        return load.load (std::memory_order_relaxed);
+    }
+
+    Snapshot getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.numBlocks = numBlocks.load (std::memory_order_relaxed);
+        snapshot.numOverruns = numOverruns.load (std::memory_order_relaxed);
+        snapshot.numSilencedBlocks = numSilencedBlocks.load (std::memory_order_relaxed);
+        snapshot.worstMs = worstMicros.load (std::memory_order_relaxed) / 1000.0;
+        snapshot.load = getLoad();
+
+        std::array<juce::int64, numBuckets> counts;
+        juce::int64 total = 0;
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            counts[i] = histogram[i].load (std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        snapshot.p50Ms = percentileMicros (counts, total, 0.50) / 1000.0;
+        snapshot.p95Ms = percentileMicros (counts, total, 0.95) / 1000.0;
+        snapshot.p99Ms = percentileMicros (counts, total, 0.99) / 1000.0;
+
+        return snapshot;
+    }
+
+    void reset() noexcept
+    {
+        numBlocks.store (0, std::memory_order_relaxed);
+        numOverruns.store (0, std::memory_order_relaxed);
+        numSilencedBlocks.store (0, std::memory_order_relaxed);
+        worstMicros.store (0.0, std::memory_order_relaxed);
+        load.store (0.0, std::memory_order_relaxed);
+
+        for (auto& bucket : histogram)
+            bucket.store (0, std::memory_order_relaxed);
+    }
+
+private:
+    // Buckets are spaced a quarter octave apart, starting at 1 microsecond
+    static constexpr int bucketsPerOctave = 4;
+    static constexpr int numBuckets = 96;
+    static constexpr double loadSmoothing = 0.05;
+
+    static int bucketForMicros (double micros) noexcept
+    {
+        if (micros <= 1.0)
+            return 0;
+
+        const auto bucket = (int) std::ceil (std::log2 (micros) * bucketsPerOctave);
+        return juce::jlimit (0, numBuckets - 1, bucket);
+    }
+
+    static double bucketUpperBoundMicros (int bucket) noexcept
+    {
+        return std::exp2 ((double) bucket / bucketsPerOctave);
+    }
+
+    static double percentileMicros (const std::array<juce::int64, numBuckets>& counts, juce::int64 total, double percentile)
+    {
+        if (total == 0)
+            return 0.0;
+
+        const auto target = (juce::int64) std::ceil (percentile * (double) total);
+        juce::int64 seen = 0;
+
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            seen += counts[i];
+            if (seen >= target)
+                return bucketUpperBoundMicros ((int) i);
+        }
+
+        return bucketUpperBoundMicros (numBuckets - 1);
+    }
+
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<juce::int64> numOverruns { 0 };
+    std::atomic<juce::int64> numSilencedBlocks { 0 };
+    std::atomic<double> worstMicros { 0.0 };
+    std::atomic<double> load { 0.0 };
+    std::array<std::atomic<juce::int64>, numBuckets> histogram {};
+};
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 
+// Reads a source at the destination sample rate. When the rates differ, reads
+// go through a ResamplingAudioSource. When they match, a direct driver reads
+// the source straight into the caller's buffer, with no interpolation and no
+// intermediate copy.
 class ResamplingDriver
 {
 public:
@@ -17,8 +22,27 @@ public:
         prepareToPlay (maximumSamplesPerBlock, destSampleRate);
     }
 
+    // Direct driver, for a floating point reader at the destination sample rate
+    ResamplingDriver (std::unique_ptr<juce::AudioFormatReader> readerIn, int numDestChannels)
+        : directReader (std::move (readerIn)),
+          directChannels ((size_t) numDestChannels)
+    {
+        jassert (directReader->usesFloatingPointData);
+    }
+
+    bool isDirect() const noexcept
+    {
+        return directReader != nullptr;
+    }
+
     void seek(int sourceStartSample)
     {
+        if (isDirect())
+        {
+            directPosition = sourceStartSample;
+            return;
+        }
+
         if (source->getNextReadPosition() != sourceStartSample)
         {
             // Clear resampling state if read position is moving significantly
@@ -31,9 +55,29 @@ public:
 
     void read(const juce::AudioSourceChannelInfo& buffer)
     {
+        if (isDirect())
+        {
+            readDirect (*buffer.buffer, buffer.startSample, buffer.numSamples);
+            return;
+        }
+
         resampler->getNextAudioBlock (buffer);
     }
 
+    // Direct drivers only. Overwrites the range of every channel, copying the
+    // last source channel into any extra destination channels.
+    void readDirect (juce::AudioBuffer<float>& dest, int destStartSample, int numSamples)
+    {
+        jassert (isDirect() && dest.getNumChannels() <= (int) directChannels.size());
+
+        const auto numChannels = juce::jmin (dest.getNumChannels(), (int) directChannels.size());
+        for (int channel = 0; channel < numChannels; ++channel)
+            directChannels[(size_t) channel] = reinterpret_cast<int*> (dest.getWritePointer (channel, destStartSample));
+
+        directReader->read (directChannels.data(), numChannels, directPosition, numSamples, true);
+        directPosition += numSamples;
+    }
+
 private:
     void prepareToPlay (int maximumSamplesPerBlockIn, double destSampleRateIn)
     {
@@ -47,6 +91,10 @@ private:
     std::unique_ptr<juce::AudioFormatReaderSource> source;
     std::unique_ptr<juce::ResamplingAudioSource> resampler;
 
+    std::unique_ptr<juce::AudioFormatReader> directReader;
+    std::vector<int*> directChannels;
+    juce::int64 directPosition = 0;
+
     double destSampleRate = 48000.0;
     int maximumSamplesPerBlock = 128;
 
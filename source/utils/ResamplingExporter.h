@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -9,6 +10,8 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
 
+#include "PCMCache.h"
+
 struct ResamplingExporter
 {
     static constexpr int blockSize = 4096;
@@ -18,9 +21,13 @@ struct ResamplingExporter
      * specified destination sample rate, and stores the resampled audio data
      * in the provided buffer.
      *
+     * The resampled channel is kept in the shared PCM cache, so exporting the
+     * same source again doesn't read it from the host.
+     *
      * @param audioSource The audio source to read audio data from.
      * @param destSampleRate The sample rate to which the audio data should be resampled.
-     * @param channel The channel index to read from the audio source.
+     * @param channel The channel index to read from the audio source, or
+     *                PCMCache::mixedChannels for a mono mix of all of them.
      * @param buffer A vector to store the resampled audio data.
      * @param isAborted Optional callback that returns true if the operation should be aborted.
      */
@@ -29,16 +36,63 @@ struct ResamplingExporter
         int channel,
         std::vector<float>& buffer,
         std::function<bool()> isAborted = nullptr)
+    {
+        jassert (channel == PCMCache::mixedChannels || (channel >= 0 && channel < audioSource->getChannelCount()));
+
+        const auto rendition = getRendition (audioSource, destSampleRate, channel, isAborted);
+        if (rendition == nullptr)
+            return;
+
+        const auto* samples = rendition->getReadPointer (0);
+        buffer.assign (samples, samples + rendition->getNumSamples());
+    }
+
+    /**
+     * Returns the audio source resampled to the destination sample rate from
+     * the shared PCM cache, rendering it first if it isn't cached.
+     *
+     * @param channel The channel index to read, PCMCache::allChannels or
+     *                PCMCache::mixedChannels.
+     * @return The rendition, or nullptr if aborted or the source couldn't be read.
+     */
+    static std::shared_ptr<const PCMCache::Rendition> getRendition (juce::ARAAudioSource* audioSource,
+        double destSampleRate,
+        int channel,
+        std::function<bool()> isAborted = nullptr)
+    {
+        juce::SharedResourcePointer<PCMCache> cache;
+
+        return cache->findOrRender (
+            { audioSource, destSampleRate, channel },
+            [audioSource, destSampleRate, channel] (PCMCache::RenditionWriter& writer, const std::function<bool()>& aborted)
+            {
+                return render (audioSource, destSampleRate, channel, writer, aborted);
+            },
+            isAborted != nullptr ? isAborted : [] { return false; });
+    }
+
+    /**
+     * Reads and resamples the audio source into the writer, one block at a
+     * time, without using the cache.
+     *
+     * @return False if aborted, or if the source couldn't be read or written.
+     */
+    static bool render (juce::ARAAudioSource* audioSource,
+        double destSampleRate,
+        int channel,
+        PCMCache::RenditionWriter& writer,
+        const std::function<bool()>& isAborted)
     {
         const auto sourceChannelCount = audioSource->getChannelCount();
-        jassert (channel >= 0 && channel < sourceChannelCount);
+        jassert (channel == PCMCache::allChannels || channel == PCMCache::mixedChannels
+                 || (channel >= 0 && channel < sourceChannelCount));
 
         const auto sourceSampleRate = audioSource->getSampleRate();
         const auto sourceSampleCount = audioSource->getSampleCount();
 
         // Create an audio reader source
-        auto readerSource = std::make_unique<juce::AudioFormatReaderSource> (
-            new juce::ARAAudioSourceReader (audioSource), true);
+        auto* reader = new juce::ARAAudioSourceReader (audioSource);
+        auto readerSource = std::make_unique<juce::AudioFormatReaderSource> (reader, true);
 
         // Create a resampling source
         auto resamplingSource = std::make_unique<juce::ResamplingAudioSource> (
@@ -54,7 +108,10 @@ struct ResamplingExporter
 
         // Calculate destination buffer size based on resampling ratio
         const auto destSampleCount = juce::roundToInt (sourceSampleCount * destSamplesPerSourceSample);
-        buffer.resize (static_cast<size_t>(destSampleCount));
+        const auto destChannelCount = channel == PCMCache::allChannels ? sourceChannelCount : 1;
+
+        if (! writer.prepare (destChannelCount, destSampleCount))
+            return false;
 
         // Process in blocks
         juce::AudioBuffer<float> tempBuffer(sourceChannelCount, blockSize);
@@ -64,16 +121,36 @@ struct ResamplingExporter
         while (destSamplePos < destSampleCount)
         {
             if (isAborted && isAborted())
-                return;
+                return false;
 
             resamplingSource->getNextAudioBlock(channelInfo);
 
-            // Copy the resampled block to the destination buffer
+            // Write the resampled block to the rendition
             const int samplesToProcess = juce::jmin (blockSize, destSampleCount - destSamplePos);
-            const float* sourceData = tempBuffer.getReadPointer(channel);
-            std::copy(sourceData, sourceData + samplesToProcess, buffer.begin() + destSamplePos);
+
+            // Mixed into the first channel, which is then the one written
+            if (channel == PCMCache::mixedChannels && sourceChannelCount > 1)
+            {
+                for (int sourceChannel = 1; sourceChannel < sourceChannelCount; ++sourceChannel)
+                    tempBuffer.addFrom (0, 0, tempBuffer, sourceChannel, 0, samplesToProcess);
+
+                tempBuffer.applyGain (0, 0, samplesToProcess, 1.0f / (float) sourceChannelCount);
+            }
+
+            for (int destChannel = 0; destChannel < destChannelCount; ++destChannel)
+            {
+                const auto sourceChannel = channel == PCMCache::allChannels ? destChannel
+                                         : channel == PCMCache::mixedChannels ? 0
+                                         : channel;
+                if (! writer.write (destChannel, destSamplePos, tempBuffer.getReadPointer (sourceChannel), samplesToProcess))
+                    return false;
+            }
 
             destSamplePos += samplesToProcess;
         }
+
+        // Samples read while the source was being edited or had sample access
+        // disabled are silence, and mustn't be kept
+        return reader->isValid();
     }
 };
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <juce_core/juce_core.h>
 
 struct SafeUTF8
@@ -10,9 +12,20 @@ struct SafeUTF8
         if (buffer == nullptr)
             return {};
 
-        std::string input(buffer);
         std::string output;
-        output.reserve(input.length());
+        output.reserve (std::strlen (buffer));
+        appendTo (output, buffer);
+        return juce::String::fromUTF8 (output.c_str());
+    }
+
+    // Appends buffer to output, replacing invalid UTF-8 sequences. Lets
+    // callers reuse one string rather than allocating per call.
+    static void appendTo (std::string& output, const char* const buffer)
+    {
+        if (buffer == nullptr)
+            return;
+
+        const std::string_view input (buffer);
 
         for (size_t i = 0; i < input.length();)
         {
@@ -58,13 +71,11 @@ struct SafeUTF8
             }
 
             if (valid)
-                output.append(input.substr(i, len));
+                output.append (input.substr (i, len));
             else
                 output += "\xEF\xBF\xBD";
 
             i += valid ? len : 1;
         }
-
-        return juce::String::fromUTF8(output.c_str());
     }
 };
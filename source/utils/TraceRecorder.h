@@ -0,0 +1,291 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+// Process-wide recorder for Chrome trace-event / Perfetto JSON spans.
+//
+// Recording is off by default. Enabling it allocates a fixed pool of
+// maxThreads ring buffers, and each thread claims one without locking or
+// allocating on its first event, so realtime threads can record. A thread
+// keeps its buffer, even after it exits, until recording is disabled, which
+// releases every claim. Once the pool is exhausted, events from threads
+// without a buffer are dropped and counted by getNumDroppedEvents() until
+// recording is restarted. Event names must be string literals, as only the
+// pointer is stored.
+class TraceRecorder
+{
+public:
+    static TraceRecorder& getInstance()
+    {
+        static TraceRecorder instance;
+        return instance;
+    }
+
+    static bool isEnabled() noexcept
+    {
+        return getInstance().enabled.load (std::memory_order_relaxed);
+    }
+
+    static juce::int64 nowMicros() noexcept
+    {
+        return (juce::int64) (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks()) * 1.0e6);
+    }
+
+    // Call from a non-realtime thread
+    void setEnabled (bool shouldBeEnabled)
+    {
+        if (shouldBeEnabled && ! buffersAllocated.load())
+        {
+            for (auto& buffer : buffers)
+                buffer = std::make_unique<ThreadBuffer>();
+
+            buffersAllocated.store (true, std::memory_order_release);
+        }
+
+        if (shouldBeEnabled && ! enabled.load())
+        {
+            clear();
+
+            // Buffers released by the last recording are left out of the next
+            // until a thread claims them
+            for (auto& buffer : buffers)
+                if (! buffer->claimed.load())
+                    buffer->threadIndex = 0;
+        }
+
+        enabled.store (shouldBeEnabled);
+
+        // Threads see their claims are stale and claim again on their next
+        // event. The buffers keep their events until then, for toJSON().
+        if (! shouldBeEnabled && buffersAllocated.load())
+        {
+            claimEpoch.fetch_add (1, std::memory_order_acq_rel);
+
+            for (auto& buffer : buffers)
+                buffer->claimed.store (false, std::memory_order_release);
+        }
+    }
+
+    // Records a complete span. Pass a negative duration for an instant event.
+    void record (const char* name, const char* category, juce::int64 startMicros, juce::int64 durationMicros)
+    {
+        if (! enabled.load (std::memory_order_relaxed))
+            return;
+
+        if (auto* buffer = getThreadBuffer())
+            buffer->push ({ name, category, startMicros, durationMicros });
+        else
+            numDroppedEvents.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    // Events dropped because every buffer was claimed by another thread
+    // since recording was enabled
+    juce::int64 getNumDroppedEvents() const noexcept
+    {
+        return numDroppedEvents.load (std::memory_order_relaxed);
+    }
+
+    void instant (const char* name, const char* category)
+    {
+        record (name, category, nowMicros(), -1);
+    }
+
+    // Serialises all recorded events. Call this after recording is disabled,
+    // as events written concurrently may be skipped or torn.
+    juce::String toJSON() const
+    {
+        juce::MemoryOutputStream out;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+
+        for (const auto& buffer : buffers)
+        {
+            if (buffer == nullptr || buffer->threadIndex == 0)
+                continue;
+
+            if (! first)
+                out << ",";
+            first = false;
+
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadIndex
+                << ",\"args\":{\"name\":" << juce::JSON::toString (juce::String (buffer->threadName), true) << "}}";
+
+            buffer->forEach ([&out, &buffer] (const Event& event)
+            {
+                out << ",{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                    << "\",\"pid\":1,\"tid\":" << buffer->threadIndex
+                    << ",\"ts\":" << event.startMicros;
+
+                if (event.durationMicros < 0)
+                    out << ",\"ph\":\"i\",\"s\":\"t\"}";
+                else
+                    out << ",\"ph\":\"X\",\"dur\":" << event.durationMicros << "}";
+            });
+        }
+
+        out << "]}";
+        return out.toString();
+    }
+
+    bool writeToFile (const juce::File& file) const
+    {
+        return file.replaceWithText (toJSON(), false, false, nullptr);
+    }
+
+    void clear()
+    {
+        for (auto& buffer : buffers)
+            if (buffer != nullptr)
+                buffer->clear();
+
+        numDroppedEvents.store (0);
+    }
+
+private:
+    struct Event
+    {
+        const char* name;
+        const char* category;
+        juce::int64 startMicros;
+        juce::int64 durationMicros;
+    };
+
+    // Single-producer ring buffer owned by one thread. When full, the oldest
+    // events are overwritten.
+    struct ThreadBuffer
+    {
+        static constexpr size_t capacity = 1 << 15;
+
+        void push (const Event& event) noexcept
+        {
+            const auto index = writeIndex.load (std::memory_order_relaxed);
+            events[index % capacity] = event;
+            writeIndex.store (index + 1, std::memory_order_release);
+        }
+
+        template <typename Fn>
+        void forEach (Fn&& fn) const
+        {
+            const auto end = writeIndex.load (std::memory_order_acquire);
+            auto begin = clearedIndex.load();
+
+            if (end - begin > capacity)
+                begin = end - capacity;
+
+            for (auto i = begin; i < end; ++i)
+                fn (events[i % capacity]);
+        }
+
+        void clear() noexcept
+        {
+            clearedIndex.store (writeIndex.load());
+        }
+
+        // Takes the buffer over for the calling thread, discarding the events
+        // of the thread that had it before
+        void claimForCurrentThread (int newThreadIndex) noexcept
+        {
+            clear();
+            threadIndex = newThreadIndex;
+
+            // Copied into place, as the thread may be realtime
+            if (auto* thread = juce::Thread::getCurrentThread())
+                thread->getThreadName().copyToUTF8 (threadName, sizeof (threadName));
+            else if (juce::MessageManager::existsAndIsCurrentThread())
+                std::strncpy (threadName, "Message Thread", sizeof (threadName));
+            else
+                std::strncpy (threadName, "Host Thread", sizeof (threadName));
+        }
+
+        std::atomic<bool> claimed { false };
+        int threadIndex = 0;
+        char threadName[64] {};
+        std::atomic<size_t> writeIndex { 0 };
+        std::atomic<size_t> clearedIndex { 0 };
+        std::array<Event, capacity> events {};
+    };
+
+    TraceRecorder() = default;
+
+    // A thread's buffer, valid while recording stays enabled. Trivially
+    // destructible, so nothing runs at thread exit, which may come after the
+    // plugin is unloaded.
+    struct ThreadClaim
+    {
+        ThreadBuffer* buffer;
+        juce::uint32 epoch;
+    };
+
+    ThreadBuffer* getThreadBuffer() noexcept
+    {
+        thread_local ThreadClaim claim { nullptr, 0 };
+
+        const auto epoch = claimEpoch.load (std::memory_order_acquire);
+        if (claim.buffer != nullptr && claim.epoch == epoch)
+            return claim.buffer;
+
+        claim = { nullptr, epoch };
+
+        if (! buffersAllocated.load (std::memory_order_acquire))
+            return nullptr;
+
+        for (auto& buffer : buffers)
+        {
+            bool expected = false;
+            if (buffer->claimed.compare_exchange_strong (expected, true, std::memory_order_acq_rel))
+            {
+                buffer->claimForCurrentThread (nextThreadIndex.fetch_add (1));
+                claim.buffer = buffer.get();
+                break;
+            }
+        }
+
+        return claim.buffer;
+    }
+
+    static constexpr int maxThreads = 16;
+
+    std::atomic<bool> enabled { false };
+
+    // Allocated once, by the first setEnabled (true), and then never changed
+    std::array<std::unique_ptr<ThreadBuffer>, maxThreads> buffers;
+    std::atomic<bool> buffersAllocated { false };
+
+    std::atomic<int> nextThreadIndex { 1 };
+    std::atomic<juce::uint32> claimEpoch { 0 }; // Advanced when recording is disabled
+    std::atomic<juce::int64> numDroppedEvents { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
+
+// Records the lifetime of this object as a trace span, if tracing is enabled
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace (const char* nameIn, const char* categoryIn = "app") noexcept
+        : name (nameIn),
+          category (categoryIn),
+          startMicros (TraceRecorder::isEnabled() ? TraceRecorder::nowMicros() : -1)
+    {
+    }
+
+    ~ScopedTrace()
+    {
+        if (startMicros >= 0)
+            TraceRecorder::getInstance().record (name, category, startMicros, TraceRecorder::nowMicros() - startMicros);
+    }
+
+private:
+    const char* name;
+    const char* category;
+    const juce::int64 startMicros;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedTrace)
+};
@@ -0,0 +1,488 @@
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+
+#include "../source/ara/ReaSpeechLitePlaybackRenderer.h"
+
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter();
+const ARA::ARAFactory* JUCE_CALLTYPE createARAFactory();
+
+//==============================================================================
+// Counts operator new calls made while a thread is marked as the audio thread.
+// This covers the standard containers and std::function, but not
+// juce::HeapBlock, which calls malloc directly.
+namespace AllocationCounter
+{
+    thread_local bool isCounting = false;
+    std::atomic<juce::int64> numAllocations { 0 };
+
+    struct ScopedAudioThread
+    {
+        ScopedAudioThread() { isCounting = true; }
+        ~ScopedAudioThread() { isCounting = false; }
+    };
+
+    void* allocate (std::size_t size)
+    {
+        if (isCounting)
+            numAllocations.fetch_add (1, std::memory_order_relaxed);
+
+        if (auto* memory = std::malloc (size > 0 ? size : 1))
+            return memory;
+
+        throw std::bad_alloc();
+    }
+}
+
+void* operator new (std::size_t size) { return AllocationCounter::allocate (size); }
+void* operator new[] (std::size_t size) { return AllocationCounter::allocate (size); }
+void operator delete (void* memory) noexcept { std::free (memory); }
+void operator delete[] (void* memory) noexcept { std::free (memory); }
+void operator delete (void* memory, std::size_t) noexcept { std::free (memory); }
+void operator delete[] (void* memory, std::size_t) noexcept { std::free (memory); }
+
+//==============================================================================
+// A synthetic ARA host: creates a document through the plugin's own factory,
+// with audio sources whose samples are generated, binds a plugin instance to
+// it as the playback renderer, and renders the timeline in blocks.
+class RenderHarness final : public juce::UnitTest
+{
+public:
+    RenderHarness() : juce::UnitTest ("Playback renderer harness", "ReaSpeechLite") {}
+
+    void runTest() override
+    {
+        const juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+        Host host;
+        if (! host.initialise())
+        {
+            beginTest ("Document setup");
+            expect (false, "The plugin's ARA factory didn't create a document");
+            return;
+        }
+
+        beginTest ("Offline render matches the document");
+        {
+            const auto result = host.render (false);
+
+            expectEquals (result.numMismatchedBlocks, 0);
+            expectEquals (result.numUnderruns, (juce::int64) 0);
+            logMessage ("Offline: " + result.stats.toString());
+        }
+
+        beginTest ("Realtime render doesn't allocate on the audio thread");
+        {
+            const auto result = host.render (true);
+
+            expectEquals (result.numAllocations, (juce::int64) 0);
+            expectEquals (result.stats.numBlocks, (juce::int64) result.numBlocks);
+            expectEquals (result.stats.numSilencedBlocks, (juce::int64) 0);
+
+            // Underruns are reported rather than failed on, since they depend
+            // on the machine's load. Blocks are only compared when there were none.
+            if (result.numUnderruns == 0)
+                expectEquals (result.numMismatchedBlocks, 0);
+
+            logMessage ("Realtime: " + result.stats.toString()
+                        + ", prefetch underruns: " + juce::String (result.numUnderruns)
+                        + ", audio thread allocations: " + juce::String (result.numAllocations));
+        }
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 256;
+    static constexpr int numChannels = 2;
+    static constexpr double sourceSeconds = 4.0;
+
+    // A source's sample at a position, distinct for each source and channel
+    static float getSourceSample (int source, int channel, juce::int64 position)
+    {
+        return 0.25f * (float) std::sin (0.001 * (double) (position + 1) * (source + 1) + channel);
+    }
+
+    struct Region
+    {
+        int source;
+        double startInModification;
+        double startInPlayback;
+        double duration;
+    };
+
+    // Overlapping regions, so blocks are rendered from one region directly
+    // and from two mixed together
+    static inline const std::vector<Region> regions {
+        { 0, 0.0, 0.0, 2.0 },
+        { 1, 1.0, 1.5, 2.0 }
+    };
+
+    static float getExpectedSample (int channel, juce::int64 playbackSample)
+    {
+        float sample = 0.0f;
+
+        for (const auto& region : regions)
+        {
+            const auto start = (juce::int64) (region.startInPlayback * sampleRate);
+            const auto end = start + (juce::int64) (region.duration * sampleRate);
+
+            if (playbackSample >= start && playbackSample < end)
+                sample += getSourceSample (region.source, channel,
+                                           playbackSample - start + (juce::int64) (region.startInModification * sampleRate));
+        }
+
+        return sample;
+    }
+
+    //==============================================================================
+    class PlayHead final : public juce::AudioPlayHead
+    {
+    public:
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setTimeInSamples (timeInSamples);
+            info.setTimeInSeconds ((double) timeInSamples / sampleRate);
+            info.setIsPlaying (isPlaying);
+            return info;
+        }
+
+        juce::int64 timeInSamples = 0;
+        bool isPlaying = false;
+    };
+
+    struct RenderResult
+    {
+        int numBlocks = 0;
+        int numMismatchedBlocks = 0;
+        juce::int64 numUnderruns = 0;
+        juce::int64 numAllocations = 0;
+        RenderStats::Snapshot stats;
+    };
+
+    class Host
+    {
+    public:
+        ~Host()
+        {
+            shutdown();
+        }
+
+        bool initialise()
+        {
+            factory = createARAFactory();
+
+            static ARA::ARAAssertFunction assertFunction = [] (ARA::ARAAssertCategory, const void*, const char* diagnosis)
+            {
+                DBG ("ARA assert: " + juce::String (diagnosis));
+                jassertfalse;
+            };
+
+            ARA::ARAInterfaceConfiguration configuration {};
+            configuration.structSize = sizeof (configuration);
+            configuration.desiredApiGeneration = ARA::kARAAPIGeneration_2_0_Final;
+            configuration.assertFunctionAddress = &assertFunction;
+            factory->initializeARAWithConfiguration (&configuration);
+            isARAInitialised = true;
+
+            if (! createDocument())
+                return false;
+
+            processor.reset (createPluginFilter());
+            araExtension = dynamic_cast<juce::AudioProcessorARAExtension*> (processor.get());
+            if (araExtension == nullptr)
+                return false;
+
+            extension = araExtension->bindToARA (controller->documentControllerRef,
+                                                 ARA::kARAPlaybackRendererRole | ARA::kARAEditorRendererRole | ARA::kARAEditorViewRole,
+                                                 ARA::kARAPlaybackRendererRole);
+            if (extension == nullptr || extension->playbackRendererInterface == nullptr)
+                return false;
+
+            for (auto* playbackRegion : playbackRegions)
+                extension->playbackRendererInterface->addPlaybackRegion (extension->playbackRendererRef, playbackRegion);
+
+            processor->setPlayHead (&playHead);
+            return true;
+        }
+
+        // Renders the whole timeline, paced to the block rate when realtime
+        RenderResult render (bool realtime)
+        {
+            RenderResult result;
+
+            processor->setNonRealtime (! realtime);
+            processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+            processor->prepareToPlay (sampleRate, blockSize);
+
+            juce::AudioBuffer<float> buffer (numChannels, blockSize);
+            juce::MidiBuffer midi;
+
+            const auto numSamples = (juce::int64) ((regions.back().startInPlayback + regions.back().duration) * sampleRate);
+            const auto blockMs = 1000.0 * blockSize / sampleRate;
+
+            // Stopped at the start, as a host is before playback, which cues
+            // the prefetchers with the first audio
+            playHead.timeInSamples = 0;
+            playHead.isPlaying = false;
+            processBlock (buffer, midi, result);
+
+            if (realtime)
+                juce::Thread::sleep (200);
+
+            playHead.isPlaying = true;
+            auto nextBlockMs = juce::Time::getMillisecondCounterHiRes();
+
+            for (juce::int64 position = 0; position < numSamples; position += blockSize)
+            {
+                if (realtime)
+                {
+                    nextBlockMs += blockMs;
+                    const auto waitMs = nextBlockMs - juce::Time::getMillisecondCounterHiRes();
+                    if (waitMs > 0.0)
+                        juce::Thread::sleep ((int) waitMs);
+                }
+
+                playHead.timeInSamples = position;
+                processBlock (buffer, midi, result);
+
+                if (! matchesDocument (buffer, position))
+                    ++result.numMismatchedBlocks;
+            }
+
+            // Released after reading, since releasing resets the statistics
+            if (auto* renderer = araExtension->getPlaybackRenderer<ReaSpeechLitePlaybackRenderer>())
+            {
+                result.stats = renderer->getRenderStats().getSnapshot();
+                result.numUnderruns = renderer->getNumPrefetchUnderruns();
+            }
+
+            processor->releaseResources();
+            return result;
+        }
+
+    private:
+        struct Source
+        {
+            int index = 0;
+        };
+
+        struct Reader
+        {
+            const Source* source = nullptr;
+        };
+
+        void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi, RenderResult& result)
+        {
+            // The host's input, which rendering replaces
+            buffer.clear();
+
+            const auto allocationsBefore = AllocationCounter::numAllocations.load();
+            {
+                const AllocationCounter::ScopedAudioThread audioThread;
+                processor->processBlock (buffer, midi);
+            }
+            result.numAllocations += AllocationCounter::numAllocations.load() - allocationsBefore;
+            ++result.numBlocks;
+        }
+
+        static bool matchesDocument (const juce::AudioBuffer<float>& buffer, juce::int64 position)
+        {
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                    if (std::abs (buffer.getSample (channel, i) - getExpectedSample (channel, position + i)) > 1.0e-5f)
+                        return false;
+
+            return true;
+        }
+
+        bool createDocument()
+        {
+            static const ARA::ARAAudioAccessControllerInterface audioAccess {
+                sizeof (ARA::ARAAudioAccessControllerInterface),
+                [] (ARA::ARAAudioAccessControllerHostRef, ARA::ARAAudioSourceHostRef sourceRef, ARA::ARABool use64BitSamples)
+                {
+                    jassert (! use64BitSamples);
+                    juce::ignoreUnused (use64BitSamples);
+                    return reinterpret_cast<ARA::ARAAudioReaderHostRef> (new Reader { reinterpret_cast<const Source*> (sourceRef) });
+                },
+                [] (ARA::ARAAudioAccessControllerHostRef, ARA::ARAAudioReaderHostRef readerRef, ARA::ARASamplePosition position,
+                    ARA::ARASampleCount numSamples, void* const buffers[]) -> ARA::ARABool
+                {
+                    const auto* reader = reinterpret_cast<const Reader*> (readerRef);
+
+                    for (int channel = 0; channel < numChannels; ++channel)
+                    {
+                        auto* samples = static_cast<float*> (buffers[channel]);
+                        for (ARA::ARASampleCount i = 0; i < numSamples; ++i)
+                            samples[i] = getSourceSample (reader->source->index, channel, position + i);
+                    }
+
+                    return ARA::kARATrue;
+                },
+                [] (ARA::ARAAudioAccessControllerHostRef, ARA::ARAAudioReaderHostRef readerRef)
+                {
+                    delete reinterpret_cast<Reader*> (readerRef);
+                }
+            };
+
+            // Nothing is archived in the harness
+            static const ARA::ARAArchivingControllerInterface archiving {
+                sizeof (ARA::ARAArchivingControllerInterface),
+                [] (ARA::ARAArchivingControllerHostRef, ARA::ARAArchiveReaderHostRef) -> ARA::ARASize { return 0; },
+                [] (ARA::ARAArchivingControllerHostRef, ARA::ARAArchiveReaderHostRef, ARA::ARASize, ARA::ARASize, ARA::ARAByte[]) -> ARA::ARABool { return ARA::kARAFalse; },
+                [] (ARA::ARAArchivingControllerHostRef, ARA::ARAArchiveWriterHostRef, ARA::ARASize, ARA::ARASize, const ARA::ARAByte[]) -> ARA::ARABool { return ARA::kARAFalse; },
+                [] (ARA::ARAArchivingControllerHostRef, float) {},
+                [] (ARA::ARAArchivingControllerHostRef, float) {},
+                [] (ARA::ARAArchivingControllerHostRef, ARA::ARAArchiveReaderHostRef) -> ARA::ARAPersistentID { return nullptr; }
+            };
+
+            ARA::ARADocumentControllerHostInstance hostInstance {};
+            hostInstance.structSize = sizeof (hostInstance);
+            hostInstance.audioAccessControllerInterface = &audioAccess;
+            hostInstance.archivingControllerInterface = &archiving;
+            documentHostInstance = hostInstance;
+
+            ARA::ARADocumentProperties documentProperties {};
+            documentProperties.structSize = sizeof (documentProperties);
+            documentProperties.name = "Render harness";
+
+            controller = factory->createDocumentControllerWithDocument (&documentHostInstance, &documentProperties);
+            if (controller == nullptr)
+                return false;
+
+            const auto* dc = controller->documentControllerInterface;
+            const auto ref = controller->documentControllerRef;
+
+            dc->beginEditing (ref);
+
+            ARA::ARAMusicalContextProperties contextProperties {};
+            contextProperties.structSize = sizeof (contextProperties);
+            contextProperties.name = "Song";
+            musicalContext = dc->createMusicalContext (ref, reinterpret_cast<ARA::ARAMusicalContextHostRef> (this), &contextProperties);
+
+            ARA::ARARegionSequenceProperties sequenceProperties {};
+            sequenceProperties.structSize = sizeof (sequenceProperties);
+            sequenceProperties.name = "Track";
+            sequenceProperties.musicalContextRef = musicalContext;
+            regionSequence = dc->createRegionSequence (ref, reinterpret_cast<ARA::ARARegionSequenceHostRef> (this), &sequenceProperties);
+
+            sources.resize (2);
+
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                sources[i].index = (int) i;
+                const auto persistentID = "source-" + std::to_string (i);
+
+                ARA::ARAAudioSourceProperties sourceProperties {};
+                sourceProperties.structSize = sizeof (sourceProperties);
+                sourceProperties.name = persistentID.c_str();
+                sourceProperties.persistentID = persistentID.c_str();
+                sourceProperties.sampleCount = (ARA::ARASampleCount) (sourceSeconds * sampleRate);
+                sourceProperties.sampleRate = sampleRate;
+                sourceProperties.channelCount = numChannels;
+
+                auto* audioSource = dc->createAudioSource (ref, reinterpret_cast<ARA::ARAAudioSourceHostRef> (&sources[i]), &sourceProperties);
+                dc->enableAudioSourceSamplesAccess (ref, audioSource, ARA::kARATrue);
+                audioSources.push_back (audioSource);
+
+                ARA::ARAAudioModificationProperties modificationProperties {};
+                modificationProperties.structSize = sizeof (modificationProperties);
+                modificationProperties.persistentID = persistentID.c_str();
+                audioModifications.push_back (dc->createAudioModification (ref, audioSource, reinterpret_cast<ARA::ARAAudioModificationHostRef> (&sources[i]),
+                                                                           &modificationProperties));
+            }
+
+            for (const auto& region : regions)
+            {
+                ARA::ARAPlaybackRegionProperties regionProperties {};
+                regionProperties.structSize = sizeof (regionProperties);
+                regionProperties.transformationFlags = ARA::kARAPlaybackTransformationNoChanges;
+                regionProperties.startInModificationTime = region.startInModification;
+                regionProperties.durationInModificationTime = region.duration;
+                regionProperties.startInPlaybackTime = region.startInPlayback;
+                regionProperties.durationInPlaybackTime = region.duration;
+                regionProperties.musicalContextRef = musicalContext;
+                regionProperties.regionSequenceRef = regionSequence;
+
+                playbackRegions.push_back (dc->createPlaybackRegion (ref, audioModifications[(size_t) region.source],
+                                                                     reinterpret_cast<ARA::ARAPlaybackRegionHostRef> (this), &regionProperties));
+            }
+
+            dc->endEditing (ref);
+            return true;
+        }
+
+        void shutdown()
+        {
+            if (extension != nullptr)
+                for (auto* playbackRegion : playbackRegions)
+                    extension->playbackRendererInterface->removePlaybackRegion (extension->playbackRendererRef, playbackRegion);
+
+            // Destroying the processor unbinds it from the document
+            extension = nullptr;
+            processor.reset();
+
+            if (controller != nullptr)
+            {
+                const auto* dc = controller->documentControllerInterface;
+                const auto ref = controller->documentControllerRef;
+
+                dc->beginEditing (ref);
+
+                for (auto* playbackRegion : playbackRegions)
+                    dc->destroyPlaybackRegion (ref, playbackRegion);
+
+                for (auto* audioModification : audioModifications)
+                    dc->destroyAudioModification (ref, audioModification);
+
+                for (auto* audioSource : audioSources)
+                {
+                    dc->enableAudioSourceSamplesAccess (ref, audioSource, ARA::kARAFalse);
+                    dc->destroyAudioSource (ref, audioSource);
+                }
+
+                if (regionSequence != nullptr)
+                    dc->destroyRegionSequence (ref, regionSequence);
+
+                if (musicalContext != nullptr)
+                    dc->destroyMusicalContext (ref, musicalContext);
+
+                dc->endEditing (ref);
+                dc->destroyDocumentController (ref);
+                controller = nullptr;
+            }
+
+            if (isARAInitialised)
+            {
+                factory->uninitializeARA();
+                isARAInitialised = false;
+            }
+        }
+
+        const ARA::ARAFactory* factory = nullptr;
+        bool isARAInitialised = false;
+
+        ARA::ARADocumentControllerHostInstance documentHostInstance {};
+        const ARA::ARADocumentControllerInstance* controller = nullptr;
+        ARA::ARAMusicalContextRef musicalContext = nullptr;
+        ARA::ARARegionSequenceRef regionSequence = nullptr;
+        std::vector<Source> sources;
+        std::vector<ARA::ARAAudioSourceRef> audioSources;
+        std::vector<ARA::ARAAudioModificationRef> audioModifications;
+        std::vector<ARA::ARAPlaybackRegionRef> playbackRegions;
+
+        std::unique_ptr<juce::AudioProcessor> processor;
+        juce::AudioProcessorARAExtension* araExtension = nullptr;
+        const ARA::ARAPlugInExtensionInstance* extension = nullptr;
+        PlayHead playHead;
+    };
+};
+
+static RenderHarness renderHarness;
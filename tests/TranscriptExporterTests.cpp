@@ -0,0 +1,142 @@
+#include <juce_core/juce_core.h>
+
+#include "../source/asr/TranscriptExporter.h"
+
+class TranscriptExporterTests final : public juce::UnitTest
+{
+public:
+    TranscriptExporterTests() : juce::UnitTest ("TranscriptExporter", "ReaSpeechLite") {}
+
+    void runTest() override
+    {
+        beginTest ("Cues from several sources are merged in timeline order");
+        {
+            const auto english = makeSource ("en", "English.wav", { { "Hello", 0.0f, 1.0f }, { "World", 4.0f, 5.0f } });
+            auto french = makeSource ("fr", "French.wav", { { "Bonjour", 0.0f, 1.5f } });
+
+            auto placedEnglish = english;
+            placedEnglish.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 0.0 } };
+            french.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 2.0 } };
+
+            expectEquals (write (TranscriptExporter::Format::srt, { placedEnglish, french }),
+                          juce::String ("1\n00:00:00,000 --> 00:00:01,000\nHello\n"
+                                        "\n2\n00:00:02,000 --> 00:00:03,500\nBonjour\n"
+                                        "\n3\n00:00:04,000 --> 00:00:05,000\nWorld\n"));
+        }
+
+        beginTest ("Each playback region of a source gets its own cues");
+        {
+            auto source = makeSource ("en", "English.wav", { { "Hello", 0.0f, 1.0f }, { "World", 4.0f, 5.0f } });
+            source.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 20.0 }, { 0.0, 2.0, 0.0 } };
+
+            expectEquals (write (TranscriptExporter::Format::srt, { source }),
+                          juce::String ("1\n00:00:00,000 --> 00:00:01,000\nHello\n"
+                                        "\n2\n00:00:20,000 --> 00:00:21,000\nHello\n"
+                                        "\n3\n00:00:24,000 --> 00:00:25,000\nWorld\n"));
+        }
+
+        beginTest ("WebVTT notes name the source wherever it changes");
+        {
+            auto english = makeSource ("en", "English.wav", { { "Hello", 0.0f, 1.0f }, { "World", 4.0f, 5.0f } });
+            auto french = makeSource ("fr", "French.wav", { { "Bonjour", 0.0f, 1.5f } });
+            english.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 0.0 } };
+            french.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 2.0 } };
+
+            expectEquals (write (TranscriptExporter::Format::vtt, { english, french }),
+                          juce::String ("WEBVTT\n\n"
+                                        "NOTE English.wav\n\n00:00:00.000 --> 00:00:01.000\nHello\n\n"
+                                        "NOTE French.wav\n\n00:00:02.000 --> 00:00:03.500\nBonjour\n\n"
+                                        "NOTE English.wav\n\n00:00:04.000 --> 00:00:05.000\nWorld\n\n"));
+        }
+
+        beginTest ("Segments no region plays get no cue");
+        {
+            auto source = makeSource ("en", "English.wav", { { "Hello", 0.0f, 1.0f }, { "World", 4.0f, 5.0f } });
+            source.placements = std::vector<TranscriptExporter::Placement> { { 3.0, 10.0, 7.0 } };
+
+            expectEquals (write (TranscriptExporter::Format::srt, { source }),
+                          juce::String ("1\n00:00:08,000 --> 00:00:09,000\nWorld\n"));
+        }
+
+        beginTest ("Without placements, cues use source time");
+        {
+            const auto source = makeSource ("en", "English.wav", { { "Hello", 0.0f, 1.0f } });
+
+            expectEquals (write (TranscriptExporter::Format::srt, { source }),
+                          juce::String ("1\n00:00:00,000 --> 00:00:01,000\nHello\n"));
+        }
+
+        beginTest ("CSV fields are quoted, with quotes doubled");
+        {
+            const auto source = makeSource ("en", "Take \"1\", final.wav", { { "Say \"hi\", then go", 0.0f, 1.0f } });
+
+            expectEquals (write (TranscriptExporter::Format::csv, { source }),
+                          juce::String ("\"Start\",\"End\",\"Text\",\"Score\",\"Source\"\n"
+                                        "\"0:00.000\",\"0:01.000\",\"Say \"\"hi\"\", then go\",\"0.00\",\"Take \"\"1\"\", final.wav\"\n"));
+        }
+
+        beginTest ("Word rows are placed on the timeline with their segment");
+        {
+            auto transcript = std::make_shared<ASRTranscript>();
+            transcript->addSegment ("Hello world", 1.0f, 2.0f);
+            transcript->addWord ("Hello", 1.0f, 1.5f, 0.9f);
+            transcript->addWord ("world", 1.5f, 2.0f, 0.8f);
+
+            TranscriptExporter::Source source { "en", "English.wav", transcript, std::vector<TranscriptExporter::Placement> { { 0.0, 10.0, 5.0 } } };
+
+            expectEquals (write (TranscriptExporter::Format::words, { source }),
+                          juce::String ("\"Start\",\"End\",\"Word\",\"Probability\",\"Segment\",\"Source\"\n"
+                                        "\"0:06.000\",\"0:06.500\",\"Hello\",\"0.90\",\"0\",\"English.wav\"\n"
+                                        "\"0:06.500\",\"0:07.000\",\"world\",\"0.80\",\"0\",\"English.wav\"\n"));
+        }
+
+        beginTest ("JSON segments get playback times from the region that starts them");
+        {
+            auto source = makeSource ("en", "English.wav", { { "Hello", 0.5f, 1.0f }, { "World", 2.0f, 3.0f } });
+            source.placements = std::vector<TranscriptExporter::Placement> { { 0.0, 2.0, 10.0 } };
+
+            const auto json = juce::JSON::parse (write (TranscriptExporter::Format::json, { source }));
+            const auto& segments = json["sources"][0]["segments"];
+
+            expectEquals ((double) segments[0]["playbackStart"], 10.5);
+            expectEquals ((double) segments[0]["playbackEnd"], 11.0);
+
+            // The region ends where the second segment starts
+            expect (! segments[1].hasProperty ("playbackStart"));
+        }
+    }
+
+private:
+    struct Segment
+    {
+        const char* text;
+        float start;
+        float end;
+    };
+
+    static TranscriptExporter::Source makeSource (const juce::String& persistentID,
+                                                  const juce::String& name,
+                                                  std::initializer_list<Segment> segments)
+    {
+        auto transcript = std::make_shared<ASRTranscript>();
+        for (const auto& segment : segments)
+            transcript->addSegment (segment.text, segment.start, segment.end);
+
+        return { persistentID, name, std::move (transcript), std::nullopt };
+    }
+
+    static juce::String write (TranscriptExporter::Format format, const std::vector<TranscriptExporter::Source>& sources)
+    {
+        juce::MemoryOutputStream out;
+        TranscriptExporter exporter (out, format);
+
+        exporter.writeHeader();
+        for (const auto& source : sources)
+            exporter.writeSource (source);
+        exporter.writeFooter();
+
+        return out.toString();
+    }
+};
+
+static TranscriptExporterTests transcriptExporterTests;
@@ -0,0 +1,135 @@
+#include <juce_core/juce_core.h>
+
+#include "../source/ara/TimelineIndex.h"
+#include "../source/asr/ASRTranscriptPatch.h"
+#include "../source/asr/TranscriptSearchIndex.h"
+
+class TranscriptPatchTests final : public juce::UnitTest
+{
+public:
+    TranscriptPatchTests() : juce::UnitTest ("ASRTranscriptPatch", "ReaSpeechLite") {}
+
+    void runTest() override
+    {
+        beginTest ("Patches after a search and a lookup are applied in place");
+        {
+            auto editable = makeTranscript();
+            std::shared_ptr<const ASRTranscript> current = editable;
+            const auto* original = current.get();
+
+            TranscriptSearchIndex searchIndex;
+            searchIndex.update ("a", 1, current.get());
+
+            bool truncated = false;
+            expectEquals ((int) searchIndex.search ("hello", {}, truncated).size(), 1);
+
+            TimelineIndex timelineIndex ([&current] (const juce::String&) { return current; });
+            timelineIndex.updateRegions (1, { { 1, "a", 0.0, 10.0, 0.0, 10.0 } });
+            timelineIndex.setTranscriptVersion ("a", 1);
+            expectEquals (timelineIndex.lookupPlaybackTime (0.5).front().segment, 0);
+
+            juce::String error;
+            expect (makeReplace (0, "hi").applyToOwned (current, editable, error), error);
+            expect (current.get() == original, "The transcript was copied");
+            expect (editable.get() == original, "The editable transcript was replaced");
+            expectEquals (current->getSegmentText (0), juce::String ("hi"));
+
+            // The indexes pick up the edit once told of the new version
+            searchIndex.update ("a", 2, current.get());
+            expectEquals ((int) searchIndex.search ("hi", {}, truncated).size(), 1);
+
+            timelineIndex.setTranscriptVersion ("a", 2);
+            expect (timelineIndex.lookupPlaybackTime (0.5).front().transcript.get() == original);
+        }
+
+        beginTest ("Patches to a transcript held elsewhere are applied to a copy");
+        {
+            auto editable = makeTranscript();
+            std::shared_ptr<const ASRTranscript> current = editable;
+            const auto held = current;
+
+            juce::String error;
+            expect (makeReplace (0, "hi").applyToOwned (current, editable, error), error);
+            expect (current.get() != held.get());
+            expect (editable.get() == current.get());
+            expectEquals (held->getSegmentText (0), juce::String ("hello world"));
+            expectEquals (current->getSegmentText (0), juce::String ("hi"));
+        }
+
+        beginTest ("Rejected patches leave the transcript unchanged");
+        {
+            auto editable = makeTranscript();
+            std::shared_ptr<const ASRTranscript> current = editable;
+
+            juce::String error;
+            expect (! makeReplace (99, "hi").applyToOwned (current, editable, error));
+            expect (error.isNotEmpty());
+            expectEquals (current->getSegmentText (0), juce::String ("hello world"));
+        }
+
+        beginTest ("Patches that move a start out of order are rejected");
+        {
+            auto transcript = makeTranscript();
+
+            ASRTranscriptPatch patch;
+            ASRTranscriptPatch::Operation operation;
+            operation.id = 0;
+            operation.start = 2.5f;
+            patch.operations.push_back (operation);
+
+            juce::String error;
+            expect (! patch.applyTo (*transcript, error));
+            expect (error.isNotEmpty());
+            expectEquals (transcript->getSegmentStart (0), 0.0f);
+
+            // Allowed once the segment it would pass is deleted
+            ASRTranscriptPatch::Operation removal;
+            removal.id = 1;
+            removal.remove = true;
+            patch.operations.push_back (removal);
+
+            expect (patch.applyTo (*transcript, error), error);
+            expectEquals (transcript->getSegmentStart (0), 2.5f);
+        }
+
+        beginTest ("Transcripts read from the UI keep their segment IDs");
+        {
+            auto previous = makeTranscript();
+            previous->removeSegment (1);
+
+            const auto transcriptVar = juce::JSON::parse (R"({ "segments": [
+                { "id": 0, "text": "hello world", "start": 0.0, "end": 1.0 },
+                { "text": "new", "start": 1.0, "end": 2.0 },
+                { "id": 7, "text": "later", "start": 3.0, "end": 4.0 }
+            ] })");
+
+            ASRTranscript transcript;
+            expect (ASRTranscript::fromVar (transcriptVar, transcript, previous.get()));
+            expectEquals ((int) transcript.getSegmentID (0), 0);
+            expectEquals ((int) transcript.getSegmentID (1), 2);
+            expectEquals ((int) transcript.getSegmentID (2), 7);
+            expectEquals ((int) transcript.getNextSegmentID(), 8);
+        }
+    }
+
+private:
+    static std::shared_ptr<ASRTranscript> makeTranscript()
+    {
+        auto transcript = std::make_shared<ASRTranscript>();
+        transcript->addSegment ("hello world", 0.0f, 1.0f);
+        transcript->addSegment ("goodbye", 2.0f, 3.0f);
+        return transcript;
+    }
+
+    static ASRTranscriptPatch makeReplace (uint32_t id, const std::string& text)
+    {
+        ASRTranscriptPatch patch;
+        ASRTranscriptPatch::Operation operation;
+        operation.id = id;
+        operation.text = text;
+        patch.operations.push_back (operation);
+        return patch;
+    }
+};
+
+static TranscriptPatchTests transcriptPatchTests;